@@ -55,13 +55,44 @@
 #ifndef CPPMEMO_H_
 #define CPPMEMO_H_
 
+// Rarely taken paths are kept out of the lookup path, so that the latter can still be inlined
+#if defined(_MSC_VER)
+#define CPPMEMO_NOINLINE __declspec(noinline)
+#elif defined(__GNUC__)
+#define CPPMEMO_NOINLINE __attribute__((noinline))
+#else
+#define CPPMEMO_NOINLINE
+#endif
+
 #include <vector> // std::vector
+#include <deque> // std::deque
 #include <unordered_set> // std::unordered_set
-#include <random> // std::minstd_rand
+#include <unordered_map> // std::unordered_map
 #include <thread> // std::thread
-#include <algorithm> // std::shuffle
+#include <mutex> // std::mutex, std::lock_guard
+#include <condition_variable> // std::condition_variable
+#include <atomic> // std::atomic
+#include <functional> // std::function
+#include <memory> // std::shared_ptr, std::unique_ptr
+#include <string> // std::string
+#include <chrono> // std::chrono::milliseconds
+#include <exception> // std::exception_ptr
+#include <algorithm> // std::max
 #include <cstddef> // std::nullptr_t
-#include <stdexcept> // std::logic_error, std::runtime_error
+#include <stdexcept> // std::logic_error, std::runtime_error, std::out_of_range
+#include <utility> // std::pair, std::piecewise_construct_t
+#include <new> // placement new
+#include <type_traits> // std::is_trivially_destructible
+#include <cstring> // std::memcpy
+
+// Storages spanning several processes are available on POSIX systems (see SharedStorage and ShardedStorage)
+#if defined(__unix__) || defined(__APPLE__)
+#define CPPMEMO_POSIX
+#include <cerrno> // errno
+#include <sys/socket.h> // socket, connect, send, recv
+#include <sys/un.h> // sockaddr_un
+#include <unistd.h> // close, unlink
+#endif
 
 #include <fcmm/fcmm.hpp>
 
@@ -72,13 +103,14 @@ namespace cppmemo {
  *
  * This requires <i>circular dependency detection</i> to be enabled (via the
  * `detectCircularDependencies` argument of @link CppMemo @endlink constructor).
+ * Multi-thread executions throw this exception even if detection is disabled, but with an empty keys stack.
  *
  * @tparam Key the type of the keys
  */
 template<typename Key>
 class CircularDependencyException : public std::exception {
     
-    template<typename K, typename V, typename KH1, typename KH2, typename KE>
+    template<typename K, typename V, typename KH1, typename KH2, typename KE, typename S>
     friend class CppMemo;
     
 private:
@@ -105,27 +137,349 @@ public:
     const std::vector<Key>& getKeysStack() const {
         return keysStack;
     }
-    
+
 };
 
 /**
- * @brief This class implements a generic framework for memoization supporting
- * automatic parallel execution.
- * 
- * Please read the documentation on the project website: http://projects.giacomodrago.com/c++memo
+ * @brief The execution modes of multi-thread computations (single-thread computations are not affected).
  *
- * @tparam Key       the type of the key (default-constructible and copy-constructible)
- * @tparam Value     the type of the value (default-constructible and copy-constructible)
- * @tparam KeyHash1  the type of a function object that calculates the hash of the key;
- *                   it should have the same interface as
- *                   <a href="http://en.cppreference.com/w/cpp/utility/hash">std::hash<T></a>
- * @tparam KeyHash2  the type of another function object that calculates the hash of the key:
- *                   it should be <i>completely independent from KeyHash1</i>;
- *                   the default for this template parameter is only available for
- *                   <a href="http://en.cppreference.com/w/cpp/types/is_integral">integral types</a>.
- * @tparam KeyEqual  the type of the function object that checks the equality of the two keys;
- *                   it should have the same interface as
- *                   <a href="http://en.cppreference.com/w/cpp/utility/functional/equal_to">std::equal_to<T></a>
+ * @see CppMemo::setExecutionMode()
+ */
+enum class ExecutionMode {
+
+    /**
+     * @brief Prerequisites are discovered and computed concurrently: a key is computed as soon as
+     * all its prerequisites have been computed, while other keys are still being discovered.
+     */
+    COOPERATIVE,
+
+    /**
+     * @brief The whole dependency graph of the requested key is discovered first (in parallel); then the keys
+     * are evaluated in dataflow order, each one becoming ready when its count of pending prerequisites hits zero.
+     * This mode suits wide and shallow dependency graphs.
+     */
+    DATAFLOW
+
+};
+
+/**
+ * @brief A pool of long-lived worker threads executing tasks with work stealing.
+ *
+ * Each worker owns a deque of tasks: it pops tasks from the back of its own deque and, when the deque is empty,
+ * steals tasks from the front of the other workers' deques. Tasks are grouped into @link TaskGroup @endlink
+ * instances, which allow waiting for their completion and carry exceptions back to the waiting thread.
+ *
+ * A pool can be owned by a single @link CppMemo @endlink instance or shared among several instances
+ * (see CppMemo::CppMemo(const std::shared_ptr<ThreadPool>&, std::size_t, bool)), so that memos running
+ * side by side do not oversubscribe the cores.
+ */
+class ThreadPool {
+
+public:
+
+    class TaskGroup;
+
+private:
+
+    typedef std::function<void()> Task;
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    struct Context {
+        const ThreadPool* pool;
+        std::size_t queueIndex;
+    };
+
+    std::vector<std::unique_ptr<Queue> > queues;
+    std::vector<std::thread> threads;
+
+    std::atomic<std::size_t> numQueuedTasks;
+    std::atomic<std::size_t> numSleepingWorkers;
+    std::atomic<std::size_t> nextQueueIndex;
+
+    std::mutex sleepMutex;
+    std::condition_variable wakeUpCondition;
+    bool stopping;
+
+    /**
+     * @brief Returns the context of the calling thread: if the thread is a worker, the context
+     * identifies its pool and its own queue
+     */
+    static Context& getContext() {
+        static thread_local Context context = { nullptr, 0 };
+        return context;
+    }
+
+    bool isWorkerThread() const {
+        return getContext().pool == this;
+    }
+
+    /**
+     * @brief Enqueues a task: workers push to the back of their own queue, other threads
+     * distribute tasks among the queues in a round-robin fashion
+     */
+    void push(Task task) {
+
+        const std::size_t queueIndex = isWorkerThread() ?
+                getContext().queueIndex :
+                nextQueueIndex.fetch_add(1, std::memory_order_relaxed) % queues.size();
+
+        numQueuedTasks.fetch_add(1);
+
+        Queue& queue = *queues[queueIndex];
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.push_back(std::move(task));
+        }
+
+        if (numSleepingWorkers.load() > 0) {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            wakeUpCondition.notify_one();
+        }
+
+    }
+
+    /**
+     * @brief Dequeues a task, popping from the back of the calling worker's own queue or
+     * stealing from the front of another queue
+     *
+     * @return `true` if a task was dequeued, `false` if all the queues are empty
+     */
+    bool pop(Task& task) {
+
+        if (numQueuedTasks.load(std::memory_order_relaxed) == 0) {
+            return false;
+        }
+
+        const bool workerThread = isWorkerThread();
+        const std::size_t firstQueueIndex = workerThread ?
+                getContext().queueIndex :
+                nextQueueIndex.load(std::memory_order_relaxed) % queues.size();
+
+        for (std::size_t i = 0; i < queues.size(); i++) {
+            Queue& queue = *queues[(firstQueueIndex + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.tasks.empty()) {
+                if (workerThread && i == 0) { // own queue
+                    task = std::move(queue.tasks.back());
+                    queue.tasks.pop_back();
+                } else { // steal
+                    task = std::move(queue.tasks.front());
+                    queue.tasks.pop_front();
+                }
+                numQueuedTasks.fetch_sub(1);
+                return true;
+            }
+        }
+
+        return false;
+
+    }
+
+    void work(std::size_t queueIndex) {
+
+        getContext() = { this, queueIndex };
+
+        Task task;
+
+        while (true) {
+
+            if (pop(task)) {
+                task();
+                task = nullptr;
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            numSleepingWorkers.fetch_add(1);
+            wakeUpCondition.wait(lock, [this] { return stopping || numQueuedTasks.load() > 0; });
+            numSleepingWorkers.fetch_sub(1);
+            if (stopping && numQueuedTasks.load() == 0) {
+                return;
+            }
+
+        }
+
+    }
+
+public:
+
+    /**
+     * @brief A group of tasks executed by a @link ThreadPool @endlink.
+     *
+     * If a task throws an exception, the group is cancelled: the tasks that have not started yet are skipped,
+     * running tasks can poll isCancelled() to stop early, and wait() rethrows the first exception.
+     */
+    class TaskGroup {
+
+    private:
+
+        ThreadPool& pool;
+
+        std::atomic<std::size_t> numUnfinishedTasks;
+        std::atomic<bool> cancelled;
+
+        std::mutex mutex;
+        std::condition_variable finishedCondition;
+        bool finished;
+        std::exception_ptr exception;
+
+        void finish() {
+            if (numUnfinishedTasks.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                std::lock_guard<std::mutex> lock(mutex);
+                finished = true;
+                finishedCondition.notify_all();
+            }
+        }
+
+        void cancel(std::exception_ptr exception) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!this->exception) {
+                this->exception = exception;
+            }
+            cancelled.store(true, std::memory_order_relaxed);
+        }
+
+    public:
+
+        /**
+         * @brief Constructor.
+         *
+         * @param pool  the pool that will execute the tasks of this group
+         */
+        explicit TaskGroup(ThreadPool& pool) :
+                pool(pool), numUnfinishedTasks(1), cancelled(false), finished(false) {
+        }
+
+        /**
+         * @brief Enqueues a task. This method can also be called from within a task of the group.
+         *
+         * @tparam Function  function or functor implementing `void operator()()`
+         */
+        template<typename Function>
+        void run(Function function) {
+            numUnfinishedTasks.fetch_add(1, std::memory_order_relaxed);
+            pool.push([this, function]() mutable {
+                if (!isCancelled()) {
+                    try {
+                        function();
+                    } catch (...) {
+                        cancel(std::current_exception());
+                    }
+                }
+                finish();
+            });
+        }
+
+        /**
+         * @brief Returns `true` if a task of the group has thrown an exception, `false` otherwise
+         */
+        bool isCancelled() const {
+            return cancelled.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Waits for all the tasks of the group to complete. The calling thread helps executing
+         * queued tasks in the meantime. This method shall be called exactly once.
+         *
+         * @throw any exception thrown by a task of the group
+         */
+        void wait() {
+
+            finish(); // release the reference held by the group itself
+
+            Task task;
+            while (numUnfinishedTasks.load(std::memory_order_acquire) > 0) {
+                if (pool.pop(task)) {
+                    task();
+                    task = nullptr;
+                } else {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    finishedCondition.wait_for(lock, std::chrono::milliseconds(1), [this] { return finished; });
+                }
+            }
+
+            std::unique_lock<std::mutex> lock(mutex);
+            finishedCondition.wait(lock, [this] { return finished; });
+
+            if (exception) {
+                std::rethrow_exception(exception);
+            }
+
+        }
+
+        TaskGroup(const TaskGroup&) = delete;
+        TaskGroup(TaskGroup&&) = delete;
+
+    };
+
+    /**
+     * @brief Constructor.
+     *
+     * @param numWorkers  the number of worker threads to be started (it can be zero: in that case tasks are
+     *                    only executed by the threads waiting for them)
+     */
+    explicit ThreadPool(std::size_t numWorkers) :
+            numQueuedTasks(0), numSleepingWorkers(0), nextQueueIndex(0), stopping(false) {
+
+        for (std::size_t i = 0; i < std::max(numWorkers, (std::size_t) 1); i++) {
+            queues.emplace_back(new Queue());
+        }
+
+        threads.reserve(numWorkers);
+        for (std::size_t i = 0; i < numWorkers; i++) {
+            threads.emplace_back(&ThreadPool::work, this, i);
+        }
+
+    }
+
+    /**
+     * @brief Destructor. Waits for the queued tasks to complete and joins the worker threads.
+     */
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        wakeUpCondition.notify_all();
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+
+    /**
+     * @brief Returns the number of worker threads
+     */
+    std::size_t getNumWorkers() const {
+        return threads.size();
+    }
+
+    /**
+     * @brief Returns the (approximate) number of tasks waiting to be executed
+     */
+    std::size_t getNumQueuedTasks() const {
+        return numQueuedTasks.load(std::memory_order_relaxed);
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool(ThreadPool&&) = delete;
+
+};
+
+/**
+ * @brief The default storage of the memoized values: a concurrent hashmap (see fcmm::Fcmm).
+ *
+ * A storage class is passed to @link CppMemo @endlink as its `Storage` template argument,
+ * and must provide the same public interface as this class.
+ *
+ * @tparam Key       the type of the key
+ * @tparam Value     the type of the value
+ * @tparam KeyHash1  the type of a function object that calculates the hash of the key
+ * @tparam KeyHash2  the type of another function object that calculates the hash of the key
+ * @tparam KeyEqual  the type of the function object that checks the equality of the two keys
  */
 template<
     typename Key,
@@ -134,16 +488,1635 @@ template<
     typename KeyHash2 = fcmm::DefaultKeyHash2<Key>,
     typename KeyEqual = std::equal_to<Key>
 >
-class CppMemo {
-    
+class FcmmStorage {
+
 private:
-    
-    typedef fcmm::Fcmm<Key, Value, KeyHash1, KeyHash2, KeyEqual> Values;
-    
-    int defaultNumThreads;
-    Values values;
-    bool detectCircularDependencies;
-    
+
+    // mutable: the values found in the snapshot are inserted by the searches (see findInSnapshot())
+    mutable fcmm::Fcmm<Key, Value, KeyHash1, KeyHash2, KeyEqual> entries;
+
+    typedef fcmm::Snapshot<Key, Value, KeyHash1, KeyEqual> Snapshot;
+
+    std::unique_ptr<const Snapshot> snapshot;
+
+    /**
+     * @brief Searches the snapshot: set by loadSnapshot(), so that keys and values only need to be serializable
+     * (see fcmm::Serializer) if a snapshot is loaded
+     */
+    bool (*findInSnapshotFunction)(const Snapshot& snapshot, const Key& key, Value& value);
+
+    static bool findInLoadedSnapshot(const Snapshot& snapshot, const Key& key, Value& value) {
+        return snapshot.find(key, value);
+    }
+
+    /**
+     * @brief Searches the snapshot (if loaded) for a key not found among the entries: if found,
+     * its value is inserted, so that the snapshot is searched at most once per key. Not inlined, to keep
+     * the lookup path short.
+     */
+    CPPMEMO_NOINLINE const Value* findInSnapshot(const Key& key) const {
+        Value value;
+        if (!snapshot || !findInSnapshotFunction(*snapshot, key, value)) {
+            return nullptr;
+        }
+        return &entries.insert(key, [&value](const Key&) -> Value&& { return std::move(value); }).first->second;
+    }
+
+public:
+
+    /**
+     * @brief Where the search for a key ended, so that inserting the key afterwards does not hash it
+     * and probe the storage again (see fcmm::Fcmm::InsertHint).
+     */
+    typedef typename fcmm::Fcmm<Key, Value, KeyHash1, KeyHash2, KeyEqual>::InsertHint InsertHint;
+
+    /**
+     * @brief Constructor.
+     *
+     * @param estimatedNumEntries  an estimate for the number of values that will be stored
+     */
+    explicit FcmmStorage(std::size_t estimatedNumEntries = 0) : entries(estimatedNumEntries), findInSnapshotFunction(nullptr) {
+    }
+
+    /**
+     * @brief Constructor for a storage whose buckets spill to files when memory runs short
+     * (see fcmm::Fcmm::Fcmm()).
+     *
+     * Only the memoized values are spilled: a multi-thread CppMemo::getValue() also keeps a node in anonymous memory
+     * for each key discovered by the query (see the scheduler of CppMemo), until the query returns. The memory of
+     * a query that spans most of the memo is therefore only bounded by the spill files in single-thread executions.
+     *
+     * @param estimatedNumEntries  an estimate for the number of values that will be stored
+     * @param spillDirectory       the directory of the (unlinked) files backing the storage
+     */
+    FcmmStorage(std::size_t estimatedNumEntries, const std::string& spillDirectory) :
+            entries(estimatedNumEntries, fcmm::DEFAULT_MAX_LOAD_FACTOR, fcmm::DEFAULT_MAX_NUM_SUBMAPS,
+                    fcmm::HugePages::NONE, spillDirectory),
+            findInSnapshotFunction(nullptr) {
+    }
+
+    /**
+     * @brief Returns a pointer to the value stored for the given key, or `nullptr` if no value is stored.
+     */
+    const Value* find(const Key& key) const {
+        const auto findIt = entries.find(key);
+        return findIt != entries.end() ? &findIt->second : snapshot ? findInSnapshot(key) : nullptr;
+    }
+
+    /**
+     * @brief Returns a pointer to the value stored for the given key, or `nullptr` if no value is stored,
+     * filling a hint for inserting the key.
+     */
+    const Value* find(const Key& key, InsertHint& hint) const {
+        const auto findIt = entries.find(key, hint);
+        return findIt != entries.end() ? &findIt->second : snapshot ? findInSnapshot(key) : nullptr;
+    }
+
+    /**
+     * @brief Writes, for each key in the range [firstKey, lastKey) in order, a pointer to the value stored for it,
+     * or `nullptr` if no value is stored. The keys are looked up in batches (see fcmm::Fcmm::findMany()).
+     *
+     * @return the output iterator past the last written pointer
+     */
+    template<typename ForwardIterator, typename OutputIterator>
+    OutputIterator findMany(ForwardIterator firstKey, ForwardIterator lastKey, OutputIterator result) const {
+        typename fcmm::Fcmm<Key, Value, KeyHash1, KeyHash2, KeyEqual>::const_iterator findIts[fcmm::BATCH_SIZE];
+        while (firstKey != lastKey) {
+            ForwardIterator batchEnd = firstKey;
+            std::size_t batchSize = 0;
+            for (; batchEnd != lastKey && batchSize < fcmm::BATCH_SIZE; ++batchEnd, batchSize++);
+            entries.findMany(firstKey, batchEnd, findIts);
+            for (std::size_t i = 0; i < batchSize; i++, ++firstKey, ++result) {
+                *result = findIts[i] != entries.end() ? &findIts[i]->second : snapshot ? findInSnapshot(*firstKey) : nullptr;
+            }
+        }
+        return result;
+    }
+
+    /**
+     * @brief Returns the value stored for the given key.
+     *
+     * @throw std::out_of_range  thrown if no value is stored for the given key
+     */
+    const Value& operator[](const Key& key) const {
+        const Value* value = find(key);
+        if (value == nullptr) {
+            throw std::out_of_range("Entry not found");
+        }
+        return *value;
+    }
+
+    /**
+     * @brief Stores the value for the given key, unless a value is already stored.
+     *
+     * @return the value stored for the given key
+     */
+    const Value& insert(const Key& key, const Value& value) {
+        return entries.insert(key, [&value](const Key&) -> const Value& { return value; }).first->second;
+    }
+
+    /**
+     * @brief Stores the value for the given key, unless a value is already stored. The value will be moved, if stored.
+     *
+     * @return the value stored for the given key
+     */
+    const Value& insert(const Key& key, Value&& value) {
+        return entries.insert(key, [&value](const Key&) -> Value&& { return std::move(value); }).first->second;
+    }
+
+    /**
+     * @brief Stores the value for the given key, unless a value is already stored, using the hint
+     * filled by find(const Key&, InsertHint&).
+     *
+     * @return the value stored for the given key
+     */
+    const Value& insert(const Key& key, const InsertHint& hint, const Value& value) {
+        return entries.insert(key, hint, [&value](const Key&) -> const Value& { return value; }).first->second;
+    }
+
+    /**
+     * @brief Stores the value for the given key, unless a value is already stored, using the hint
+     * filled by find(const Key&, InsertHint&). The value will be moved, if stored.
+     *
+     * @return the value stored for the given key
+     */
+    const Value& insert(const Key& key, const InsertHint& hint, Value&& value) {
+        return entries.insert(key, hint, [&value](const Key&) -> Value&& { return std::move(value); }).first->second;
+    }
+
+    /**
+     * @brief Computes and stores the value for the given key, unless a value is already stored
+     * or being computed by another thread (see fcmm::Fcmm::insertExclusive()).
+     *
+     * @tparam ComputeValueFunction  function or functor implementing `Value operator()(const Key&)`
+     *
+     * @return the value stored for the given key
+     */
+    template<typename ComputeValueFunction>
+    const Value& insertExclusive(const Key& key, ComputeValueFunction computeValue) {
+        return entries.insertExclusive(key, computeValue).first->second;
+    }
+
+    /**
+     * @brief Computes and stores the value for the given key, unless a value is already stored
+     * or being computed by another thread, using the hint filled by find(const Key&, InsertHint&).
+     *
+     * @return the value stored for the given key
+     */
+    template<typename ComputeValueFunction>
+    const Value& insertExclusive(const Key& key, const InsertHint& hint, ComputeValueFunction computeValue) {
+        return entries.insertExclusive(key, hint, computeValue).first->second;
+    }
+
+    /**
+     * @brief Saves the stored values, including the ones of the loaded snapshot that have been searched for,
+     * to a snapshot file (see fcmm::Fcmm::saveSnapshot()).
+     */
+    void saveSnapshot(const std::string& filename) const {
+        entries.saveSnapshot(filename);
+    }
+
+    /**
+     * @brief Loads a snapshot file (see fcmm::Snapshot): the values it contains are found as if they were stored,
+     * and each of them is inserted into the storage when first found. The snapshot replaces any snapshot loaded before.
+     *
+     * @throw std::runtime_error  thrown if the file cannot be read, or is not a valid snapshot
+     */
+    void loadSnapshot(const std::string& filename) {
+        snapshot.reset(new Snapshot(filename));
+        findInSnapshotFunction = &findInLoadedSnapshot;
+    }
+
+    /**
+     * @brief Makes the values stored from now on be appended to `log` (see fcmm::Fcmm::setEntryLog())
+     */
+    void setEntryLog(fcmm::EntryLog* log) {
+        entries.setEntryLog(log);
+    }
+
+    /**
+     * @brief Stores the values of an entry log file (see fcmm::Fcmm::replayEntryLog())
+     */
+    std::size_t replayEntryLog(const std::string& filename) {
+        return entries.replayEntryLog(filename);
+    }
+
+    /**
+     * @brief Returns the statistics about the storage.
+     */
+    fcmm::Stats getStats() const {
+        return entries.getStats();
+    }
+
+};
+
+/**
+ * @brief Function object extracting the two coordinates of a key that has `first` and `second`
+ * members (e.g. `std::pair`), for use with the shapes of a @link DenseStorage @endlink.
+ *
+ * @tparam Key the type of the key
+ */
+template<typename Key>
+struct PairCoordinates {
+    std::pair<std::size_t, std::size_t> operator()(const Key& key) const {
+        return std::make_pair(key.first, key.second);
+    }
+};
+
+/**
+ * @brief Shape of a @link DenseStorage @endlink whose keys lie in a `numRows` &times; `numColumns` rectangle,
+ * e.g. `{items, weight}` in a knapsack problem.
+ *
+ * A shape maps each key to a slot index in `[0, size())`. Any class providing the same interface
+ * may be used as a custom shape.
+ *
+ * @tparam Key          the type of the key
+ * @tparam Coordinates  the type of a function object returning the (row, column) coordinates of a key
+ *                      as a `std::pair<std::size_t, std::size_t>`
+ */
+template<typename Key, typename Coordinates = PairCoordinates<Key> >
+class RectangularShape {
+
+private:
+
+    std::size_t numRows;
+    std::size_t numColumns;
+    Coordinates coordinates;
+
+public:
+
+    RectangularShape(std::size_t numRows, std::size_t numColumns, const Coordinates& coordinates = Coordinates()) :
+            numRows(numRows), numColumns(numColumns), coordinates(coordinates) {
+    }
+
+    /**
+     * @brief Returns the number of slots
+     */
+    std::size_t size() const {
+        return numRows * numColumns;
+    }
+
+    /**
+     * @brief Returns the slot index of a key, or size() if the key lies outside of the shape
+     */
+    std::size_t operator()(const Key& key) const {
+        const std::pair<std::size_t, std::size_t> point = coordinates(key);
+        if (point.first >= numRows || point.second >= numColumns) {
+            return size();
+        }
+        return point.first * numColumns + point.second;
+    }
+
+};
+
+/**
+ * @brief Shape of a @link DenseStorage @endlink whose keys are intervals `[from, to]` with
+ * `from <= to < numPoints`, e.g. the ranges of a matrix chain problem.
+ *
+ * @see RectangularShape
+ *
+ * @tparam Key          the type of the key
+ * @tparam Coordinates  the type of a function object returning the (from, to) coordinates of a key
+ *                      as a `std::pair<std::size_t, std::size_t>`
+ */
+template<typename Key, typename Coordinates = PairCoordinates<Key> >
+class TriangularShape {
+
+private:
+
+    std::size_t numPoints;
+    Coordinates coordinates;
+
+public:
+
+    TriangularShape(std::size_t numPoints, const Coordinates& coordinates = Coordinates()) :
+            numPoints(numPoints), coordinates(coordinates) {
+    }
+
+    /**
+     * @brief Returns the number of slots
+     */
+    std::size_t size() const {
+        return numPoints * (numPoints + 1) / 2;
+    }
+
+    /**
+     * @brief Returns the slot index of a key, or size() if the key lies outside of the shape
+     */
+    std::size_t operator()(const Key& key) const {
+        const std::pair<std::size_t, std::size_t> interval = coordinates(key);
+        if (interval.first > interval.second || interval.second >= numPoints) {
+            return size();
+        }
+        return interval.second * (interval.second + 1) / 2 + interval.first;
+    }
+
+};
+
+/**
+ * @brief Shape of a @link DenseStorage @endlink whose keys are subsets of `numBits` elements, encoded
+ * as bitmasks, optionally paired with a column in `[0, numColumns)` (e.g. `{visited, last}` in a
+ * travelling salesman problem).
+ *
+ * @see RectangularShape
+ *
+ * @tparam Key          the type of the key
+ * @tparam Coordinates  the type of a function object returning the (bitmask, column) coordinates of a key
+ *                      as a `std::pair<std::size_t, std::size_t>`
+ */
+template<typename Key, typename Coordinates = PairCoordinates<Key> >
+class BitmaskShape {
+
+private:
+
+    std::size_t numBits;
+    std::size_t numColumns;
+    Coordinates coordinates;
+
+public:
+
+    BitmaskShape(std::size_t numBits, std::size_t numColumns = 1, const Coordinates& coordinates = Coordinates()) :
+            numBits(numBits), numColumns(numColumns), coordinates(coordinates) {
+    }
+
+    /**
+     * @brief Returns the number of slots
+     */
+    std::size_t size() const {
+        return (std::size_t(1) << numBits) * numColumns;
+    }
+
+    /**
+     * @brief Returns the slot index of a key, or size() if the key lies outside of the shape
+     */
+    std::size_t operator()(const Key& key) const {
+        const std::pair<std::size_t, std::size_t> point = coordinates(key);
+        if ((point.first >> numBits) != 0 || point.second >= numColumns) {
+            return size();
+        }
+        return point.first * numColumns + point.second;
+    }
+
+};
+
+/**
+ * @brief A storage of the memoized values for keys lying in small, dense, known bounds: each key
+ * is mapped by a shape to a slot of a flat array, with no hashing and no key copies.
+ *
+ * Each slot holds the value and a one-byte state. The states and the values live in zero-filled memory
+ * (see fcmm::ZeroedMemory), whose pages are only allocated by the operating system when first touched,
+ * and each value is constructed in its slot when it is stored: a large shape costs no memory for the slots
+ * that are never used.
+ *
+ * @see FcmmStorage for the interface
+ *
+ * @tparam Key    the type of the key
+ * @tparam Value  the type of the value (move-constructible)
+ * @tparam Shape  the type of the shape mapping keys to slot indices (e.g. RectangularShape, TriangularShape,
+ *                BitmaskShape, or a custom class with the same interface)
+ */
+template<typename Key, typename Value, typename Shape>
+class DenseStorage {
+
+private:
+
+    enum State : unsigned char { EMPTY, COMPUTING, READY };
+
+    Shape shape;
+    fcmm::ZeroedMemory statesMemory; // zero is EMPTY
+    fcmm::ZeroedMemory valuesMemory;
+    std::atomic<unsigned char>* states;
+    Value* values; // only the values of the READY slots are constructed
+    std::atomic<std::size_t> numAvoidedComputations;
+
+    std::size_t getSlot(const Key& key) const {
+        const std::size_t slot = shape(key);
+        if (slot >= shape.size()) {
+            throw std::out_of_range("Key out of the storage shape");
+        }
+        return slot;
+    }
+
+    template<typename ComputeValueFunction>
+    const Value& insertHelper(const Key& key, ComputeValueFunction computeValue, bool countAvoided) {
+
+        const std::size_t slot = getSlot(key);
+        std::atomic<unsigned char>& state = states[slot];
+
+        while (true) {
+
+            unsigned char expected = EMPTY;
+            if (state.compare_exchange_strong(expected, COMPUTING, std::memory_order_acquire)) {
+                try {
+                    new (&values[slot]) Value(computeValue(key));
+                } catch (...) {
+                    state.store(EMPTY, std::memory_order_release);
+                    throw;
+                }
+                state.store(READY, std::memory_order_release);
+                return values[slot];
+            }
+
+            while (expected == COMPUTING) { // another thread is computing the value
+                std::this_thread::yield();
+                expected = state.load(std::memory_order_acquire);
+            }
+
+            if (expected == READY) {
+                if (countAvoided) {
+                    numAvoidedComputations.fetch_add(1, std::memory_order_relaxed);
+                }
+                return values[slot];
+            }
+
+            // the other thread abandoned the computation: try again
+
+        }
+
+    }
+
+public:
+
+    /**
+     * @brief Slots are found without probing, so there is nothing to remember between a search and an insertion
+     * (see FcmmStorage::InsertHint).
+     */
+    struct InsertHint {
+    };
+
+    /**
+     * @brief Constructor.
+     *
+     * @param shape  the shape mapping keys to slot indices
+     */
+    explicit DenseStorage(const Shape& shape) :
+            shape(shape),
+            statesMemory(std::max(shape.size(), (std::size_t) 1) * sizeof(std::atomic<unsigned char>), fcmm::HugePages::NONE),
+            valuesMemory(std::max(shape.size(), (std::size_t) 1) * sizeof(Value), fcmm::HugePages::NONE),
+            states(static_cast<std::atomic<unsigned char>*>(statesMemory.get())),
+            values(static_cast<Value*>(valuesMemory.get())),
+            numAvoidedComputations(0) {
+    }
+
+    /**
+     * @brief Destructor.
+     */
+    ~DenseStorage() {
+        if (!std::is_trivially_destructible<Value>::value) {
+            for (std::size_t slot = 0; slot < shape.size(); slot++) {
+                if (states[slot].load(std::memory_order_relaxed) == READY) {
+                    values[slot].~Value();
+                }
+            }
+        }
+    }
+
+    /**
+     * @see FcmmStorage::find()
+     */
+    const Value* find(const Key& key) const {
+        const std::size_t slot = shape(key);
+        if (slot >= shape.size() || states[slot].load(std::memory_order_acquire) != READY) {
+            return nullptr;
+        }
+        return &values[slot];
+    }
+
+    /**
+     * @see FcmmStorage::find(const Key&, InsertHint&)
+     */
+    const Value* find(const Key& key, InsertHint&) const {
+        return find(key);
+    }
+
+    /**
+     * @see FcmmStorage::findMany()
+     */
+    template<typename ForwardIterator, typename OutputIterator>
+    OutputIterator findMany(ForwardIterator firstKey, ForwardIterator lastKey, OutputIterator result) const {
+        for (; firstKey != lastKey; ++firstKey, ++result) {
+            *result = find(*firstKey);
+        }
+        return result;
+    }
+
+    /**
+     * @see FcmmStorage::operator[]()
+     */
+    const Value& operator[](const Key& key) const {
+        const Value* value = find(key);
+        if (value == nullptr) {
+            throw std::out_of_range("Entry not found");
+        }
+        return *value;
+    }
+
+    /**
+     * @see FcmmStorage::insert()
+     *
+     * @throw std::out_of_range  thrown if the key lies outside of the shape
+     */
+    const Value& insert(const Key& key, const Value& value) {
+        return insertHelper(key, [&value](const Key&) -> const Value& { return value; }, false);
+    }
+
+    /**
+     * @see FcmmStorage::insert(const Key&, Value&&)
+     *
+     * @throw std::out_of_range  thrown if the key lies outside of the shape
+     */
+    const Value& insert(const Key& key, Value&& value) {
+        return insertHelper(key, [&value](const Key&) -> Value&& { return std::move(value); }, false);
+    }
+
+    /**
+     * @see FcmmStorage::insert(const Key&, const InsertHint&, const Value&)
+     */
+    const Value& insert(const Key& key, const InsertHint&, const Value& value) {
+        return insert(key, value);
+    }
+
+    /**
+     * @see FcmmStorage::insert(const Key&, const InsertHint&, Value&&)
+     */
+    const Value& insert(const Key& key, const InsertHint&, Value&& value) {
+        return insert(key, std::move(value));
+    }
+
+    /**
+     * @see FcmmStorage::insertExclusive()
+     *
+     * @throw std::out_of_range  thrown if the key lies outside of the shape
+     */
+    template<typename ComputeValueFunction>
+    const Value& insertExclusive(const Key& key, ComputeValueFunction computeValue) {
+        return insertHelper(key, computeValue, true);
+    }
+
+    /**
+     * @see FcmmStorage::insertExclusive(const Key&, const InsertHint&, ComputeValueFunction)
+     */
+    template<typename ComputeValueFunction>
+    const Value& insertExclusive(const Key& key, const InsertHint&, ComputeValueFunction computeValue) {
+        return insertExclusive(key, computeValue);
+    }
+
+    /**
+     * @brief Returns the statistics about the storage (the number of entries is counted by scanning the slots).
+     */
+    fcmm::Stats getStats() const {
+        fcmm::Stats stats = fcmm::Stats();
+        for (std::size_t slot = 0; slot < shape.size(); slot++) {
+            if (states[slot].load(std::memory_order_relaxed) == READY) {
+                stats.numEntries++;
+            }
+        }
+        stats.numAvoidedComputations = numAvoidedComputations.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    DenseStorage(const DenseStorage&) = delete;
+    DenseStorage(DenseStorage&&) = delete;
+
+};
+
+// the shared maps of fcmm are not available without memory mappings (see fcmm::SharedFcmm)
+#if defined(CPPMEMO_POSIX) && !defined(FCMM_NO_MMAP)
+
+/**
+ * @brief A storage of the memoized values shared by several processes: the values live in a named shared-memory
+ * region (see fcmm::SharedFcmm), so that a value computed by any process is found by all the processes opening
+ * the storage with the same name, which only compute the values not found.
+ *
+ * Keys and values must be trivially copyable, and all the processes must use the same key function object types.
+ * A value is computed by each thread that does not find it, since threads of other processes cannot be waited for.
+ *
+ * @see FcmmStorage for the interface
+ *
+ * @tparam Key       the type of the key (trivially copyable)
+ * @tparam Value     the type of the value (trivially copyable)
+ * @tparam KeyHash1  the type of a function object that calculates the hash of the key
+ * @tparam KeyHash2  the type of another function object that calculates the hash of the key
+ * @tparam KeyEqual  the type of the function object that checks the equality of the two keys
+ */
+template<
+    typename Key,
+    typename Value,
+    typename KeyHash1 = std::hash<Key>,
+    typename KeyHash2 = fcmm::DefaultKeyHash2<Key>,
+    typename KeyEqual = std::equal_to<Key>
+>
+class SharedStorage {
+
+private:
+
+    fcmm::SharedFcmm<Key, Value, KeyHash1, KeyHash2, KeyEqual> entries;
+    std::atomic<std::size_t> numAvoidedComputations;
+
+public:
+
+    /**
+     * @brief Searches are not resumed by insertions (see FcmmStorage::InsertHint).
+     */
+    struct InsertHint {
+    };
+
+    /**
+     * @brief Constructor: opens the storage having the given name, creating it if it does not exist
+     * (see fcmm::SharedFcmm::SharedFcmm()).
+     *
+     * @param name                 the name of the shared-memory region, e.g. `/my-memo`
+     * @param estimatedNumEntries  an estimate for the number of values that will be stored
+     * @param regionSize           the size of the region (in bytes), bounding the number of values
+     */
+    explicit SharedStorage(const std::string& name, std::size_t estimatedNumEntries = 0,
+                           std::size_t regionSize = fcmm::DEFAULT_SHARED_REGION_SIZE) :
+            entries(name, estimatedNumEntries, regionSize),
+            numAvoidedComputations(0) {
+    }
+
+    /**
+     * @brief Removes the storage having the given name (see fcmm::SharedFcmm::remove())
+     */
+    static bool remove(const std::string& name) {
+        return fcmm::SharedFcmm<Key, Value, KeyHash1, KeyHash2, KeyEqual>::remove(name);
+    }
+
+    /**
+     * @see FcmmStorage::find()
+     */
+    const Value* find(const Key& key) const {
+        return entries.find(key);
+    }
+
+    /**
+     * @see FcmmStorage::find(const Key&, InsertHint&)
+     */
+    const Value* find(const Key& key, InsertHint&) const {
+        return entries.find(key);
+    }
+
+    /**
+     * @see FcmmStorage::findMany()
+     */
+    template<typename ForwardIterator, typename OutputIterator>
+    OutputIterator findMany(ForwardIterator firstKey, ForwardIterator lastKey, OutputIterator result) const {
+        for (; firstKey != lastKey; ++firstKey, ++result) {
+            *result = entries.find(*firstKey);
+        }
+        return result;
+    }
+
+    /**
+     * @see FcmmStorage::operator[]()
+     */
+    const Value& operator[](const Key& key) const {
+        return entries.at(key);
+    }
+
+    /**
+     * @see FcmmStorage::insert()
+     *
+     * @throw std::runtime_error  thrown if the storage is full
+     */
+    const Value& insert(const Key& key, const Value& value) {
+        return *entries.emplace(key, value).first;
+    }
+
+    /**
+     * @see FcmmStorage::insert(const Key&, Value&&)
+     *
+     * @throw std::runtime_error  thrown if the storage is full
+     */
+    const Value& insert(const Key& key, Value&& value) {
+        return *entries.emplace(key, value).first;
+    }
+
+    /**
+     * @see FcmmStorage::insert(const Key&, const InsertHint&, const Value&)
+     */
+    const Value& insert(const Key& key, const InsertHint&, const Value& value) {
+        return insert(key, value);
+    }
+
+    /**
+     * @see FcmmStorage::insert(const Key&, const InsertHint&, Value&&)
+     */
+    const Value& insert(const Key& key, const InsertHint&, Value&& value) {
+        return insert(key, std::move(value));
+    }
+
+    /**
+     * @brief Computes and stores the value for the given key, unless a value is already stored
+     * (a computation is avoided if the value was stored by another thread or process in the meantime).
+     *
+     * @throw std::runtime_error  thrown if the storage is full
+     */
+    template<typename ComputeValueFunction>
+    const Value& insertExclusive(const Key& key, ComputeValueFunction computeValue) {
+        bool computed = false;
+        const Value* value = entries.insert(key, [&computeValue, &computed](const Key& keyToCompute) -> Value {
+            computed = true;
+            return computeValue(keyToCompute);
+        }).first;
+        if (!computed) {
+            numAvoidedComputations.fetch_add(1, std::memory_order_relaxed);
+        }
+        return *value;
+    }
+
+    /**
+     * @see FcmmStorage::insertExclusive(const Key&, const InsertHint&, ComputeValueFunction)
+     */
+    template<typename ComputeValueFunction>
+    const Value& insertExclusive(const Key& key, const InsertHint&, ComputeValueFunction computeValue) {
+        return insertExclusive(key, computeValue);
+    }
+
+    /**
+     * @brief Returns the statistics about the storage, including the values stored by the other processes
+     * (the avoided computations are the ones of this process).
+     */
+    fcmm::Stats getStats() const {
+        fcmm::Stats stats = entries.getStats();
+        stats.numAvoidedComputations = numAvoidedComputations.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    SharedStorage(const SharedStorage&) = delete;
+    SharedStorage(SharedStorage&&) = delete;
+
+};
+
+#endif
+
+#ifdef CPPMEMO_POSIX
+
+/**
+ * @brief Time (in seconds) a ShardedStorage waits for the other shards to start listening on their sockets
+ */
+const int SHARD_CONNECT_TIMEOUT = 30;
+
+/**
+ * @brief A storage of the memoized values partitioned among several processes (the shards), connected by Unix domain
+ * sockets: each shard owns the keys whose first hash modulo the number of shards is its index, and fetches the values
+ * of the other keys from their owners, caching them. Values are computed by their owners through
+ * CppMemo::tabulateSharded(), which fetches the prerequisites of each batch of keys at once.
+ *
+ * The shards find each other through sockets named after their indices in a common directory. Requests are tagged
+ * with an identifier and pipelined: a fetch does not hold the socket while the owner replies, and a reader thread per
+ * socket hands each reply over to the fetch awaiting it, so that the parallel chunks of a level fetch at once.
+ * Each shard answers the requests of the other shards with a thread per shard, waiting for the values not computed
+ * yet. A request carries the number of levels the requesting shard has completed (see completeLevel()): as the keys
+ * requested by tabulateSharded() belong to previous levels, their owner either computes them by the time it has
+ * completed as many levels, or answers that they are not found.
+ * The shards may run on different machines sharing the directory only if their sockets can be reached, which
+ * is seldom the case: the storage is meant to spread a computation over the processes (or NUMA nodes) of one host.
+ *
+ * Keys and values are sent as bytes by `fcmm::Serializer`.
+ *
+ * @see FcmmStorage for the interface
+ *
+ * @tparam Key       the type of the key
+ * @tparam Value     the type of the value
+ * @tparam KeyHash1  the type of a function object that calculates the hash of the key (it also assigns the keys
+ *                   to the shards, so all the shards must use the same one)
+ * @tparam KeyHash2  the type of another function object that calculates the hash of the key
+ * @tparam KeyEqual  the type of the function object that checks the equality of the two keys
+ */
+template<
+    typename Key,
+    typename Value,
+    typename KeyHash1 = std::hash<Key>,
+    typename KeyHash2 = fcmm::DefaultKeyHash2<Key>,
+    typename KeyEqual = std::equal_to<Key>
+>
+class ShardedStorage {
+
+private:
+
+    typedef FcmmStorage<Key, Value, KeyHash1, KeyHash2, KeyEqual> LocalStorage;
+
+    // the values owned by this shard, and the ones fetched from the other shards
+    LocalStorage entries;
+
+    KeyHash1 keyHash1;
+    std::size_t numShards;
+    std::size_t shardIndex;
+
+    /**
+     * @brief A reply awaited by a fetch
+     */
+    struct Reply {
+        bool received;
+        std::string message;
+    };
+
+    /**
+     * @brief The requests sent to another shard, whose replies are awaited
+     */
+    struct Channel {
+
+        std::mutex writeMutex; // a request is written at once
+        std::mutex repliesMutex;
+        std::condition_variable repliesCondition; // notified when a reply is received, or the channel breaks
+        std::unordered_map<std::uint64_t, Reply*> awaitedReplies; // guarded by repliesMutex
+        std::uint64_t nextRequestId; // guarded by repliesMutex
+        bool broken; // guarded by repliesMutex: no more requests can be sent
+
+        Channel() : nextRequestId(0), broken(false) {
+        }
+
+    };
+
+    std::vector<int> requestSockets; // connected to the other shards (-1 for this shard)
+    std::unique_ptr<Channel[]> channels;
+    std::vector<std::thread> readers; // receive the replies of the other shards
+    std::vector<int> replySockets; // connected to the other shards, which send their requests on them
+    std::vector<std::thread> servers;
+
+    std::mutex levelMutex;
+    std::condition_variable levelCondition; // notified when a level is completed, or the shard is closing
+    std::atomic<std::uint64_t> numCompletedLevels;
+    std::atomic<bool> closing;
+
+    std::atomic<std::size_t> numFetchedValues;
+
+    static std::string getSocketPath(const std::string& socketDirectory, std::size_t shardIndex) {
+        return socketDirectory + "/cppmemo-shard-" + std::to_string(shardIndex) + ".sock";
+    }
+
+    static sockaddr_un getSocketAddress(const std::string& path) {
+        sockaddr_un address = sockaddr_un();
+        if (path.size() >= sizeof(address.sun_path)) {
+            throw std::runtime_error("The socket path is too long: " + path);
+        }
+        address.sun_family = AF_UNIX;
+        path.copy(address.sun_path, path.size());
+        return address;
+    }
+
+    static bool writeAll(int socket, const char* bytes, std::size_t size) {
+#ifdef MSG_NOSIGNAL
+        const int flags = MSG_NOSIGNAL; // a shard that has exited is an error, not a signal
+#else
+        const int flags = 0;
+#endif
+        while (size != 0) {
+            const ssize_t written = send(socket, bytes, size, flags);
+            if (written < 0 && errno == EINTR) {
+                continue;
+            }
+            if (written <= 0) {
+                return false;
+            }
+            bytes += written;
+            size -= (std::size_t) written;
+        }
+        return true;
+    }
+
+    static bool readAll(int socket, char* bytes, std::size_t size) {
+        while (size != 0) {
+            const ssize_t numRead = recv(socket, bytes, size, 0);
+            if (numRead < 0 && errno == EINTR) {
+                continue;
+            }
+            if (numRead <= 0) {
+                return false;
+            }
+            bytes += numRead;
+            size -= (std::size_t) numRead;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Sends a message: its size (a 64-bit integer), followed by its bytes
+     */
+    static bool writeMessage(int socket, const std::string& message) {
+        const std::uint64_t size = message.size();
+        return writeAll(socket, reinterpret_cast<const char*>(&size), sizeof(size)) &&
+               writeAll(socket, message.data(), message.size());
+    }
+
+    static bool readMessage(int socket, std::string& message) {
+        std::uint64_t size;
+        if (!readAll(socket, reinterpret_cast<char*>(&size), sizeof(size))) {
+            return false;
+        }
+        message.resize((std::size_t) size);
+        return size == 0 || readAll(socket, &message[0], (std::size_t) size);
+    }
+
+    /**
+     * @brief Appends an object to a message: its size (a 32-bit integer), followed by its bytes
+     */
+    template<typename T>
+    static void appendObject(const T& object, std::string& message) {
+        const std::size_t sizeOffset = message.size();
+        message.append(sizeof(std::uint32_t), '\0');
+        fcmm::Serializer<T>::serialize(object, message);
+        const std::uint32_t size = (std::uint32_t) (message.size() - sizeOffset - sizeof(std::uint32_t));
+        std::memcpy(&message[sizeOffset], &size, sizeof(size));
+    }
+
+    /**
+     * @brief Reads the next object of a message, advancing `offset`
+     *
+     * @throw std::runtime_error  thrown if the message is truncated
+     */
+    template<typename T>
+    static T readObject(const std::string& message, std::size_t& offset) {
+        std::uint32_t size;
+        if (message.size() - offset < sizeof(size)) {
+            throw std::runtime_error("Truncated shard message");
+        }
+        std::memcpy(&size, message.data() + offset, sizeof(size));
+        offset += sizeof(size);
+        if (message.size() - offset < size) {
+            throw std::runtime_error("Truncated shard message");
+        }
+        offset += size;
+        return fcmm::Serializer<T>::deserialize(message.data() + offset - size, size);
+    }
+
+    /**
+     * @brief Waits until the value of an owned key is stored, or until this shard has completed
+     * `numRequesterLevels` levels without storing it, in which case `value` is set to `nullptr`
+     *
+     * @return `false` if this shard is destructed meanwhile
+     */
+    bool waitForValue(const Key& key, std::uint64_t numRequesterLevels, const Value*& value) {
+        while (true) {
+            const std::uint64_t numLevels = numCompletedLevels.load(std::memory_order_acquire);
+            value = entries.find(key);
+            if (value != nullptr || numLevels >= numRequesterLevels) {
+                return true;
+            }
+            std::unique_lock<std::mutex> lock(levelMutex);
+            if (closing.load(std::memory_order_relaxed)) {
+                return false;
+            }
+            levelCondition.wait(lock, [this, numLevels]() {
+                return numCompletedLevels.load(std::memory_order_relaxed) != numLevels ||
+                       closing.load(std::memory_order_relaxed);
+            });
+        }
+    }
+
+    /**
+     * @brief Answers the requests of another shard, in order, until it closes its socket or this shard
+     * is destructed. A request holds its identifier, the number of levels completed by the requesting shard
+     * and the keys; the reply holds the identifier, whether all the keys were found, and their values.
+     */
+    void serve(int socket) {
+
+        std::string request;
+        std::string reply;
+        std::string values;
+
+        try {
+
+            while (readMessage(socket, request)) {
+
+                std::size_t offset = 0;
+                const std::uint64_t requestId = readObject<std::uint64_t>(request, offset);
+                const std::uint64_t numRequesterLevels = readObject<std::uint64_t>(request, offset);
+
+                values.clear();
+                bool found = true;
+                while (found && offset != request.size()) {
+                    const Key key = readObject<Key>(request, offset);
+                    const Value* value;
+                    if (!waitForValue(key, numRequesterLevels, value)) {
+                        shutdown(socket, SHUT_RDWR); // the requesting shard will not wait for the reply
+                        return;
+                    }
+                    if (value != nullptr) {
+                        appendObject(*value, values);
+                    } else {
+                        found = false;
+                    }
+                }
+
+                reply.clear();
+                appendObject(requestId, reply);
+                appendObject((std::uint8_t) found, reply);
+                if (found) {
+                    reply += values;
+                }
+                if (!writeMessage(socket, reply)) {
+                    break;
+                }
+
+            }
+
+        } catch (const std::exception&) { // a malformed request
+        }
+
+        shutdown(socket, SHUT_RDWR);
+
+    }
+
+    /**
+     * @brief Marks the channel to a shard as broken, waking the fetches awaiting its replies
+     */
+    void breakChannel(std::size_t ownerIndex) {
+        Channel& channel = channels[ownerIndex];
+        std::lock_guard<std::mutex> lock(channel.repliesMutex);
+        channel.broken = true;
+        channel.repliesCondition.notify_all();
+    }
+
+    /**
+     * @brief Receives the replies of a shard, handing each of them over to the fetch awaiting it,
+     * until the socket is closed. The replies no longer awaited (by a fetch that has thrown) are dropped.
+     */
+    void receiveReplies(std::size_t ownerIndex) {
+        Channel& channel = channels[ownerIndex];
+        std::string message;
+        while (readMessage(requestSockets[ownerIndex], message)) {
+            std::uint64_t requestId;
+            try {
+                std::size_t offset = 0;
+                requestId = readObject<std::uint64_t>(message, offset);
+            } catch (const std::exception&) { // a malformed reply
+                break;
+            }
+            std::lock_guard<std::mutex> lock(channel.repliesMutex);
+            const auto awaitedIt = channel.awaitedReplies.find(requestId);
+            if (awaitedIt != channel.awaitedReplies.end()) {
+                awaitedIt->second->message.swap(message);
+                awaitedIt->second->received = true;
+                channel.awaitedReplies.erase(awaitedIt);
+                channel.repliesCondition.notify_all();
+            }
+        }
+        shutdown(requestSockets[ownerIndex], SHUT_RDWR);
+        breakChannel(ownerIndex);
+    }
+
+    void closeSockets() {
+        for (int socket : requestSockets) {
+            if (socket >= 0) {
+                close(socket);
+            }
+        }
+        for (int socket : replySockets) {
+            if (socket >= 0) {
+                close(socket);
+            }
+        }
+    }
+
+    /**
+     * @brief Connects this shard to all the others: each shard listens on its socket, connects to the sockets
+     * of the others (sending its index), then accepts their connections
+     */
+    void connectShards(const std::string& socketDirectory) {
+
+        const std::string path = getSocketPath(socketDirectory, shardIndex);
+        const sockaddr_un address = getSocketAddress(path);
+
+        const int listeningSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+        unlink(path.c_str()); // left over by a previous run
+        if (listeningSocket < 0 || bind(listeningSocket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+                listen(listeningSocket, (int) numShards) != 0) {
+            if (listeningSocket >= 0) {
+                close(listeningSocket);
+            }
+            throw std::runtime_error("Cannot listen on the socket: " + path);
+        }
+
+        try {
+
+            const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() +
+                                                                     std::chrono::seconds(SHARD_CONNECT_TIMEOUT);
+
+            for (std::size_t otherShardIndex = 0; otherShardIndex < numShards; otherShardIndex++) {
+                if (otherShardIndex == shardIndex) {
+                    continue;
+                }
+                const std::string otherPath = getSocketPath(socketDirectory, otherShardIndex);
+                const sockaddr_un otherAddress = getSocketAddress(otherPath);
+                while (true) { // the other shard may not be listening yet
+                    const int requestSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+                    if (requestSocket < 0) {
+                        throw std::runtime_error("Cannot create a socket");
+                    }
+                    if (connect(requestSocket, reinterpret_cast<const sockaddr*>(&otherAddress), sizeof(otherAddress)) == 0) {
+                        requestSockets[otherShardIndex] = requestSocket;
+                        break;
+                    }
+                    close(requestSocket);
+                    if (std::chrono::steady_clock::now() > deadline) {
+                        throw std::runtime_error("Cannot connect to the socket: " + otherPath);
+                    }
+                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                }
+                const std::uint64_t index = shardIndex;
+                if (!writeAll(requestSockets[otherShardIndex], reinterpret_cast<const char*>(&index), sizeof(index))) {
+                    throw std::runtime_error("Cannot connect to the socket: " + otherPath);
+                }
+            }
+
+            for (std::size_t numAccepted = 0; numAccepted < numShards - 1; numAccepted++) {
+                const int replySocket = accept(listeningSocket, nullptr, nullptr);
+                std::uint64_t index;
+                if (replySocket < 0 || !readAll(replySocket, reinterpret_cast<char*>(&index), sizeof(index)) ||
+                        index >= numShards || index == shardIndex || replySockets[index] >= 0) {
+                    if (replySocket >= 0) {
+                        close(replySocket);
+                    }
+                    throw std::runtime_error("Cannot accept the connection of a shard on the socket: " + path);
+                }
+                replySockets[index] = replySocket;
+            }
+
+        } catch (...) {
+            close(listeningSocket);
+            unlink(path.c_str());
+            throw;
+        }
+
+        close(listeningSocket);
+        unlink(path.c_str()); // all the shards have connected
+
+    }
+
+public:
+
+    /**
+     * @brief Where the search for a key ended (see FcmmStorage::InsertHint).
+     */
+    typedef typename LocalStorage::InsertHint InsertHint;
+
+    /**
+     * @brief Constructor: connects to the other shards, waiting (up to `SHARD_CONNECT_TIMEOUT` seconds) for them to start.
+     *
+     * @param socketDirectory      the directory of the sockets of the shards (the same for all of them)
+     * @param numShards            the number of shards
+     * @param shardIndex           the index of this shard, in `[0, numShards)`
+     * @param estimatedNumEntries  an estimate for the number of values that will be stored by this shard,
+     *                             including the fetched ones
+     *
+     * @throw std::logic_error     thrown if the index of the shard is invalid
+     * @throw std::runtime_error   thrown if the shards cannot be connected
+     */
+    ShardedStorage(const std::string& socketDirectory, std::size_t numShards, std::size_t shardIndex,
+                   std::size_t estimatedNumEntries = 0) :
+            entries(estimatedNumEntries),
+            numShards(numShards),
+            shardIndex(shardIndex),
+            requestSockets(numShards, -1),
+            channels(new Channel[numShards]),
+            replySockets(numShards, -1),
+            numCompletedLevels(0),
+            closing(false),
+            numFetchedValues(0) {
+
+        if (shardIndex >= numShards) {
+            throw std::logic_error("Invalid shard index");
+        }
+
+        try {
+            connectShards(socketDirectory);
+        } catch (...) {
+            closeSockets();
+            throw;
+        }
+
+        for (std::size_t otherShardIndex = 0; otherShardIndex < numShards; otherShardIndex++) {
+            if (otherShardIndex != shardIndex) {
+                const int replySocket = replySockets[otherShardIndex];
+                servers.push_back(std::thread([this, replySocket]() {
+                    serve(replySocket);
+                }));
+                readers.push_back(std::thread([this, otherShardIndex]() {
+                    receiveReplies(otherShardIndex);
+                }));
+            }
+        }
+
+    }
+
+    /**
+     * @brief Destructor: waits for the other shards to stop requesting values from this shard
+     * (i.e. to be destructed as well).
+     */
+    ~ShardedStorage() {
+        for (int socket : requestSockets) {
+            if (socket >= 0) {
+                shutdown(socket, SHUT_RDWR); // the other shards stop serving this shard, and the readers stop
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(levelMutex);
+            closing.store(true, std::memory_order_relaxed);
+            levelCondition.notify_all();
+        }
+        for (std::thread& reader : readers) {
+            reader.join();
+        }
+        for (std::thread& server : servers) {
+            server.join();
+        }
+        closeSockets();
+    }
+
+    /**
+     * @brief Returns the number of shards
+     */
+    std::size_t getNumShards() const {
+        return numShards;
+    }
+
+    /**
+     * @brief Returns the index of this shard
+     */
+    std::size_t getShardIndex() const {
+        return shardIndex;
+    }
+
+    /**
+     * @brief Returns the index of the shard owning the given key
+     */
+    std::size_t getShardIndex(const Key& key) const {
+        return keyHash1(key) % numShards;
+    }
+
+    /**
+     * @brief Returns `true` if the given key is owned by this shard
+     */
+    bool owns(const Key& key) const {
+        return getShardIndex(key) == shardIndex;
+    }
+
+    /**
+     * @brief Records that this shard has completed a level of tabulateSharded(): the other shards stop waiting
+     * for the values of the keys of that level that it has not stored.
+     */
+    void completeLevel() {
+        std::lock_guard<std::mutex> lock(levelMutex);
+        numCompletedLevels.fetch_add(1, std::memory_order_release);
+        levelCondition.notify_all();
+    }
+
+    /**
+     * @brief Fetches the values of the given keys that are not stored yet from the shards owning them,
+     * storing them. A request is sent to each shard before any reply is awaited, so that the shards serve
+     * the requests at once; the sockets are not held while awaiting the replies, so that concurrent fetches
+     * are pipelined.
+     *
+     * An owner waits for the value of a key until it has completed as many levels as this shard
+     * (see completeLevel()): the keys requested by tabulateSharded() belong to previous levels.
+     *
+     * @throw std::out_of_range    thrown if one of the keys is not stored by its owner once it has completed
+     *                             as many levels as this shard (or if it is owned by this shard, but not stored)
+     * @throw std::runtime_error   thrown if a shard cannot be reached, or has sent an invalid reply
+     */
+    void fetchMany(const std::vector<Key>& keys) {
+
+        std::vector<std::vector<Key> > requestedKeys(numShards);
+        std::unordered_set<Key, KeyHash1, KeyEqual> requestedKeysSet;
+
+        for (const Key& key : keys) {
+            if (entries.find(key) != nullptr) {
+                continue;
+            }
+            const std::size_t ownerIndex = getShardIndex(key);
+            if (ownerIndex == shardIndex) {
+                throw std::out_of_range("Entry not found");
+            }
+            if (requestedKeysSet.insert(key).second) {
+                requestedKeys[ownerIndex].push_back(key);
+            }
+        }
+
+        std::vector<Reply> replies(numShards, Reply { false, std::string() });
+        std::vector<std::uint64_t> requestIds(numShards);
+
+        // if the fetch throws, the replies still awaited are dropped when they are received
+        struct AwaitedRepliesGuard {
+            ShardedStorage& storage;
+            const std::vector<std::uint64_t>& requestIds;
+            std::vector<std::size_t> ownerIndices;
+            ~AwaitedRepliesGuard() {
+                for (std::size_t ownerIndex : ownerIndices) {
+                    Channel& channel = storage.channels[ownerIndex];
+                    std::lock_guard<std::mutex> lock(channel.repliesMutex);
+                    channel.awaitedReplies.erase(requestIds[ownerIndex]);
+                }
+            }
+        } awaitedRepliesGuard { *this, requestIds, std::vector<std::size_t>() };
+        awaitedRepliesGuard.ownerIndices.reserve(numShards); // so that recording an awaited reply does not throw
+
+        const std::uint64_t numLevels = numCompletedLevels.load(std::memory_order_relaxed);
+        std::string message;
+
+        for (std::size_t ownerIndex = 0; ownerIndex < numShards; ownerIndex++) {
+            if (!requestedKeys[ownerIndex].empty()) {
+                Channel& channel = channels[ownerIndex];
+                {
+                    std::lock_guard<std::mutex> lock(channel.repliesMutex);
+                    if (channel.broken) {
+                        throw std::runtime_error("Cannot send a request to shard " + std::to_string(ownerIndex));
+                    }
+                    requestIds[ownerIndex] = channel.nextRequestId++;
+                    channel.awaitedReplies[requestIds[ownerIndex]] = &replies[ownerIndex];
+                }
+                awaitedRepliesGuard.ownerIndices.push_back(ownerIndex);
+                message.clear();
+                appendObject(requestIds[ownerIndex], message);
+                appendObject(numLevels, message);
+                for (const Key& key : requestedKeys[ownerIndex]) {
+                    appendObject(key, message);
+                }
+                std::lock_guard<std::mutex> lock(channel.writeMutex);
+                if (!writeMessage(requestSockets[ownerIndex], message)) {
+                    // a partially written request would be misread: no more requests can be sent to the shard
+                    shutdown(requestSockets[ownerIndex], SHUT_RDWR);
+                    breakChannel(ownerIndex);
+                    throw std::runtime_error("Cannot send a request to shard " + std::to_string(ownerIndex));
+                }
+            }
+        }
+
+        for (std::size_t ownerIndex : awaitedRepliesGuard.ownerIndices) {
+            Channel& channel = channels[ownerIndex];
+            Reply& reply = replies[ownerIndex];
+            {
+                std::unique_lock<std::mutex> lock(channel.repliesMutex);
+                channel.repliesCondition.wait(lock, [&channel, &reply]() { return reply.received || channel.broken; });
+                if (!reply.received) {
+                    throw std::runtime_error("Cannot receive a reply from shard " + std::to_string(ownerIndex));
+                }
+            }
+            std::size_t offset = 0;
+            readObject<std::uint64_t>(reply.message, offset); // the identifier of the request
+            if (readObject<std::uint8_t>(reply.message, offset) == 0) {
+                throw std::out_of_range("Entry not found");
+            }
+            for (const Key& key : requestedKeys[ownerIndex]) {
+                entries.insert(key, readObject<Value>(reply.message, offset));
+            }
+            numFetchedValues.fetch_add(requestedKeys[ownerIndex].size(), std::memory_order_relaxed);
+        }
+
+    }
+
+    /**
+     * @brief Returns the value stored for the given key, fetching it from the shard owning it if needed.
+     *
+     * @throw std::out_of_range    thrown if the key is not stored by its owner (see fetchMany())
+     * @throw std::runtime_error   thrown if the owner of the key cannot be reached
+     */
+    const Value& fetch(const Key& key) {
+        const Value* value = entries.find(key);
+        if (value == nullptr) {
+            fetchMany(std::vector<Key>(1, key));
+            value = entries.find(key);
+        }
+        return *value;
+    }
+
+    /**
+     * @brief Returns the number of values fetched from the other shards
+     */
+    std::size_t getNumFetchedValues() const {
+        return numFetchedValues.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @see FcmmStorage::find()
+     */
+    const Value* find(const Key& key) const {
+        return entries.find(key);
+    }
+
+    /**
+     * @see FcmmStorage::find(const Key&, InsertHint&)
+     */
+    const Value* find(const Key& key, InsertHint& hint) const {
+        return entries.find(key, hint);
+    }
+
+    /**
+     * @see FcmmStorage::findMany()
+     */
+    template<typename ForwardIterator, typename OutputIterator>
+    OutputIterator findMany(ForwardIterator firstKey, ForwardIterator lastKey, OutputIterator result) const {
+        return entries.findMany(firstKey, lastKey, result);
+    }
+
+    /**
+     * @see FcmmStorage::operator[]()
+     */
+    const Value& operator[](const Key& key) const {
+        return entries[key];
+    }
+
+    /**
+     * @see FcmmStorage::insert()
+     */
+    const Value& insert(const Key& key, const Value& value) {
+        return entries.insert(key, value);
+    }
+
+    /**
+     * @see FcmmStorage::insert(const Key&, Value&&)
+     */
+    const Value& insert(const Key& key, Value&& value) {
+        return entries.insert(key, std::move(value));
+    }
+
+    /**
+     * @see FcmmStorage::insert(const Key&, const InsertHint&, const Value&)
+     */
+    const Value& insert(const Key& key, const InsertHint& hint, const Value& value) {
+        return entries.insert(key, hint, value);
+    }
+
+    /**
+     * @see FcmmStorage::insert(const Key&, const InsertHint&, Value&&)
+     */
+    const Value& insert(const Key& key, const InsertHint& hint, Value&& value) {
+        return entries.insert(key, hint, std::move(value));
+    }
+
+    /**
+     * @see FcmmStorage::insertExclusive()
+     */
+    template<typename ComputeValueFunction>
+    const Value& insertExclusive(const Key& key, ComputeValueFunction computeValue) {
+        return entries.insertExclusive(key, computeValue);
+    }
+
+    /**
+     * @see FcmmStorage::insertExclusive(const Key&, const InsertHint&, ComputeValueFunction)
+     */
+    template<typename ComputeValueFunction>
+    const Value& insertExclusive(const Key& key, const InsertHint& hint, ComputeValueFunction computeValue) {
+        return entries.insertExclusive(key, hint, computeValue);
+    }
+
+    /**
+     * @brief Returns the statistics about the storage (the entries include the fetched values).
+     */
+    fcmm::Stats getStats() const {
+        return entries.getStats();
+    }
+
+    ShardedStorage(const ShardedStorage&) = delete;
+    ShardedStorage(ShardedStorage&&) = delete;
+
+};
+
+#endif // CPPMEMO_POSIX
+
+/**
+ * @brief This class implements a generic framework for memoization supporting
+ * automatic parallel execution.
+ * 
+ * Please read the documentation on the project website: http://projects.giacomodrago.com/c++memo
+ *
+ * @tparam Key       the type of the key (default-constructible and copy-constructible)
+ * @tparam Value     the type of the value (move-constructible: the computed values are constructed in the storage;
+ *                   also default-constructible, since dry runs return a default value for missing prerequisites)
+ * @tparam KeyHash1  the type of a function object that calculates the hash of the key;
+ *                   it should have the same interface as
+ *                   <a href="http://en.cppreference.com/w/cpp/utility/hash">std::hash<T></a>
+ * @tparam KeyHash2  the type of another function object that calculates the hash of the key:
+ *                   it should be <i>completely independent from KeyHash1</i>;
+ *                   the default for this template parameter is only available for
+ *                   <a href="http://en.cppreference.com/w/cpp/types/is_integral">integral types</a>.
+ * @tparam KeyEqual  the type of the function object that checks the equality of the two keys;
+ *                   it should have the same interface as
+ *                   <a href="http://en.cppreference.com/w/cpp/utility/functional/equal_to">std::equal_to<T></a>
+ * @tparam Storage   the type of the storage of the memoized values (see FcmmStorage, DenseStorage, SharedStorage
+ *                   and ShardedStorage);
+ *                   the hash functions are still used to track keys during the computations
+ */
+template<
+    typename Key,
+    typename Value,
+    typename KeyHash1 = std::hash<Key>,
+    typename KeyHash2 = fcmm::DefaultKeyHash2<Key>,
+    typename KeyEqual = std::equal_to<Key>,
+    typename Storage = FcmmStorage<Key, Value, KeyHash1, KeyHash2, KeyEqual>
+>
+class CppMemo {
+    
+private:
+    
+    typedef Storage Values;
+    
+    int defaultNumThreads;
+    Values values;
+    bool detectCircularDependencies;
+    ExecutionMode executionMode;
+
+    std::shared_ptr<ThreadPool> threadPool; // guarded by threadPoolMutex
+    bool ownsThreadPool;
+    std::mutex threadPoolMutex;
+    
+    /**
+     * @brief The prerequisites requested by dry runs of the `Compute` function, in order, along with the values
+     * found for them, so that the final computations can be provided with their prerequisites by position
+     * rather than by looking them up again.
+     */
+    class PrerequisitesRecord {
+
+    public:
+
+        struct Entry {
+            Key key;
+            const Value* value; // nullptr if the prerequisite was missing and has not been resolved yet
+        };
+
+    private:
+
+        std::vector<Entry> entries;
+        std::size_t nextReplayed;
+        std::size_t endReplayed;
+        KeyEqual keyEqual;
+
+    public:
+
+        PrerequisitesRecord() : nextReplayed(0), endReplayed(0), keyEqual() {
+        }
+
+        std::size_t size() const {
+            return entries.size();
+        }
+
+        void add(const Key& key, const Value* value) {
+            entries.push_back({ key, value });
+        }
+
+        /**
+         * @brief Resolves the last unresolved entry before `end`, returning its index
+         */
+        std::size_t resolveLast(std::size_t end, const Value& value) {
+            do {
+                end--;
+            } while (entries[end].value != nullptr);
+            entries[end].value = &value;
+            return end;
+        }
+
+        /**
+         * @brief Returns the index of the first unresolved entry from `first` onwards
+         */
+        std::size_t findUnresolved(std::size_t first) const {
+            while (entries[first].value != nullptr) {
+                first++;
+            }
+            return first;
+        }
+
+        /**
+         * @brief Resolves the entry at `index`
+         */
+        void resolve(std::size_t index, const Value& value) {
+            entries[index].value = &value;
+        }
+
+        /**
+         * @brief Makes the entries from `first` onwards be replayed
+         */
+        void replay(std::size_t first) {
+            nextReplayed = first;
+            endReplayed = entries.size();
+        }
+
+        /**
+         * @brief Stops replaying, and discards the entries from `first` onwards
+         */
+        void discard(std::size_t first) {
+            nextReplayed = endReplayed = 0;
+            entries.erase(entries.begin() + first, entries.end());
+        }
+
+        /**
+         * @brief Returns the value of the next replayed entry if it has the given key and has been resolved,
+         * `nullptr` otherwise. Replaying stops as soon as the keys are requested in a different order.
+         */
+        const Value* replayNext(const Key& key) {
+            if (nextReplayed != endReplayed) {
+                const Entry& entry = entries[nextReplayed];
+                if (keyEqual(entry.key, key)) {
+                    nextReplayed++;
+                    return entry.value;
+                }
+                nextReplayed = endReplayed;
+            }
+            return nullptr;
+        }
+
+    };
+
     class ThreadItemsStack {
         
     public:
@@ -155,8 +2128,6 @@ private:
         
     private:
         
-        int threadNo;
-        std::minstd_rand randGen;
         std::size_t groupSize;
         bool detectCircularDependencies;
 
@@ -174,9 +2145,8 @@ private:
         
     public:
         
-        ThreadItemsStack(int threadNo, bool detectCircularDependencies) :
-                threadNo(threadNo), randGen(threadNo), groupSize(0),
-                detectCircularDependencies(detectCircularDependencies) {
+        ThreadItemsStack(bool detectCircularDependencies) :
+                groupSize(0), detectCircularDependencies(detectCircularDependencies) {
         }
         
         void push(const Key& key) {
@@ -201,15 +2171,6 @@ private:
         }
 
         void finalizeGroup() {
-            if (threadNo != 0 && groupSize > 1) {
-                if (threadNo == 1) {
-                    // reverse the added prerequisites of improving parallel speedup
-                    std::reverse(items.end() - groupSize, items.end());
-                } else {
-                    // shuffle the added prerequisites of improving parallel speedup
-                    std::shuffle(items.end() - groupSize, items.end(), randGen);                    
-                }
-            }
             if (detectCircularDependencies) {
                 for (std::size_t i = 1; i <= groupSize; i++) {
                     const Item& addedItem = *(items.end() - i);
@@ -230,6 +2191,10 @@ private:
         Item& back() {
             return items.back();
         }
+
+        std::size_t size() const {
+            return items.size();
+        }
         
         std::size_t getGroupSize() const {
             return groupSize;
@@ -245,103 +2210,661 @@ public:
      */
     class PrerequisitesProvider {
         
-        friend class CppMemo<Key, Value, KeyHash1, KeyHash2, KeyEqual>;
+        friend class CppMemo<Key, Value, KeyHash1, KeyHash2, KeyEqual, Storage>;
         
     private:
 
-        enum Mode { NORMAL, DRY_RUN };
+        enum Mode { NORMAL, DRY_RUN };
+
+        const Values& values;
+        std::vector<Key>& missingPrerequisites;
+        Mode mode;
+
+        // dry runs append to the record, computations replay it (a pointer, since providers are passed by value)
+        PrerequisitesRecord* record;
+
+        PrerequisitesProvider(const Values& values, std::vector<Key>& missingPrerequisites,
+                              PrerequisitesRecord* record = nullptr) :
+                values(values), missingPrerequisites(missingPrerequisites), mode(NORMAL), record(record) {
+        }
+
+        // the invalid value returned by dry runs (shared, since providers are passed by value)
+        static const Value& getDummyValue() {
+            static const Value dummyValue = Value();
+            return dummyValue;
+        }
+
+        void setMode(Mode mode) {
+            this->mode = mode;
+        }
+
+    public:
+
+        /**
+         * @brief Provides the value corresponding to the given key.
+         *
+         * <span style="font-weight: bold; color: red">Important note</span>.
+         * If a `CppMemo::getValue()` overload was called that does not accept a
+         * `DeclarePrerequisites` function, then this method may return an invalid, default-constructed value,
+         * and "track" the request as an indirect means to gather prerequisites of a given key
+         * (via a dry run of the `Compute` funtion).
+         *
+         * @see `CppMemo::getValue()`
+         *
+         * @param  key the requested key
+         *
+         * @return the value corresponding to the requested key, or an invalid, default-constructed value
+         *         (if dry running the `Compute` function)
+         */
+        const Value& operator()(const Key& key) {
+            if (mode == NORMAL) {
+                if (record != nullptr) {
+                    const Value* value = record->replayNext(key);
+                    if (value != nullptr) {
+                        return *value; // no need to look the key up
+                    }
+                }
+                return values[key];
+            } else { // dry running
+                const Value* value = values.find(key);
+                if (record != nullptr) {
+                    record->add(key, value);
+                }
+                if (value == nullptr) {
+                    missingPrerequisites.push_back(key);
+                    return getDummyValue(); // return an invalid value
+                } else {
+                    return *value; // return a valid value
+                }
+            }
+        }
+
+    };
+
+    /**
+     * @brief The function object gathering prerequisites from the `DeclarePrerequisites` function
+     * passed to an appropriate `CppMemo::getValue()` overload.
+     */
+    class PrerequisitesGatherer {
+
+        friend class CppMemo<Key, Value, KeyHash1, KeyHash2, KeyEqual, Storage>;
+
+    private:
+
+        const Values& values;
+        std::vector<Key>& missingPrerequisites;
+
+        PrerequisitesGatherer(const Values& values, std::vector<Key>& missingPrerequisites) :
+                values(values), missingPrerequisites(missingPrerequisites) {
+        }
+
+    public:
+
+        /**
+         * @brief Gathers a prerequisite.
+         *
+         * @param key a prerequisite key
+         */
+        void operator()(const Key& key) {
+            if (values.find(key) == nullptr) {
+                missingPrerequisites.push_back(key);
+            }
+        }
+
+        /**
+         * @brief Gathers the prerequisites in the range [firstKey, lastKey).
+         *
+         * The prerequisites are looked up in batches, so that the cache misses of their lookups overlap
+         * (see fcmm::Fcmm::findMany()): this pays off when they are scattered across a storage much larger
+         * than the cache, while prerequisites whose lookups hit the cache are better gathered one at a time.
+         *
+         * @param firstKey the first prerequisite key
+         * @param lastKey  the end of the range of prerequisite keys
+         */
+        template<typename ForwardIterator>
+        void operator()(ForwardIterator firstKey, ForwardIterator lastKey) {
+            const Value* found[fcmm::BATCH_SIZE];
+            while (firstKey != lastKey) {
+                ForwardIterator batchEnd = firstKey;
+                std::size_t batchSize = 0;
+                for (; batchEnd != lastKey && batchSize < fcmm::BATCH_SIZE; ++batchEnd, batchSize++);
+                values.findMany(firstKey, batchEnd, found);
+                for (std::size_t i = 0; i < batchSize; i++, ++firstKey) {
+                    if (found[i] == nullptr) {
+                        missingPrerequisites.push_back(*firstKey);
+                    }
+                }
+            }
+        }
+
+    };
+
+    /**
+     * @brief The function object collecting keys from the `EnumerateKeys` function
+     * passed to a `CppMemo::tabulate()` overload.
+     */
+    class KeysEnumerator {
+
+        friend class CppMemo<Key, Value, KeyHash1, KeyHash2, KeyEqual, Storage>;
+
+    private:
+
+        std::vector<Key> level;
+        std::size_t maxLevelSize; // a level may be flushed early if it has no parallelism to exploit
+        std::function<void(const std::vector<Key>&)> computeLevel;
+
+        KeysEnumerator(std::size_t maxLevelSize, std::function<void(const std::vector<Key>&)> computeLevel) :
+                maxLevelSize(maxLevelSize), computeLevel(computeLevel) {
+        }
+
+        void flush() {
+            if (!level.empty()) {
+                computeLevel(level);
+                level.clear();
+            }
+        }
+
+    public:
+
+        /**
+         * @brief Enumerates a key of the current level.
+         *
+         * All the prerequisites of the key must belong to previous levels.
+         *
+         * @param key an enumerated key
+         */
+        void operator()(const Key& key) {
+            level.push_back(key);
+            if (level.size() == maxLevelSize) {
+                flush();
+            }
+        }
+
+        /**
+         * @brief Closes the current level: its keys are computed before any key of the next one.
+         */
+        void nextLevel() {
+            flush();
+        }
+
+    };
+
+private:
+
+    /**
+     * @brief Scheduler for multi-thread executions.
+     *
+     * Every key to be computed is a node of a task graph shared among the threads. A node is expanded (i.e. its
+     * prerequisites are gathered) exactly once, and its missing prerequisites become nodes that any thread can
+     * expand: idle threads steal unexplored subtrees from busy ones through the thread pool. A node is computed
+     * as soon as all its prerequisites have been computed, by the thread completing the last of them.
+     *
+     * In ExecutionMode::COOPERATIVE, expansions and computations are interleaved. In ExecutionMode::DATAFLOW,
+     * the whole graph is discovered first; then the nodes having no prerequisites are computed and the
+     * evaluation proceeds in dataflow order, with no locks since the graph does not change anymore.
+     */
+    template<typename Compute, typename DeclarePrerequisites>
+    class Scheduler {
+
+    private:
+
+        struct Node;
+
+        // no entry of the record of the dependent corresponds to the prerequisite (see Dependent)
+        static const std::size_t NO_SLOT = (std::size_t) -1;
+
+        /**
+         * @brief A node waiting for a prerequisite, and the entry of its record (see PrerequisitesRecord)
+         * resolved by the value of the prerequisite once computed, so that the dependent does not look it up
+         */
+        struct Dependent {
+            Node* node;
+            std::size_t slot; // NO_SLOT if the prerequisites are declared rather than recorded by a dry run
+        };
+
+        struct Node {
+
+            const Key key;
+
+            std::atomic_flag lock;
+            bool computed; // guarded by lock
+            const Value* value; // the stored value, set before the node is marked as computed
+            Dependent firstDependent; // guarded by lock (most nodes have a single dependent)
+            std::vector<Dependent> otherDependents; // guarded by lock
+
+            std::vector<Node*> prerequisites; // only recorded if circular dependency detection is enabled
+            std::atomic<std::size_t> numPendingPrerequisites;
+
+            PrerequisitesRecord record; // the prerequisites requested by the dry run, if any
+
+            Node* previousCreated; // the node created before this one (see createdNodes)
+
+            Node(const Key& key) : key(key), computed(false), value(nullptr), firstDependent({ nullptr, NO_SLOT }),
+                    numPendingPrerequisites(1),
+                    previousCreated(nullptr) {
+                lock.clear();
+            }
+
+            void acquire() {
+                while (lock.test_and_set(std::memory_order_acquire)) {
+                    std::this_thread::yield();
+                }
+            }
+
+            void release() {
+                lock.clear(std::memory_order_release);
+            }
+
+        };
+
+        enum class Action { EXPAND, COMPUTE };
+
+        struct Step {
+            Node* node;
+            Action action;
+        };
+
+        CppMemo& memo;
+        Compute compute;
+        DeclarePrerequisites declarePrerequisites;
+        bool providedDeclarePrerequisites;
+
+        ThreadPool& pool;
+        ThreadPool::TaskGroup* taskGroup;
+
+        // the map of the nodes grows with the graph of the query, not with the estimated size of the memo
+        static const std::size_t INITIAL_NUM_NODES = 1024;
+
+        fcmm::Fcmm<Key, Node*, KeyHash1, KeyHash2, KeyEqual> nodes;
+        std::atomic<Node*> createdNodes; // the last node created, so the nodes are freed without scanning the map
+        Node* root;
+
+        const bool dataflow;
+        bool discovering; // only true while discovering the graph in ExecutionMode::DATAFLOW
+
+        std::mutex readyNodesMutex;
+        std::vector<Node*> readyNodes; // the nodes having no prerequisites, found while discovering the graph
+
+        /**
+         * @brief Returns the node corresponding to `key`, creating it if it does not exist yet.
+         *
+         * Since the map of the nodes does not guarantee the total absence of duplicates (e.g. while it is expanding),
+         * two racing threads may rarely create two nodes for the same key: the key is then expanded twice,
+         * which is harmless.
+         *
+         * @return a pair consisting of the node and a `bool` denoting whether the node was created
+         */
+        std::pair<Node*, bool> getNode(const Key& key) {
+
+            Node* newNode = nullptr;
+
+            Node* node = nodes.insertExclusive(key, [&newNode](const Key& key) {
+                if (newNode == nullptr) {
+                    newNode = new Node(key);
+                }
+                return newNode;
+            }).first->second;
+
+            if (newNode != nullptr && newNode != node) { // another thread has created the node first
+                delete newNode;
+            } else if (newNode != nullptr) {
+                newNode->previousCreated = createdNodes.load(std::memory_order_relaxed);
+                while (!createdNodes.compare_exchange_weak(newNode->previousCreated, newNode, std::memory_order_relaxed)) {
+                }
+            }
+
+            return std::make_pair(node, node == newNode);
+
+        }
+
+        void expand(Node* node, std::deque<Step>& steps, std::vector<Key>& missingPrerequisites) {
+
+            missingPrerequisites.clear();
+
+            if (providedDeclarePrerequisites) {
+
+                // execute the declarePrerequisites function to get prerequisites
+                PrerequisitesGatherer prerequisitesDeclarer(memo.values, missingPrerequisites);
+                declarePrerequisites(node->key, prerequisitesDeclarer);
+
+            } else {
+
+                // dry-run the compute function to capture prerequisites
+                PrerequisitesProvider prerequisitesProvider(memo.values, missingPrerequisites, &node->record);
+                prerequisitesProvider.setMode(PrerequisitesProvider::DRY_RUN);
+                Value value = compute(node->key, prerequisitesProvider);
+
+                if (missingPrerequisites.empty()) { // the computed value is valid
+                    node->value = &memo.values.insert(node->key, std::move(value));
+                    if (discovering) {
+                        releasePrerequisite(node, steps); // it will complete when the evaluation starts
+                    } else {
+                        complete(node, steps);
+                    }
+                    return;
+                }
+
+            }
+
+            // the missing prerequisites correspond, in order, to the unresolved entries of the record of a dry run
+            std::size_t nextSlot = 0;
+
+            for (const Key& prerequisiteKey : missingPrerequisites) {
+
+                const std::pair<Node*, bool> getResult = getNode(prerequisiteKey);
+                Node* prerequisite = getResult.first;
+
+                if (memo.detectCircularDependencies) {
+                    node->prerequisites.push_back(prerequisite);
+                }
+
+                std::size_t slot = NO_SLOT;
+                if (!providedDeclarePrerequisites) {
+                    slot = node->record.findUnresolved(nextSlot);
+                    nextSlot = slot + 1;
+                }
+
+                prerequisite->acquire();
+                if (!prerequisite->computed) { // nothing is computed while discovering
+                    if (prerequisite->firstDependent.node == nullptr) {
+                        prerequisite->firstDependent = { node, slot };
+                    } else {
+                        prerequisite->otherDependents.push_back({ node, slot });
+                    }
+                    node->numPendingPrerequisites.fetch_add(1, std::memory_order_relaxed);
+                } else if (slot != NO_SLOT) { // computed meanwhile
+                    node->record.resolve(slot, *prerequisite->value);
+                }
+                prerequisite->release();
+
+                if (getResult.second) { // the prerequisite has just been discovered
+                    steps.push_back({ prerequisite, Action::EXPAND });
+                }
+
+            }
+
+            releasePrerequisite(node, steps); // release the reference held by the expansion itself
+
+        }
+
+        void computeNode(Node* node, std::deque<Step>& steps, std::vector<Key>& missingPrerequisites) {
+
+            // the prerequisites recorded by the dry run are replayed (the missing ones have been resolved by their nodes),
+            // the others are looked up
+            node->record.replay(0);
+            PrerequisitesProvider prerequisitesProvider(memo.values, missingPrerequisites, &node->record);
+            node->value = &memo.values.insertExclusive(node->key, [&](const Key& key) -> Value {
+                return compute(key, prerequisitesProvider);
+            });
+
+            complete(node, steps);
+
+        }
+
+        void complete(Node* node, std::deque<Step>& steps) {
+
+            if (dataflow) { // the dependents cannot change anymore
+
+                node->computed = true;
+
+                if (node->firstDependent.node != nullptr) {
+                    releaseDependent(node, node->firstDependent, steps);
+                }
+                for (const Dependent& dependent : node->otherDependents) {
+                    releaseDependent(node, dependent, steps);
+                }
+
+                return;
+
+            }
+
+            std::vector<Dependent> otherDependents;
+
+            node->acquire();
+            node->computed = true;
+            const Dependent firstDependent = node->firstDependent;
+            otherDependents.swap(node->otherDependents);
+            node->release();
+
+            if (firstDependent.node != nullptr) {
+                releaseDependent(node, firstDependent, steps);
+            }
+            for (const Dependent& dependent : otherDependents) {
+                releaseDependent(node, dependent, steps);
+            }
+
+        }
+
+        /**
+         * @brief Resolves the entry of the record of a dependent corresponding to a computed node, if any,
+         * then releases the dependent (the release publishes the entry to the thread that will compute it)
+         */
+        void releaseDependent(const Node* node, const Dependent& dependent, std::deque<Step>& steps) {
+            if (dependent.slot != NO_SLOT) {
+                dependent.node->record.resolve(dependent.slot, *node->value);
+            }
+            releasePrerequisite(dependent.node, steps);
+        }
+
+        void releasePrerequisite(Node* node, std::deque<Step>& steps) {
+            if (node->numPendingPrerequisites.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                // all the prerequisites have been computed (or, while discovering, there are none)
+                if (discovering) {
+                    std::lock_guard<std::mutex> lock(readyNodesMutex);
+                    readyNodes.push_back(node);
+                } else {
+                    steps.push_back({ node, Action::COMPUTE });
+                }
+            }
+        }
+
+        void execute(Step step) {
+            std::deque<Step> steps;
+            steps.push_back(step);
+            execute(steps);
+        }
+
+        void execute(std::deque<Step>& steps) {
+
+            std::vector<Key> missingPrerequisites;
+
+            while (!steps.empty()) {
+
+                if (taskGroup->isCancelled()) {
+                    return; // another thread has thrown an exception
+                }
+
+                const Step currentStep = steps.back();
+                steps.pop_back();
+
+                if (currentStep.action == Action::EXPAND) {
+                    expand(currentStep.node, steps, missingPrerequisites);
+                } else {
+                    computeNode(currentStep.node, steps, missingPrerequisites);
+                }
+
+                // share the oldest steps (i.e. the largest unexplored subtrees) while there are idle threads
+                while (steps.size() > 1 && pool.getNumQueuedTasks() < pool.getNumWorkers()) {
+                    const Step sharedStep = steps.front();
+                    steps.pop_front();
+                    taskGroup->run([this, sharedStep]() {
+                        execute(sharedStep);
+                    });
+                }
 
-        const Values& values;
-        ThreadItemsStack& stack;
-        Mode mode;
-        Value dummyValue;
+            }
 
-        PrerequisitesProvider(const Values& values, ThreadItemsStack& stack) :
-                values(values), stack(stack), mode(NORMAL), dummyValue() {
         }
 
-        void setMode(Mode mode) {
-            this->mode = mode;
+        /**
+         * @brief Runs the steps of a phase, waiting for their completion
+         */
+        template<typename Function>
+        void runPhase(Function function) {
+            ThreadPool::TaskGroup phaseTaskGroup(pool);
+            taskGroup = &phaseTaskGroup;
+            phaseTaskGroup.run(function);
+            phaseTaskGroup.wait(); // rethrows the first exception thrown by a task, if any
+        }
+
+        /**
+         * @brief Starts the evaluation from the nodes having no prerequisites, split into chunks
+         */
+        void evaluate() {
+
+            const std::size_t chunkSize = std::max((std::size_t) 1, readyNodes.size() / (4 * (pool.getNumWorkers() + 1)));
+
+            for (std::size_t begin = 0; begin < readyNodes.size(); begin += chunkSize) {
+                const std::size_t end = std::min(begin + chunkSize, readyNodes.size());
+                taskGroup->run([this, begin, end]() {
+                    std::deque<Step> steps;
+                    for (std::size_t i = begin; i < end; i++) {
+                        steps.push_back({ readyNodes[i], Action::COMPUTE });
+                    }
+                    execute(steps);
+                });
+            }
+
         }
 
     public:
 
+        Scheduler(CppMemo& memo, Compute compute, DeclarePrerequisites declarePrerequisites,
+                  bool providedDeclarePrerequisites, ThreadPool& pool) :
+                memo(memo), compute(compute), declarePrerequisites(declarePrerequisites),
+                providedDeclarePrerequisites(providedDeclarePrerequisites),
+                pool(pool), taskGroup(nullptr), nodes(INITIAL_NUM_NODES), createdNodes(nullptr), root(nullptr),
+                dataflow(memo.executionMode == ExecutionMode::DATAFLOW), discovering(false) {
+        }
+
+        ~Scheduler() {
+            // the task groups have been waited for, so all the pushes are visible
+            Node* node = createdNodes.load(std::memory_order_relaxed);
+            while (node != nullptr) {
+                Node* previousNode = node->previousCreated;
+                delete node;
+                node = previousNode;
+            }
+        }
+
         /**
-         * @brief Provides the value corresponding to the given key.
-         *
-         * <span style="font-weight: bold; color: red">Important note</span>.
-         * If a `CppMemo::getValue()` overload was called that does not accept a
-         * `DeclarePrerequisites` function, then this method may return an invalid, default-constructed value,
-         * and "track" the request as an indirect means to gather prerequisites of a given key
-         * (via a dry run of the `Compute` funtion).
+         * @brief Computes the value corresponding to the requested key, and memoizes it along with the values
+         * of its missing prerequisites.
          *
-         * @see `CppMemo::getValue()`
+         * @throw CircularDependencyException<Key> thrown if a circular dependency is found
+         */
+        void run(const Key& key) {
+
+            root = getNode(key).first;
+            const Step rootStep = { root, Action::EXPAND };
+
+            if (dataflow) {
+                discovering = true;
+                runPhase([this, rootStep]() {
+                    execute(rootStep);
+                });
+                discovering = false;
+                runPhase([this]() {
+                    evaluate();
+                });
+            } else {
+                runPhase([this, rootStep]() {
+                    execute(rootStep);
+                });
+            }
+
+            checkCompleted();
+
+        }
+
+        /**
+         * @brief Checks that the requested key has been computed once all the tasks have completed.
          *
-         * @param  key the requested key
+         * If it has not, then the remaining nodes form a circular dependency. The keys stack is only
+         * reconstructed if circular dependency detection is enabled.
          *
-         * @return the value corresponding to the requested key, or an invalid, default-constructed value
-         *         (if dry running the `Compute` function)
+         * @throw CircularDependencyException<Key> thrown if a circular dependency is found
          */
-        const Value& operator()(const Key& key) {
-            if (mode == NORMAL) {
-                return values[key];
-            } else { // dry running
-                const auto findIt = values.find(key);
-                if (findIt == values.end()) {
-                    stack.push(key);
-                    return dummyValue; // return an invalid value
-                } else {
-                    return findIt->second; // return a valid value
-                }
+        void checkCompleted() const {
+
+            if (root->computed) {
+                return;
             }
-        }
 
-    };
+            if (!memo.detectCircularDependencies) {
+                throw CircularDependencyException<Key>(std::vector<Key>());
+            }
 
-    /**
-     * @brief The function object gathering prerequisites from the `DeclarePrerequisites` function
-     * passed to an appropriate `CppMemo::getValue()` overload.
-     */
-    class PrerequisitesGatherer {
+            // depth-first search of a cycle among the nodes that have not been computed
+            std::vector<std::pair<const Node*, std::size_t> > path;
+            std::unordered_set<const Node*> onPath;
+            std::unordered_set<const Node*> visited;
 
-        friend class CppMemo<Key, Value, KeyHash1, KeyHash2, KeyEqual>;
+            path.push_back(std::make_pair(root, 0));
+            onPath.insert(root);
+            visited.insert(root);
 
-    private:
+            while (!path.empty()) {
 
-        const Values& values;
-        ThreadItemsStack& stack;
+                const Node* node = path.back().first;
+                std::size_t& nextIndex = path.back().second;
 
-        PrerequisitesGatherer(const Values& values, ThreadItemsStack& stack) : values(values), stack(stack) {
-        }
+                if (nextIndex == node->prerequisites.size()) {
+                    onPath.erase(node);
+                    path.pop_back();
+                    continue;
+                }
 
-    public:
+                const Node* prerequisite = node->prerequisites[nextIndex++];
+
+                if (prerequisite->computed) {
+                    continue;
+                }
+
+                if (onPath.find(prerequisite) != onPath.end()) {
+                    std::vector<Key> keysStack;
+                    for (const std::pair<const Node*, std::size_t>& pathItem : path) {
+                        keysStack.push_back(pathItem.first->key);
+                    }
+                    keysStack.push_back(prerequisite->key);
+                    throw CircularDependencyException<Key>(keysStack);
+                }
+
+                if (visited.insert(prerequisite).second) {
+                    path.push_back(std::make_pair(prerequisite, 0));
+                    onPath.insert(prerequisite);
+                }
 
-        /**
-         * @brief Gathers a prerequisite.
-         *
-         * @param key a prerequisite key
-         */
-        void operator()(const Key& key) {
-            if (values.find(key) == values.end()) {
-                stack.push(key);
             }
+
         }
 
     };
 
-private:
-
     template<typename Compute, typename DeclarePrerequisites>
-    void run(int threadNo, const Key& key, Compute compute, DeclarePrerequisites declarePrerequisites,
+    void run(const Key& key, Compute compute, DeclarePrerequisites declarePrerequisites,
              bool providedDeclarePrerequisites) {
 
-        ThreadItemsStack stack(threadNo, detectCircularDependencies);
+        ThreadItemsStack stack(detectCircularDependencies);
 
         stack.push(key);
         stack.finalizeGroup();
 
-        PrerequisitesProvider prerequisitesProvider(values, stack);
-        PrerequisitesGatherer prerequisitesDeclarer(values, stack);
+        std::vector<Key> missingPrerequisites;
+
+        // The prerequisites requested by the dry runs of the items waiting for their missing prerequisites,
+        // with a frame for each of these items. The missing prerequisites of an item are right above it in the
+        // stack, and they are resolved in reverse order, as soon as they have been computed.
+        struct RecordFrame {
+            std::size_t stackSize; // the size of the stack when the item is on its top
+            std::size_t firstEntry;
+            std::size_t endUnresolved; // the unresolved entries are before this one
+        };
+        PrerequisitesRecord record;
+        std::vector<RecordFrame> recordFrames;
+
+        PrerequisitesProvider prerequisitesProvider(values, missingPrerequisites, &record);
+        PrerequisitesGatherer prerequisitesDeclarer(values, missingPrerequisites);
 
         while (!stack.empty()) {
 
@@ -349,11 +2872,28 @@ private:
 
             if (item.ready) {
 
+                // the items above have been computed, so the last frame (if any) is either this item's or its parent's
+                const bool recorded = !recordFrames.empty() && recordFrames.back().stackSize == stack.size();
+
+                if (recorded) {
+                    record.replay(recordFrames.back().firstEntry);
+                }
+
                 prerequisitesProvider.setMode(PrerequisitesProvider::NORMAL);
-                values.insert(item.key, [&](const Key& key) -> Value {
+                const Value& value = values.insertExclusive(item.key, [&](const Key& key) -> Value {
                     return compute(key, prerequisitesProvider);
                 });
 
+                if (recorded) {
+                    record.discard(recordFrames.back().firstEntry);
+                    recordFrames.pop_back();
+                }
+
+                if (!recordFrames.empty()) { // resolve the corresponding prerequisite of the parent
+                    RecordFrame& parentFrame = recordFrames.back();
+                    parentFrame.endUnresolved = record.resolveLast(parentFrame.endUnresolved, value);
+                }
+
                 stack.pop();
 
             } else {
@@ -362,7 +2902,13 @@ private:
 
                 const Key itemKey = item.key; // copy item key
 
-                if (values.find(itemKey) == values.end()) {
+                // if the dry run below completes, the value is inserted where the lookup left off
+                typename Values::InsertHint insertHint;
+                const Value* storedValue = values.find(itemKey, insertHint);
+
+                if (storedValue == nullptr) {
+
+                    missingPrerequisites.clear();
 
                     if (providedDeclarePrerequisites) {
 
@@ -372,20 +2918,41 @@ private:
 
                     } else {
 
-                        // dry-run the compute function to capture prerequisites
+                        // dry-run the compute function to capture (and record) prerequisites
 
-                        prerequisitesProvider.setMode(PrerequisitesProvider::DRY_RUN);
-                        const Value itemValue = compute(itemKey, prerequisitesProvider);
+                        const std::size_t firstEntry = record.size();
 
-                        if (stack.getGroupSize() == 0) { // the computed value is valid
-                            values.emplace(itemKey, itemValue);
+                        prerequisitesProvider.setMode(PrerequisitesProvider::DRY_RUN);
+                        Value itemValue = compute(itemKey, prerequisitesProvider);
+
+                        if (missingPrerequisites.empty()) { // the computed value is valid
+                            const Value& value = values.insert(itemKey, insertHint, std::move(itemValue));
+                            record.discard(firstEntry);
+                            if (!recordFrames.empty()) { // resolve the corresponding prerequisite of the parent
+                                RecordFrame& parentFrame = recordFrames.back();
+                                parentFrame.endUnresolved = record.resolveLast(parentFrame.endUnresolved, value);
+                            }
                             stack.pop();
+                        } else {
+                            recordFrames.push_back({ stack.size(), firstEntry, record.size() });
                         }
 
                     }
 
+                    for (const Key& prerequisiteKey : missingPrerequisites) {
+                        stack.push(prerequisiteKey);
+                    }
+
                     stack.finalizeGroup();
 
+                } else { // computed meanwhile (e.g. as a prerequisite of another item): no need to look it up again
+
+                    if (!recordFrames.empty()) { // resolve the corresponding prerequisite of the parent
+                        RecordFrame& parentFrame = recordFrames.back();
+                        parentFrame.endUnresolved = record.resolveLast(parentFrame.endUnresolved, *storedValue);
+                    }
+                    stack.pop();
+
                 }
 
             }
@@ -398,37 +2965,130 @@ private:
     const Value& getValue(const Key& key, Compute compute, DeclarePrerequisites declarePrerequisites, int numThreads,
                           bool providedDeclarePrerequisites) {
 
-        const auto findIt = values.find(key);
-        if (findIt != values.end()) {
-            return findIt->second;
+        const Value* value = values.find(key);
+        if (value != nullptr) {
+            return *value;
         }
 
         if (numThreads > 1) { // multi-thread execution
 
-            std::vector<std::thread> threads;
-            threads.reserve(numThreads);
+            const std::shared_ptr<ThreadPool> pool = getThreadPool(numThreads);
 
-            for (int threadNo = 0; threadNo < numThreads; threadNo++) {
+            Scheduler<Compute, DeclarePrerequisites> scheduler(
+                    *this, compute, declarePrerequisites, providedDeclarePrerequisites, *pool);
 
-                typedef CppMemo<Key, Value, KeyHash1, KeyHash2, KeyEqual> self;
-                std::thread thread(&self::run<Compute, DeclarePrerequisites>,
-                        this, threadNo, std::ref(key), compute, declarePrerequisites, providedDeclarePrerequisites);
+            scheduler.run(key);
 
-                threads.push_back(std::move(thread));
+        } else { // single thread execution
 
-            }
+            run(key, compute, declarePrerequisites, providedDeclarePrerequisites);
 
-            for (std::thread& thread : threads) {
-                thread.join();
-            }
+        }
+
+        return values[key];
+
+    }
+
+    /**
+     * @brief Returns the thread pool, creating it if this instance owns it and it has not been created yet.
+     *
+     * An owned pool has `numThreads - 1` workers, since the calling thread takes part in the execution:
+     * if an execution asks for more threads than the pool has, a larger pool replaces it (the executions
+     * running on the smaller one keep it alive until they complete). A shared pool is never replaced.
+     */
+    std::shared_ptr<ThreadPool> getThreadPool(int numThreads) {
+        std::lock_guard<std::mutex> lock(threadPoolMutex);
+        if (ownsThreadPool && (!threadPool || threadPool->getNumWorkers() < (std::size_t) (numThreads - 1))) {
+            threadPool = std::make_shared<ThreadPool>(numThreads - 1);
+        }
+        return threadPool;
+    }
+
+    /**
+     * @brief Runs `computeKeys(keys, begin, end)` on the keys enumerated by `enumerateKeys`, a level at a time:
+     * with more than one thread, each level is split into chunks computed in parallel.
+     *
+     * @param maxBatchSize  with a single thread, the keys may be computed in batches of this size,
+     *                      regardless of the levels (0: a batch per level)
+     * @param completeBatch called once all the keys of a batch (i.e. of a level, with a batch per level) are computed
+     */
+    template<typename EnumerateKeys, typename ComputeKeys, typename CompleteBatch>
+    void enumerateLevels(EnumerateKeys& enumerateKeys, const ComputeKeys& computeKeys, int numThreads, std::size_t maxBatchSize,
+                         const CompleteBatch& completeBatch) {
+
+        if (numThreads > 1) { // multi-thread execution
+
+            const std::shared_ptr<ThreadPool> sharedPool = getThreadPool(numThreads);
+            ThreadPool& pool = *sharedPool;
+
+            KeysEnumerator keysEnumerator(0, [&pool, &computeKeys, &completeBatch](const std::vector<Key>& keys) {
+                const std::size_t chunkSize = std::max((std::size_t) 1, keys.size() / (4 * (pool.getNumWorkers() + 1)));
+                ThreadPool::TaskGroup levelTaskGroup(pool);
+                for (std::size_t begin = 0; begin < keys.size(); begin += chunkSize) {
+                    const std::size_t end = std::min(begin + chunkSize, keys.size());
+                    levelTaskGroup.run([&computeKeys, &keys, begin, end]() {
+                        computeKeys(keys, begin, end);
+                    });
+                }
+                levelTaskGroup.wait(); // rethrows the first exception thrown by a task, if any
+                completeBatch();
+            });
+            enumerateKeys(keysEnumerator);
+            keysEnumerator.flush();
 
         } else { // single thread execution
 
-            run(0, key, compute, declarePrerequisites, providedDeclarePrerequisites);
+            KeysEnumerator keysEnumerator(maxBatchSize, [&computeKeys, &completeBatch](const std::vector<Key>& keys) {
+                computeKeys(keys, 0, keys.size());
+                completeBatch();
+            });
+            enumerateKeys(keysEnumerator);
+            keysEnumerator.flush();
 
         }
 
-        return values[key];
+    }
+
+    template<typename EnumerateKeys, typename Compute, typename DeclarePrerequisites>
+    void tabulateSharded(EnumerateKeys enumerateKeys, Compute compute, DeclarePrerequisites declarePrerequisites,
+                         int numThreads, bool providedDeclarePrerequisites) {
+
+        const auto computeKeys = [this, &compute, &declarePrerequisites, providedDeclarePrerequisites](
+                const std::vector<Key>& keys, std::size_t begin, std::size_t end) {
+
+            std::vector<Key> ownedKeys; // the keys of this shard that have not been computed yet
+            std::vector<Key> missingPrerequisites;
+            PrerequisitesProvider prerequisitesProvider(values, missingPrerequisites);
+            PrerequisitesGatherer prerequisitesDeclarer(values, missingPrerequisites);
+
+            // gather the missing prerequisites of the keys (dry running the compute function, unless they are declared)
+            prerequisitesProvider.setMode(PrerequisitesProvider::DRY_RUN);
+            for (std::size_t i = begin; i < end; i++) {
+                if (values.owns(keys[i]) && values.find(keys[i]) == nullptr) {
+                    ownedKeys.push_back(keys[i]);
+                    if (providedDeclarePrerequisites) {
+                        declarePrerequisites(keys[i], prerequisitesDeclarer);
+                    } else {
+                        compute(keys[i], prerequisitesProvider);
+                    }
+                }
+            }
+
+            // fetch them from the other shards all at once, then compute the keys
+            values.fetchMany(missingPrerequisites);
+            prerequisitesProvider.setMode(PrerequisitesProvider::NORMAL);
+            for (std::size_t i = 0; i < ownedKeys.size(); i++) {
+                values.insertExclusive(ownedKeys[i], [&compute, &prerequisitesProvider](const Key& key) {
+                    return compute(key, prerequisitesProvider);
+                });
+            }
+
+        };
+
+        // the keys of a level cannot be batched with the ones of the next level, whose prerequisites they may be
+        enumerateLevels(enumerateKeys, computeKeys, numThreads, 0, [this]() {
+            values.completeLevel();
+        });
 
     }
 
@@ -444,7 +3104,55 @@ public:
      */
     CppMemo(int defaultNumThreads = 1, std::size_t estimatedNumEntries = 0, bool detectCircularDependencies = false) :
             values(estimatedNumEntries),
-            detectCircularDependencies(detectCircularDependencies) {
+            detectCircularDependencies(detectCircularDependencies),
+            executionMode(ExecutionMode::COOPERATIVE),
+            ownsThreadPool(true) {
+        setDefaultNumThreads(defaultNumThreads);
+    }
+
+    /**
+     * @brief Constructor. The instance will execute multi-thread computations on a shared thread pool.
+     *
+     * The default number of threads is set to the number of workers of the pool, plus one
+     * (the thread calling getValue() takes part in the execution). The pool is used as it is, so an execution
+     * never runs on more threads than that, whatever number of threads it asks for.
+     *
+     * @param threadPool                  the thread pool (it can be shared among several instances)
+     * @param estimatedNumEntries         an estimate for the number of memoized entries that will be stored in
+     *                                    this class instance
+     * @param detectCircularDependencies  enable circular dependency detection
+     */
+    CppMemo(const std::shared_ptr<ThreadPool>& threadPool, std::size_t estimatedNumEntries = 0,
+            bool detectCircularDependencies = false) :
+            values(estimatedNumEntries),
+            detectCircularDependencies(detectCircularDependencies),
+            executionMode(ExecutionMode::COOPERATIVE),
+            threadPool(threadPool),
+            ownsThreadPool(false) {
+        if (!threadPool) {
+            throw std::logic_error("Invalid thread pool");
+        }
+        setDefaultNumThreads((int) threadPool->getNumWorkers() + 1);
+    }
+
+    /**
+     * @brief Constructor. The storage of the memoized values is constructed from `storageArgs`
+     * (e.g. the shape of a DenseStorage, the spill directory of a FcmmStorage, or the name of a SharedStorage).
+     *
+     * @param defaultNumThreads           the default number of threads to be started
+     * @param estimatedNumEntries         ignored: the storage is sized by its own arguments, so any estimate
+     *                                    must be passed among `storageArgs` (the parameter is kept so the
+     *                                    leading arguments match the other constructors)
+     * @param detectCircularDependencies  enable circular dependency detection
+     * @param storageArgs                 the arguments of the storage constructor
+     */
+    template<typename... StorageArgs>
+    CppMemo(std::piecewise_construct_t, int defaultNumThreads, std::size_t /* estimatedNumEntries */,
+            bool detectCircularDependencies, StorageArgs&&... storageArgs) :
+            values(std::forward<StorageArgs>(storageArgs)...),
+            detectCircularDependencies(detectCircularDependencies),
+            executionMode(ExecutionMode::COOPERATIVE),
+            ownsThreadPool(true) {
         setDefaultNumThreads(defaultNumThreads);
     }
 
@@ -481,16 +3189,100 @@ public:
         this->detectCircularDependencies = detectCircularDependencies;
     }
 
+    /**
+     * @brief Returns the execution mode of multi-thread computations.
+     */
+    ExecutionMode getExecutionMode() const {
+        return executionMode;
+    }
+
+    /**
+     * @brief Sets the execution mode of multi-thread computations.
+     *
+     * @param executionMode the execution mode
+     *
+     * @see ExecutionMode
+     */
+    void setExecutionMode(ExecutionMode executionMode) {
+        this->executionMode = executionMode;
+    }
+
+    /**
+     * @brief Returns statistics about the memoized entries.
+     *
+     * The information returned by this method is useful for debugging and benchmarking, e.g.
+     * `fcmm::Stats::numAvoidedComputations` reports how many times a thread waited for a value computed
+     * by another thread instead of computing it again.
+     *
+     * @see fcmm::Stats
+     */
+    fcmm::Stats getStats() const {
+        return values.getStats();
+    }
+
+    /**
+     * @brief Saves the memoized values to a snapshot file, so that a later process can load them with loadSnapshot()
+     * instead of computing them again. Keys and values are converted to bytes by `fcmm::Serializer`, which can be
+     * specialized for the key and value types (see fcmm::Fcmm::saveSnapshot()).
+     *
+     * Only available with FcmmStorage.
+     *
+     * @throw std::runtime_error  thrown if the file cannot be written
+     */
+    void saveSnapshot(const std::string& filename) const {
+        values.saveSnapshot(filename);
+    }
+
+    /**
+     * @brief Loads a snapshot file saved by saveSnapshot(). The file is mapped into memory, not parsed:
+     * the values it contains are served right away, and each of them is memoized when first requested.
+     * The values computed from then on are memoized as usual, on top of the snapshot.
+     *
+     * Only available with FcmmStorage. It must not be called while values are being computed.
+     *
+     * @throw std::runtime_error  thrown if the file cannot be read, or is not a valid snapshot
+     */
+    void loadSnapshot(const std::string& filename) {
+        values.loadSnapshot(filename);
+    }
+
+    /**
+     * @brief Appends the values memoized from now on to `log`, which writes them to its file in the background
+     * (see fcmm::EntryLog), or stops logging if `log` is `nullptr`. Unlike a snapshot, the log keeps up with the
+     * computation: a later process recovers the values logged before a crash with replayEntryLog().
+     * Keys and values are converted to bytes by `fcmm::Serializer`.
+     *
+     * Only available with FcmmStorage. It must not be called while values are being computed, and the log
+     * must outlive this object (or be detached first).
+     */
+    void setEntryLog(fcmm::EntryLog* log) {
+        values.setEntryLog(log);
+    }
+
+    /**
+     * @brief Memoizes the values of an entry log file (see setEntryLog()), reading it sequentially.
+     * It should be called before attaching a log, otherwise the values are logged again.
+     *
+     * Only available with FcmmStorage. It must not be called while values are being computed.
+     *
+     * @return  the number of entries read from the log (zero if the file does not exist)
+     *
+     * @throw std::runtime_error  thrown if the file is not a valid entry log
+     */
+    std::size_t replayEntryLog(const std::string& filename) {
+        return values.replayEntryLog(filename);
+    }
+
     /**
      * @brief Returns the value corresponding to the requested key, computing (and memoizing) it as needed.
      *
      * @param key                    the requested key
      * @param compute                a function or functor used to compute the value corresponding to a given key
      * @param declarePrerequisites   a function or functor used to gather the prerequisites of a given key
-     * @param numThreads             the number of threads to be started
+     * @param numThreads             the number of threads taking part in the execution
      *
-     * @tparam Compute               function or functor implementing `Value operator()(const Key&, CppMemo<Key, Value, KeyHash1, KeyHash2, KeyEqual>::PrerequisitesProvider)`
-     * @tparam DeclarePrerequisites  function or functor implementing `void operator()(const Key&, CppMemo<Key, Value, KeyHash1, KeyHash2, KeyEqual>::PrerequisitesGatherer)`
+     * @tparam Compute               function or functor implementing `Value operator()(const Key&, CppMemo<Key, Value, KeyHash1, KeyHash2, KeyEqual, Storage>::PrerequisitesProvider)`
+     * @tparam DeclarePrerequisites  function or functor implementing `void operator()(const Key&, CppMemo<Key, Value, KeyHash1, KeyHash2, KeyEqual, Storage>::PrerequisitesGatherer)`
      *
      * @return the value corresponding to the requested key
      */
@@ -508,8 +3300,8 @@ public:
      * @param compute                a function or functor used to compute the value corresponding to a given key
      * @param declarePrerequisites   a function or functor used to gather the prerequisites of a given key
      *
-     * @tparam Compute               function or functor implementing `Value operator()(const Key&, CppMemo<Key, Value, KeyHash1, KeyHash2, KeyEqual>::PrerequisitesProvider)`
-     * @tparam DeclarePrerequisites  function or functor implementing `void operator()(const Key&, CppMemo<Key, Value, KeyHash1, KeyHash2, KeyEqual>::PrerequisitesGatherer)`
+     * @tparam Compute               function or functor implementing `Value operator()(const Key&, CppMemo<Key, Value, KeyHash1, KeyHash2, KeyEqual, Storage>::PrerequisitesProvider)`
+     * @tparam DeclarePrerequisites  function or functor implementing `void operator()(const Key&, CppMemo<Key, Value, KeyHash1, KeyHash2, KeyEqual, Storage>::PrerequisitesGatherer)`
      *
      * @return the value corresponding to the requested key
      */
@@ -528,9 +3320,9 @@ public:
      *
      * @param key                    the requested key
      * @param compute                a function or functor used to compute the value corresponding to a given key
-     * @param numThreads             the number of threads to be started
+     * @param numThreads             the number of threads taking part in the execution
      *
-     * @tparam Compute               function or functor implementing `Value operator()(const Key&, CppMemo<Key, Value, KeyHash1, KeyHash2, KeyEqual>::PrerequisitesProvider)`
+     * @tparam Compute               function or functor implementing `Value operator()(const Key&, CppMemo<Key, Value, KeyHash1, KeyHash2, KeyEqual, Storage>::PrerequisitesProvider)`
      *
      * @return the value corresponding to the requested key
      */
@@ -553,7 +3345,7 @@ public:
      * @param key                    the requested key
      * @param compute                a function or functor used to compute the value corresponding to a given key
      *
-     * @tparam Compute               function or functor implementing `Value operator()(const Key&, CppMemo<Key, Value, KeyHash1, KeyHash2, KeyEqual>::PrerequisitesProvider)`
+     * @tparam Compute               function or functor implementing `Value operator()(const Key&, CppMemo<Key, Value, KeyHash1, KeyHash2, KeyEqual, Storage>::PrerequisitesProvider)`
      *
      * @return the value corresponding to the requested key
      */
@@ -573,14 +3365,130 @@ public:
      * @throw std::logic_error thrown if no value for the requested key is memoized
      */
     const Value& getValue(const Key& key) const {
-        const auto findIt = values.find(key);
-        if (findIt != values.end()) {
-            return findIt->second;
+        const Value* value = values.find(key);
+        if (value != nullptr) {
+            return *value;
         } else {
             throw std::logic_error("The value is not memoized");
         }
     }
 
+    /**
+     * @brief Computes (and memoizes) the values corresponding to all the enumerated keys, bottom-up.
+     *
+     * Keys are enumerated in levels by the `EnumerateKeys` function (see KeysEnumerator):
+     * each level is computed after the previous one, and the keys within a level are
+     * computed in parallel. The `Compute` function is called directly, without any dry run
+     * or prerequisite discovery: the prerequisites of every key must belong to previous levels
+     * (or be already memoized). Keys already memoized are not computed again.
+     *
+     * With a single thread, levels are not needed and keys may simply be enumerated in a
+     * topological order (prerequisites first).
+     *
+     * @param enumerateKeys          a function or functor enumerating the keys to be computed
+     * @param compute                a function or functor used to compute the value corresponding to a given key
+     * @param numThreads             the number of threads taking part in the execution
+     *
+     * @tparam EnumerateKeys         function or functor implementing `void operator()(CppMemo<Key, Value, KeyHash1, KeyHash2, KeyEqual, Storage>::KeysEnumerator&)`
+     * @tparam Compute               function or functor implementing `Value operator()(const Key&, CppMemo<Key, Value, KeyHash1, KeyHash2, KeyEqual, Storage>::PrerequisitesProvider)`
+     *
+     * @throw std::out_of_range thrown if a key is computed before one of its prerequisites
+     */
+    template<typename EnumerateKeys, typename Compute>
+    void tabulate(EnumerateKeys enumerateKeys, Compute compute, int numThreads) {
+
+        const auto computeKeys = [this, &compute](const std::vector<Key>& keys, std::size_t begin, std::size_t end) {
+            std::vector<Key> missingPrerequisites; // never used, since the provider does not dry run
+            PrerequisitesProvider prerequisitesProvider(values, missingPrerequisites);
+            for (std::size_t i = begin; i < end; i++) {
+                values.insertExclusive(keys[i], [&compute, &prerequisitesProvider](const Key& key) {
+                    return compute(key, prerequisitesProvider);
+                });
+            }
+        };
+
+        // with a single thread, keys are computed in enumeration order, in small batches
+        enumerateLevels(enumerateKeys, computeKeys, numThreads, 1024, []() {});
+
+    }
+
+    /**
+     * @brief Computes (and memoizes) the values corresponding to all the enumerated keys, bottom-up.
+     *
+     * The default number of threads will be started (see setDefaultNumThreads()).
+     *
+     * @see tabulate(EnumerateKeys, Compute, int)
+     *
+     * @param enumerateKeys          a function or functor enumerating the keys to be computed
+     * @param compute                a function or functor used to compute the value corresponding to a given key
+     *
+     * @tparam EnumerateKeys         function or functor implementing `void operator()(CppMemo<Key, Value, KeyHash1, KeyHash2, KeyEqual, Storage>::KeysEnumerator&)`
+     * @tparam Compute               function or functor implementing `Value operator()(const Key&, CppMemo<Key, Value, KeyHash1, KeyHash2, KeyEqual, Storage>::PrerequisitesProvider)`
+     */
+    template<typename EnumerateKeys, typename Compute>
+    void tabulate(EnumerateKeys enumerateKeys, Compute compute) {
+        tabulate(enumerateKeys, compute, defaultNumThreads);
+    }
+
+    /**
+     * @brief Computes (and memoizes) the values corresponding to the enumerated keys owned by this shard, bottom-up,
+     * fetching their prerequisites owned by the other shards (see ShardedStorage). All the shards have to call this
+     * method with the same enumeration: each one computes its own keys.
+     *
+     * Keys are enumerated in levels, as by tabulate(), and the prerequisites of every key must belong to previous
+     * levels. The keys of each chunk of a level are processed in three steps: their missing prerequisites are
+     * gathered by the `DeclarePrerequisites` function, they are fetched from their shards all at once, and the
+     * keys are computed. With more than one thread, the chunks of a level are processed in parallel, so that
+     * fetches and computations overlap.
+     *
+     * Only available with ShardedStorage.
+     *
+     * @param enumerateKeys          a function or functor enumerating the keys to be computed
+     * @param compute                a function or functor used to compute the value corresponding to a given key
+     * @param declarePrerequisites   a function or functor used to gather the prerequisites of a given key
+     * @param numThreads             the number of threads taking part in the execution
+     *
+     * @tparam EnumerateKeys         function or functor implementing `void operator()(CppMemo<Key, Value, KeyHash1, KeyHash2, KeyEqual, Storage>::KeysEnumerator&)`
+     * @tparam Compute               function or functor implementing `Value operator()(const Key&, CppMemo<Key, Value, KeyHash1, KeyHash2, KeyEqual, Storage>::PrerequisitesProvider)`
+     * @tparam DeclarePrerequisites  function or functor implementing `void operator()(const Key&, CppMemo<Key, Value, KeyHash1, KeyHash2, KeyEqual, Storage>::PrerequisitesGatherer)`
+     *
+     * @throw std::out_of_range      thrown if a key is computed before one of its prerequisites
+     * @throw std::runtime_error     thrown if a shard cannot be reached
+     */
+    template<typename EnumerateKeys, typename Compute, typename DeclarePrerequisites>
+    void tabulateSharded(EnumerateKeys enumerateKeys, Compute compute, DeclarePrerequisites declarePrerequisites, int numThreads) {
+        tabulateSharded(enumerateKeys, compute, declarePrerequisites, numThreads, true);
+    }
+
+    /**
+     * @brief Computes (and memoizes) the values corresponding to the enumerated keys owned by this shard, bottom-up.
+     *
+     * <span style="font-weight: bold; color: red">Important note</span>.
+     * This overload omits the `DeclarePrerequisites` parameter: the prerequisites of the keys
+     * are gathered by dry running the `Compute` function, which is then called twice per key.
+     *
+     * @see tabulateSharded(EnumerateKeys, Compute, DeclarePrerequisites, int)
+     */
+    template<typename EnumerateKeys, typename Compute>
+    void tabulateSharded(EnumerateKeys enumerateKeys, Compute compute, int numThreads) {
+        const auto dummyDeclarePrerequisites = [](const Key&, PrerequisitesGatherer&) {};
+        tabulateSharded(enumerateKeys, compute, dummyDeclarePrerequisites, numThreads, false);
+    }
+
+    /**
+     * @brief Returns the value corresponding to the requested key, fetching it from the shard owning it
+     * if this shard has not memoized it (e.g. the value of the last key computed by tabulateSharded()).
+     *
+     * Only available with ShardedStorage.
+     *
+     * @throw std::out_of_range    thrown if the value is not memoized by the shard owning the key once it has completed
+     *                             the levels completed by this shard (e.g. the key has not been tabulated)
+     * @throw std::runtime_error   thrown if the shard owning the key cannot be reached
+     */
+    const Value& getShardedValue(const Key& key) {
+        return values.fetch(key);
+    }
+
     /**
      * @brief Alias for getValue(const Key&, Compute, DeclarePrerequisites, int)
      */
@@ -628,4 +3536,7 @@ public:
 
 } // namespace cppmemo
 
+#undef CPPMEMO_NOINLINE
+#undef CPPMEMO_POSIX
+
 #endif // CPPMEMO_H_
@@ -0,0 +1,121 @@
+#include "cppmemo.hpp"
+#include "common.hpp"
+
+#include <iostream>
+#include <iomanip> // std::setw
+#include <string>
+#include <atomic>
+#include <cstdio> // std::remove
+
+using namespace cppmemo;
+
+typedef CppMemo<long, long long> CppMemoType;
+
+static const long long MODULUS = 1000000007;
+
+static long maxN; // keys encode (n, k) as n * (maxN + 1) + k
+
+static std::atomic<long> numComputations(0);
+
+long makeKey(long n, long k) {
+    return n * (maxN + 1) + k;
+}
+
+// number of partitions of n into parts not greater than k
+long long partitions(long key, CppMemoType::PrerequisitesProvider prereqs) {
+    numComputations.fetch_add(1, std::memory_order_relaxed);
+    const long n = key / (maxN + 1);
+    const long k = key % (maxN + 1);
+    if (n == 0) return 1;
+    if (k == 0) return 0;
+    const long long withoutK = prereqs(makeKey(n, k - 1));
+    const long long withK = k <= n ? prereqs(makeKey(n - k, k)) : 0;
+    return (withoutK + withK) % MODULUS;
+}
+
+int main(int argc, char** argv) {
+
+    if (argc != 4) {
+        std::cerr << "usage: entry_log NUMBER_OF_THREADS N LOG_FILE" << std::endl;
+        return -1;
+    }
+
+    const int numThreads = std::stoi(argv[1]);
+    maxN = std::stol(argv[2]);
+    const std::string logFilename = argv[3];
+
+    const bool printAsRow = getenv("CPPMEMO_PRINT_AS_ROW") != nullptr;
+
+    std::remove(logFilename.c_str());
+
+    // compute the number of partitions of N without logging
+    Timestamp start = now();
+    long long result;
+    {
+        CppMemoType cppMemo;
+        result = cppMemo.getValue(makeKey(maxN, maxN), partitions, numThreads);
+    }
+    const double plainTime = elapsedSeconds(start, now());
+
+    // compute it again, logging the memoized values (the time includes writing the last of them)
+    start = now();
+    long long loggedResult;
+    std::size_t numEntries;
+    {
+        fcmm::EntryLog log(logFilename);
+        CppMemoType cppMemo;
+        cppMemo.setEntryLog(&log);
+        loggedResult = cppMemo.getValue(makeKey(maxN, maxN), partitions, numThreads);
+        numEntries = cppMemo.getStats().numEntries;
+        log.flush();
+    }
+    const double loggedTime = elapsedSeconds(start, now());
+
+    // restart: replay the log into a fresh memoizer, which answers without computing anything
+    start = now();
+    long long replayedResult;
+    std::size_t numReplayedEntries;
+    {
+        CppMemoType cppMemo;
+        numReplayedEntries = cppMemo.replayEntryLog(logFilename);
+        numComputations.store(0);
+        replayedResult = cppMemo.getValue(makeKey(maxN, maxN), partitions, numThreads);
+    }
+    const double replayTime = elapsedSeconds(start, now());
+
+    std::remove(logFilename.c_str());
+
+    if (loggedResult != result || replayedResult != result || numReplayedEntries < numEntries || numComputations.load() != 0) {
+        std::cerr << "Wrong results" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const double overhead = 100.0 * (loggedTime - plainTime) / plainTime;
+
+    if (!printAsRow) {
+
+        std::cout << "Result: " << result << std::endl;
+        std::cout << "Number of logged entries: " << numReplayedEntries << std::endl;
+
+        std::cout << std::endl;
+        std::cout << "Elapsed time, no log (sec.): " << plainTime << std::endl;
+        std::cout << "Elapsed time, log (sec.): " << loggedTime << std::endl;
+        std::cout << "Logging overhead (%): " << overhead << std::endl;
+        std::cout << "Elapsed time, replay (sec.): " << replayTime << std::endl;
+
+    } else {
+
+        std::cout << std::left << std::fixed << std::setprecision(3)
+                  << std::setw(20) << numThreads
+                  << std::setw(20) << maxN
+                  << std::setw(20) << plainTime
+                  << std::setw(20) << loggedTime
+                  << std::setw(20) << overhead
+                  << std::setw(19) << replayTime
+                  << std::endl;
+
+    }
+
+    return EXIT_SUCCESS;
+
+}
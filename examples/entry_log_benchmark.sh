@@ -0,0 +1,24 @@
+#!/bin/bash
+
+EXECUTABLE=./entry_log
+
+# Feel free to change the three variables below as needed
+NUM_THREADS_LIST="1 2 4 8"
+N_LIST="1000 2000"
+LOG_FILE=/tmp/entry_log.log
+
+export CPPMEMO_PRINT_AS_ROW=1
+
+# Print table header
+echo "Threads             N                   No log (sec.)       Log (sec.)          Overhead (%)        Replay (sec.)"
+echo "-----------------------------------------------------------------------------------------------------------------"
+
+for N in $N_LIST
+do
+    for NUM_THREADS in $NUM_THREADS_LIST
+    do
+        $EXECUTABLE $NUM_THREADS $N $LOG_FILE
+    done
+done
+
+unset CPPMEMO_PRINT_AS_ROW
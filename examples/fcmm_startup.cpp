@@ -0,0 +1,80 @@
+#include "fcmm/fcmm.hpp"
+#include "common.hpp"
+
+#include <iostream>
+#include <iomanip> // std::setw
+#include <string>
+#include <chrono>
+
+using namespace fcmm;
+
+typedef Fcmm<long, long> FcmmType;
+
+typedef std::chrono::steady_clock Clock;
+
+double elapsedMilliseconds(Clock::time_point start, Clock::time_point end) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1000.0;
+}
+
+int main(int argc, char** argv) {
+
+    const std::string option = argc == 3 ? argv[2] : "";
+    if (argc != 2 && !(argc == 3 && (option == "thp" || option == "hugetlb"))) {
+        std::cerr << "usage: fcmm_startup NUMBER_OF_ENTRIES [thp|hugetlb]" << std::endl;
+        return -1;
+    }
+
+    const long numEntries = std::stol(argv[1]);
+    const HugePages hugePages = option == "thp" ? HugePages::TRANSPARENT :
+                                option == "hugetlb" ? HugePages::EXPLICIT : HugePages::NONE;
+
+    const bool printAsRow = getenv("CPPMEMO_PRINT_AS_ROW") != nullptr;
+
+    // startup: construct a map sized for all the entries, then fill it
+    Clock::time_point start = Clock::now();
+    FcmmType* presizedMap = new FcmmType(numEntries, DEFAULT_MAX_LOAD_FACTOR, DEFAULT_MAX_NUM_SUBMAPS, hugePages);
+    const double constructionTime = elapsedMilliseconds(start, Clock::now());
+    start = Clock::now();
+    for (long i = 0; i < numEntries; i++) {
+        presizedMap->insert(i, [](long key) { return key; });
+    }
+    const double presizedInsertionTime = elapsedMilliseconds(start, Clock::now());
+    delete presizedMap;
+
+    // expansion: grow a map from the minimum capacity; the longest insertion is the one creating the largest submap
+    FcmmType growingMap(0, DEFAULT_MAX_LOAD_FACTOR, DEFAULT_MAX_NUM_SUBMAPS, hugePages);
+    double maxInsertionLatency = 0;
+    start = Clock::now();
+    for (long i = 0; i < numEntries; i++) {
+        const Clock::time_point insertionStart = Clock::now();
+        growingMap.insert(i, [](long key) { return key; });
+        maxInsertionLatency = std::max(maxInsertionLatency, elapsedMilliseconds(insertionStart, Clock::now()));
+    }
+    const double growingInsertionTime = elapsedMilliseconds(start, Clock::now());
+    const std::size_t numSubmaps = growingMap.getStats().numSubmaps;
+
+    if (!printAsRow) {
+
+        std::cout << "Construction time (msec.): " << constructionTime << std::endl;
+        std::cout << "Insertion time, presized map (msec.): " << presizedInsertionTime << std::endl;
+        std::cout << std::endl;
+        std::cout << "Number of submaps, growing map: " << numSubmaps << std::endl;
+        std::cout << "Insertion time, growing map (msec.): " << growingInsertionTime << std::endl;
+        std::cout << "Longest insertion, i.e. expansion pause (msec.): " << maxInsertionLatency << std::endl;
+
+    } else {
+
+        std::cout << std::left << std::fixed << std::setprecision(3)
+                  << std::setw(20) << numEntries
+                  << std::setw(10) << (option.empty() ? "none" : option)
+                  << std::setw(20) << constructionTime
+                  << std::setw(20) << presizedInsertionTime
+                  << std::setw(20) << growingInsertionTime
+                  << std::setw(19) << maxInsertionLatency
+                  << std::endl;
+
+    }
+
+    return EXIT_SUCCESS;
+
+}
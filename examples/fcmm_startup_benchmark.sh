@@ -0,0 +1,28 @@
+#!/bin/bash
+
+EXECUTABLE=./fcmm_startup
+
+# Feel free to change the two variables below as needed
+HUGE_PAGES_LIST="none thp hugetlb"
+NUMBER_OF_ENTRIES_LIST="1000000 10000000 50000000"
+
+export CPPMEMO_PRINT_AS_ROW=1
+
+# Print table header
+echo "Number of entries   Pages     Construct (msec.)   Presized (msec.)    Growing (msec.)     Max pause (msec.)"
+echo "---------------------------------------------------------------------------------------------------"
+
+for NUMBER_OF_ENTRIES in $NUMBER_OF_ENTRIES_LIST
+do
+    for HUGE_PAGES in $HUGE_PAGES_LIST
+    do
+        if [ "$HUGE_PAGES" == "none" ]
+        then
+            $EXECUTABLE $NUMBER_OF_ENTRIES
+        else
+            $EXECUTABLE $NUMBER_OF_ENTRIES $HUGE_PAGES
+        fi
+    done
+done
+
+unset CPPMEMO_PRINT_AS_ROW
@@ -0,0 +1,121 @@
+#include "fcmm/fcmm.hpp"
+#include "common.hpp"
+
+#include <iostream>
+#include <iomanip> // std::setw
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace fcmm;
+
+static const long KEY_MULTIPLIER = 7919; // the keys i * KEY_MULTIPLIER + 1 are never inserted
+
+// runs operation(i) for each i in [0, numOperations), split among numThreads threads
+template<typename Operation>
+double runConcurrently(int numThreads, long numOperations, Operation operation) {
+    const Timestamp start = now();
+    std::vector<std::thread> threads;
+    for (int threadNo = 0; threadNo < numThreads; threadNo++) {
+        threads.emplace_back([=]() {
+            for (long i = threadNo; i < numOperations; i += numThreads) {
+                operation(i);
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    const Timestamp end = now();
+    return elapsedSeconds(start, end);
+}
+
+// millions of operations per second
+double throughput(long numOperations, double timeElapsed) {
+    return timeElapsed > 0 ? numOperations / timeElapsed / 1e6 : 0;
+}
+
+template<typename CapacityPolicy>
+int benchmark(int numThreads, long numEntries, const std::string& policyName, bool printAsRow) {
+
+    typedef Fcmm<long, long, std::hash<long>, DefaultKeyHash2<long>, std::equal_to<long>, CapacityPolicy> FcmmType;
+
+    FcmmType map(numEntries);
+
+    const double insertTime = runConcurrently(numThreads, numEntries, [&map](long i) {
+        map.insert(i * KEY_MULTIPLIER, [](long key) { return key / KEY_MULTIPLIER; });
+    });
+
+    std::vector<long> numErrors(numThreads, 0);
+
+    const double hitTime = runConcurrently(numThreads, numEntries, [&map, &numErrors, numThreads](long i) {
+        const typename FcmmType::const_iterator it = map.find(i * KEY_MULTIPLIER);
+        if (it == map.end() || it->second != i) {
+            numErrors[i % numThreads]++;
+        }
+    });
+
+    const double missTime = runConcurrently(numThreads, numEntries, [&map, &numErrors, numThreads](long i) {
+        if (map.find(i * KEY_MULTIPLIER + 1) != map.end()) {
+            numErrors[i % numThreads]++;
+        }
+    });
+
+    long totalNumErrors = 0;
+    for (long threadNumErrors : numErrors) {
+        totalNumErrors += threadNumErrors;
+    }
+    if (totalNumErrors != 0) {
+        std::cerr << "Wrong results: " << totalNumErrors << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (!printAsRow) {
+
+        std::cout << "Capacity policy: " << policyName << std::endl;
+        std::cout << "Capacity: " << map.getStats().submapsStats.back().capacity << std::endl;
+
+        std::cout << std::endl;
+        std::cout << "Insert throughput (Mops/sec.): " << throughput(numEntries, insertTime) << std::endl;
+        std::cout << "Hit throughput (Mops/sec.): " << throughput(numEntries, hitTime) << std::endl;
+        std::cout << "Miss throughput (Mops/sec.): " << throughput(numEntries, missTime) << std::endl;
+
+    } else {
+
+        std::cout << std::left << std::fixed << std::setprecision(3)
+                  << std::setw(18) << policyName
+                  << std::setw(20) << numEntries
+                  << std::setw(20) << numThreads
+                  << std::setw(20) << throughput(numEntries, insertTime)
+                  << std::setw(20) << throughput(numEntries, hitTime)
+                  << std::setw(19) << throughput(numEntries, missTime)
+                  << std::endl;
+
+    }
+
+    return EXIT_SUCCESS;
+
+}
+
+int main(int argc, char** argv) {
+
+    const std::string policyName = argc == 4 ? argv[3] : "prime";
+    if (argc != 3 && !(argc == 4 && (policyName == "prime" || policyName == "fastprime" || policyName == "pow2"))) {
+        std::cerr << "usage: fcmm_throughput NUMBER_OF_THREADS NUMBER_OF_ENTRIES [prime|fastprime|pow2]" << std::endl;
+        return -1;
+    }
+
+    const int numThreads = std::stoi(argv[1]);
+    const long numEntries = std::stol(argv[2]);
+
+    const bool printAsRow = getenv("CPPMEMO_PRINT_AS_ROW") != nullptr;
+
+    if (policyName == "pow2") {
+        return benchmark<PowerOfTwoCapacityPolicy>(numThreads, numEntries, policyName, printAsRow);
+    } else if (policyName == "fastprime") {
+        return benchmark<FastPrimeCapacityPolicy>(numThreads, numEntries, policyName, printAsRow);
+    } else {
+        return benchmark<PrimeCapacityPolicy>(numThreads, numEntries, policyName, printAsRow);
+    }
+
+}
@@ -0,0 +1,27 @@
+#!/bin/bash
+
+EXECUTABLE=./fcmm_throughput
+
+# Feel free to change the three variables below as needed
+CAPACITY_POLICY_LIST="prime fastprime pow2"
+NUMBER_OF_ENTRIES_LIST="1000000 10000000"
+NUMBER_OF_THREADS_LIST="1 2 4 8"
+
+export CPPMEMO_PRINT_AS_ROW=1
+
+# Print table header
+echo "Capacity policy   Number of entries   Number of threads   Insert (Mops/sec.)  Hit (Mops/sec.)     Miss (Mops/sec.)"
+echo "-------------------------------------------------------------------------------------------------------------------"
+
+for NUMBER_OF_ENTRIES in $NUMBER_OF_ENTRIES_LIST
+do
+    for NUMBER_OF_THREADS in $NUMBER_OF_THREADS_LIST
+    do
+        for CAPACITY_POLICY in $CAPACITY_POLICY_LIST
+        do
+            $EXECUTABLE $NUMBER_OF_THREADS $NUMBER_OF_ENTRIES $CAPACITY_POLICY
+        done
+    done
+done
+
+unset CPPMEMO_PRINT_AS_ROW
@@ -3,6 +3,7 @@
 
 #include <iostream>
 #include <iomanip> // std::setw
+#include <string>
 
 using namespace cppmemo;
 
@@ -59,8 +60,9 @@ int knapsack(const Key& key, CppMemoType::PrerequisitesProvider prereqs) {
 
 int main(int argc, char** argv) {
 
-    if (argc != 3) {
-        std::cerr << "usage: knapsack NUMBER_OF_THREADS KNAPSACK_CAPACITY" << std::endl;
+    const std::string option = argc == 4 ? argv[3] : "";
+    if (argc != 3 && !(argc == 4 && (option == "dataflow" || option == "tabulate"))) {
+        std::cerr << "usage: knapsack NUMBER_OF_THREADS KNAPSACK_CAPACITY [dataflow|tabulate]" << std::endl;
         return -1;
     }
 
@@ -71,9 +73,23 @@ int main(int argc, char** argv) {
     const bool printAsRow = getenv("CPPMEMO_PRINT_AS_ROW") != nullptr;
 
     CppMemoType cppMemo(numThreads, numItems * knapsackCapacity);
+    if (option == "dataflow") {
+        cppMemo.setExecutionMode(ExecutionMode::DATAFLOW);
+    }
     int maxValue;
 
     const Timestamp start = now();
+    if (option == "tabulate") {
+        // fill the whole table bottom-up: the keys with the same number of items are independent
+        cppMemo.tabulate([numItems, knapsackCapacity](CppMemoType::KeysEnumerator& enumerateKey) {
+            for (int items = 0; items <= numItems; items++) {
+                for (int weight = 0; weight <= knapsackCapacity; weight++) {
+                    enumerateKey({ items, weight });
+                }
+                enumerateKey.nextLevel();
+            }
+        }, knapsack);
+    }
     // find prerequisites by dry-running the compute function (knapsack)
     maxValue = cppMemo.getValue({ numItems, knapsackCapacity }, knapsack);
     const Timestamp end = now();
@@ -103,6 +119,7 @@ int main(int argc, char** argv) {
 
         std::cout << std::endl;
         std::cout << "Elapsed time (sec.): " << timeElapsed << std::endl;
+        std::cout << "Duplicate computations avoided: " << cppMemo.getStats().numAvoidedComputations << std::endl;
 
     } else {
 
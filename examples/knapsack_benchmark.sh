@@ -4,7 +4,7 @@ EXECUTABLE=./knapsack
 
 # Feel free to change the two variables below as needed
 KNAPSACK_CAPACITIES_LIST="50000 100000 150000 200000 500000"
-NUMBER_OF_THREADS_LIST="1 2 4 8"
+NUMBER_OF_THREADS_LIST="1 2 4 8 16"
 
 export CPPMEMO_PRINT_AS_ROW=1
 
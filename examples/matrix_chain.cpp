@@ -3,6 +3,8 @@
 
 #include <iostream>
 #include <iomanip> // std::setw
+#include <random> // std::minstd_rand
+#include <string>
 
 using namespace cppmemo;
 
@@ -40,9 +42,20 @@ struct Result {
     int bestSplit;
 };
 
+struct RangeCoordinates {
+    std::pair<std::size_t, std::size_t> operator()(const Range& range) const {
+        return std::make_pair(range.from, range.to);
+    }
+};
+
 typedef CppMemo<Range, Result, RangeHash1, RangeHash2> CppMemoType;
 
-void declarePrerequisites(Range range, CppMemoType::PrerequisitesGatherer declare) {
+// ranges are intervals: they can be stored in a triangular array rather than in a hashmap
+typedef CppMemo<Range, Result, RangeHash1, RangeHash2, std::equal_to<Range>,
+        DenseStorage<Range, Result, TriangularShape<Range, RangeCoordinates> > > DenseCppMemoType;
+
+template<typename CppMemoType>
+void declarePrerequisites(Range range, typename CppMemoType::PrerequisitesGatherer declare) {
     const int size = range.to - range.from + 1;
     for (int i = 0; i < size - 1; i++) {
         const int split = range.from + i;
@@ -53,7 +66,8 @@ void declarePrerequisites(Range range, CppMemoType::PrerequisitesGatherer declar
 
 std::vector<Matrix> matrices;
 
-Result calculate(Range range, CppMemoType::PrerequisitesProvider prereqs) {
+template<typename CppMemoType>
+Result calculate(Range range, typename CppMemoType::PrerequisitesProvider prereqs) {
 
     const int size = range.to - range.from + 1;
 
@@ -81,6 +95,7 @@ Result calculate(Range range, CppMemoType::PrerequisitesProvider prereqs) {
 
 }
 
+template<typename CppMemoType>
 std::string parenthesize(const Range& range, const CppMemoType& cppMemo) {
 
     const int size = range.to - range.from + 1;
@@ -96,13 +111,45 @@ std::string parenthesize(const Range& range, const CppMemoType& cppMemo) {
 
 }
 
+template<typename CppMemoType>
+void solve(CppMemoType& cppMemo, int numThreads, int numMatrices, bool printAsRow) {
+
+    const Range fullRange { 0, (int) matrices.size() - 1 };
+    Result result;
+
+    const Timestamp start = now();
+    result = cppMemo.getValue(fullRange, calculate<CppMemoType>, declarePrerequisites<CppMemoType>);
+    const Timestamp end = now();
+    const double timeElapsed = elapsedSeconds(start, end);
+
+    if (!printAsRow) {
+
+        std::cout << "Best parenthesization: " << parenthesize(fullRange, cppMemo) << std::endl;
+        std::cout << "Cost: " << result.lowestCost << std::endl;
+
+        std::cout << std::endl;
+        std::cout << "Elapsed time (sec.): " << timeElapsed << std::endl;
+        std::cout << "Duplicate computations avoided: " << cppMemo.getStats().numAvoidedComputations << std::endl;
+
+    } else {
+
+        std::cout << std::left << std::fixed << std::setprecision(3)
+                  << std::setw(21) << numMatrices
+                  << std::setw(20) << numThreads
+                  << std::setw(19) << timeElapsed
+                  << std::endl;
+
+    }
+
+}
+
 static const int MATRIX_MIN_DIM = 3;
 static const int MATRIX_MAX_DIM = 10;
 
 int main(int argc, char** argv) {
 
-    if (argc != 3) {
-        std::cerr << "usage: matrix_chain NUMBER_OF_THREADS NUMBER_OF_MATRICES" << std::endl;
+    if (argc != 3 && !(argc == 4 && std::string(argv[3]) == "dense")) {
+        std::cerr << "usage: matrix_chain NUMBER_OF_THREADS NUMBER_OF_MATRICES [dense]" << std::endl;
         return -1;
     }
 
@@ -133,32 +180,13 @@ int main(int argc, char** argv) {
         std::cout << std::endl;
     }
 
-    CppMemoType cppMemo(numThreads, numMatrices * numMatrices);
-
-    const Range fullRange { 0, (int) matrices.size() - 1 };
-    Result result;
-
-    const Timestamp start = now();
-    result = cppMemo.getValue(fullRange, calculate, declarePrerequisites);
-    const Timestamp end = now();
-    const double timeElapsed = elapsedSeconds(start, end);
-
-    if (!printAsRow) {
-
-        std::cout << "Best parenthesization: " << parenthesize(fullRange, cppMemo) << std::endl;
-        std::cout << "Cost: " << result.lowestCost << std::endl;
-
-        std::cout << std::endl;
-        std::cout << "Elapsed time (sec.): " << timeElapsed << std::endl;
-
+    if (argc == 4) {
+        DenseCppMemoType cppMemo(std::piecewise_construct, numThreads, 0, false,
+                                 TriangularShape<Range, RangeCoordinates>(numMatrices));
+        solve(cppMemo, numThreads, numMatrices, printAsRow);
     } else {
-
-        std::cout << std::left << std::fixed << std::setprecision(3)
-                  << std::setw(21) << numMatrices
-                  << std::setw(20) << numThreads
-                  << std::setw(19) << timeElapsed
-                  << std::endl;
-
+        CppMemoType cppMemo(numThreads, numMatrices * numMatrices);
+        solve(cppMemo, numThreads, numMatrices, printAsRow);
     }
 
     return EXIT_SUCCESS;
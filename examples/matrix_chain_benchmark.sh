@@ -4,7 +4,7 @@ EXECUTABLE=./matrix_chain
 
 # Feel free to change the two variables below as needed
 NUMBER_OF_MATRICES_LIST="100 200 300 400 500"
-NUMBER_OF_THREADS_LIST="1 2 4 8"
+NUMBER_OF_THREADS_LIST="1 2 4 8 16"
 
 export CPPMEMO_PRINT_AS_ROW=1
 
@@ -0,0 +1,77 @@
+#include "cppmemo.hpp"
+
+#include <iostream>
+#include <memory> // std::unique_ptr
+#include <vector>
+
+using namespace cppmemo;
+
+// a row of Pascal's triangle, held by a move-only pointer
+typedef std::unique_ptr<std::vector<long long> > Row;
+
+typedef CppMemo<int, Row> CppMemoType;
+
+Row pascalRow(int n, CppMemoType::PrerequisitesProvider prereqs) {
+    Row row(new std::vector<long long>(n + 1, 1));
+    if (n >= 2) {
+        const Row& previous = prereqs(n - 1);
+        if (!previous) return Row(); // dry run: the previous row is missing
+        for (int k = 1; k < n; k++) {
+            (*row)[k] = (*previous)[k - 1] + (*previous)[k];
+        }
+    }
+    return row;
+}
+
+// a move-only value that cannot be default-constructed, stored in a Fcmm
+class Binomial {
+
+private:
+
+    std::unique_ptr<long long> value;
+
+public:
+
+    explicit Binomial(long long value) : value(new long long(value)) {
+    }
+
+    Binomial(Binomial&&) = default;
+
+    long long get() const {
+        return *value;
+    }
+
+};
+
+static const int ROW_NO = 60;
+
+int main(void) {
+
+    // rows computed by a single thread (stored by insert) and by two threads (stored by insertExclusive)
+    CppMemoType singleThreadMemo(1);
+    CppMemoType multiThreadMemo(2);
+    const Row& singleThreadRow = singleThreadMemo.getValue(ROW_NO, pascalRow);
+    const Row& multiThreadRow = multiThreadMemo.getValue(ROW_NO, pascalRow);
+
+    // the binomial coefficients of the row, stored both ways
+    fcmm::Fcmm<int, Binomial> binomials;
+    for (int k = 0; k <= ROW_NO; k++) {
+        const auto computeBinomial = [&singleThreadRow](int k) { return Binomial((*singleThreadRow)[k]); };
+        if (k % 2 == 0) {
+            binomials.insert(k, computeBinomial);
+        } else {
+            binomials.insertExclusive(k, computeBinomial);
+        }
+    }
+
+    bool succeeded = *singleThreadRow == *multiThreadRow;
+    for (int k = 0; k <= ROW_NO; k++) {
+        succeeded = succeeded && binomials.find(k)->second.get() == (*singleThreadRow)[k];
+    }
+
+    std::cout << "Central binomial coefficient of row #" << ROW_NO << ": " << (*singleThreadRow)[ROW_NO / 2] << std::endl;
+    std::cout << (succeeded ? "TEST SUCCEEDED" : "TEST FAILED") << std::endl;
+
+    return succeeded ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}
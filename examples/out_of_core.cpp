@@ -0,0 +1,89 @@
+#include "cppmemo.hpp"
+#include "common.hpp"
+
+#include <iostream>
+#include <iomanip> // std::setw
+#include <fstream>
+#include <string>
+#include <unistd.h> // sysconf
+
+using namespace cppmemo;
+
+typedef CppMemo<long, long long> CppMemoType;
+
+static const long long MODULUS = 1000000007;
+
+static long maxN; // keys encode (n, k) as n * (maxN + 1) + k
+
+long makeKey(long n, long k) {
+    return n * (maxN + 1) + k;
+}
+
+// number of partitions of n into parts not greater than k
+long long partitions(long key, CppMemoType::PrerequisitesProvider prereqs) {
+    const long n = key / (maxN + 1);
+    const long k = key % (maxN + 1);
+    if (n == 0) return 1;
+    if (k == 0) return 0;
+    const long long withoutK = prereqs(makeKey(n, k - 1));
+    const long long withK = k <= n ? prereqs(makeKey(n - k, k)) : 0;
+    return (withoutK + withK) % MODULUS;
+}
+
+// resident anonymous memory of this process in megabytes, i.e. the memory that cannot be evicted to files (0 if unknown)
+double anonymousMegabytes() {
+    std::ifstream statm("/proc/self/statm");
+    long size = 0, resident = 0, shared = 0;
+    if (!(statm >> size >> resident >> shared)) {
+        return 0.0;
+    }
+    return (double) (resident - shared) * sysconf(_SC_PAGESIZE) / (1024 * 1024);
+}
+
+int main(int argc, char** argv) {
+
+    if (argc != 3 && argc != 4) {
+        std::cerr << "usage: out_of_core NUMBER_OF_THREADS N [SPILL_DIRECTORY]" << std::endl;
+        return -1;
+    }
+
+    const int numThreads = std::stoi(argv[1]);
+    maxN = std::stol(argv[2]);
+    const std::string spillDirectory = argc == 4 ? argv[3] : "";
+
+    const bool printAsRow = getenv("CPPMEMO_PRINT_AS_ROW") != nullptr;
+
+    // compute the number of partitions of N, spilling the cold memoized values to disk if a directory is given
+    const Timestamp start = now();
+    CppMemoType cppMemo(std::piecewise_construct, numThreads, 0, false, 0, spillDirectory);
+    const long long result = cppMemo.getValue(makeKey(maxN, maxN), partitions);
+    const double elapsedTime = elapsedSeconds(start, now());
+
+    const double anonymous = anonymousMegabytes();
+    const std::size_t numEntries = cppMemo.getStats().numEntries;
+
+    if (!printAsRow) {
+
+        std::cout << "Result: " << result << std::endl;
+        std::cout << "Number of memoized entries: " << numEntries << std::endl;
+        std::cout << "Spill directory: " << (spillDirectory.empty() ? "none" : spillDirectory) << std::endl;
+
+        std::cout << std::endl;
+        std::cout << "Elapsed time (sec.): " << elapsedTime << std::endl;
+        std::cout << "Anonymous memory (MB): " << anonymous << std::endl;
+
+    } else {
+
+        std::cout << std::left << std::fixed << std::setprecision(3)
+                  << std::setw(20) << numThreads
+                  << std::setw(20) << maxN
+                  << std::setw(20) << (spillDirectory.empty() ? "no" : "yes")
+                  << std::setw(20) << elapsedTime
+                  << std::setw(19) << anonymous
+                  << std::endl;
+
+    }
+
+    return EXIT_SUCCESS;
+
+}
@@ -0,0 +1,26 @@
+#!/bin/bash
+
+EXECUTABLE=./out_of_core
+
+# Feel free to change the three variables below as needed
+# (multi-thread queries keep a node per discovered key in memory, so only one thread runs out of core)
+NUM_THREADS_LIST="1"
+N_LIST="2000 4000"
+SPILL_DIRECTORY=/var/tmp
+
+export CPPMEMO_PRINT_AS_ROW=1
+
+# Print table header
+echo "Threads             N                   Spill               Time (sec.)         Anonymous (MB)"
+echo "-----------------------------------------------------------------------------------------------"
+
+for N in $N_LIST
+do
+    for NUM_THREADS in $NUM_THREADS_LIST
+    do
+        $EXECUTABLE $NUM_THREADS $N
+        $EXECUTABLE $NUM_THREADS $N $SPILL_DIRECTORY
+    done
+done
+
+unset CPPMEMO_PRINT_AS_ROW
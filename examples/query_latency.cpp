@@ -0,0 +1,62 @@
+#include "cppmemo.hpp"
+#include "common.hpp"
+
+#include <iostream>
+#include <iomanip> // std::setw
+
+using namespace cppmemo;
+
+typedef CppMemo<int, long long> CppMemoType;
+
+static const long long MODULUS = 1000000007;
+
+long long sequence(int i, CppMemoType::PrerequisitesProvider prereqs) {
+    if (i < 2) return i;
+    return (prereqs(i-1) + prereqs(i-2)) % MODULUS;
+}
+
+int main(int argc, char** argv) {
+
+    if (argc != 3) {
+        std::cerr << "usage: query_latency NUMBER_OF_THREADS NUMBER_OF_QUERIES" << std::endl;
+        return -1;
+    }
+
+    const int numThreads = std::stoi(argv[1]);
+    const int numQueries = std::stoi(argv[2]);
+
+    const bool printAsRow = getenv("CPPMEMO_PRINT_AS_ROW") != nullptr;
+
+    CppMemoType cppMemo(numThreads, numQueries);
+    long long result = 0;
+
+    // every query only misses its own key: the cost of a query is dominated by the execution overhead
+    const Timestamp start = now();
+    for (int i = 0; i < numQueries; i++) {
+        result = cppMemo.getValue(i, sequence);
+    }
+    const Timestamp end = now();
+    const double timeElapsed = elapsedSeconds(start, end);
+    const double latency = timeElapsed * 1e6 / numQueries;
+
+    if (!printAsRow) {
+
+        std::cout << "Result: " << result << std::endl;
+
+        std::cout << std::endl;
+        std::cout << "Elapsed time (sec.): " << timeElapsed << std::endl;
+        std::cout << "Average query latency (usec.): " << latency << std::endl;
+
+    } else {
+
+        std::cout << std::left << std::fixed << std::setprecision(3)
+                  << std::setw(20) << numQueries
+                  << std::setw(20) << numThreads
+                  << std::setw(19) << latency
+                  << std::endl;
+
+    }
+
+    return EXIT_SUCCESS;
+
+}
@@ -0,0 +1,23 @@
+#!/bin/bash
+
+EXECUTABLE=./query_latency
+
+# Feel free to change the two variables below as needed
+NUMBER_OF_QUERIES_LIST="10000 100000"
+NUMBER_OF_THREADS_LIST="1 2 4 8"
+
+export CPPMEMO_PRINT_AS_ROW=1
+
+# Print table header
+echo "Number of queries   Number of threads   Avg. latency (usec.)"
+echo "------------------------------------------------------------"
+
+for NUMBER_OF_QUERIES in $NUMBER_OF_QUERIES_LIST
+do
+    for NUMBER_OF_THREADS in $NUMBER_OF_THREADS_LIST
+    do
+        $EXECUTABLE $NUMBER_OF_THREADS $NUMBER_OF_QUERIES
+    done
+done
+
+unset CPPMEMO_PRINT_AS_ROW
@@ -0,0 +1,240 @@
+#include "cppmemo.hpp"
+#include "common.hpp"
+
+#include <iostream>
+#include <iomanip> // std::setw
+#include <random> // std::minstd_rand
+#include <string>
+#include <limits>
+#include <cstdlib> // mkdtemp
+#include <sys/mman.h> // mmap
+#include <sys/wait.h> // wait
+#include <unistd.h> // fork, rmdir
+
+using namespace cppmemo;
+
+struct Range {
+    int from;
+    int to;
+    bool operator==(const Range& other) const {
+        return other.from == from && other.to == to;
+    }
+};
+
+struct RangeHash1 {
+    std::size_t operator()(const Range& range) const {
+        // FNV hash
+        std::size_t hash = 2166136261;
+        hash = (hash * 16777619) ^ range.from;
+        hash = (hash * 16777619) ^ range.to;
+        return hash;
+    }
+};
+
+struct RangeHash2 {
+    std::size_t operator()(const Range& range) const {
+        return range.from ^ range.to;
+    }
+};
+
+struct Matrix {
+    int p;
+    int q;
+};
+
+struct Result {
+    int lowestCost;
+    int bestSplit;
+};
+
+typedef CppMemo<Range, Result, RangeHash1, RangeHash2> CppMemoType;
+
+// the ranges are partitioned among the shards by their first hash
+typedef CppMemo<Range, Result, RangeHash1, RangeHash2, std::equal_to<Range>,
+        ShardedStorage<Range, Result, RangeHash1, RangeHash2> > ShardedCppMemoType;
+
+std::vector<Matrix> matrices;
+
+// the ranges are enumerated by size: the subranges of a range are smaller, hence in previous levels
+template<typename CppMemoType>
+void enumerateRanges(typename CppMemoType::KeysEnumerator& enumerator) {
+    const int numMatrices = (int) matrices.size();
+    for (int size = 1; size <= numMatrices; size++) {
+        for (int from = 0; from + size <= numMatrices; from++) {
+            enumerator({ from, from + size - 1 });
+        }
+        enumerator.nextLevel();
+    }
+}
+
+template<typename CppMemoType>
+void declarePrerequisites(Range range, typename CppMemoType::PrerequisitesGatherer declare) {
+    const int size = range.to - range.from + 1;
+    for (int i = 0; i < size - 1; i++) {
+        const int split = range.from + i;
+        declare({ range.from, split });
+        declare({ split + 1, range.to });
+    }
+}
+
+template<typename CppMemoType>
+Result calculate(Range range, typename CppMemoType::PrerequisitesProvider prereqs) {
+
+    const int size = range.to - range.from + 1;
+
+    if (size == 1) return { 0, range.from };
+
+    int lowestCost = std::numeric_limits<int>::max();
+    int bestSplit = 0;
+
+    for (int i = 0; i < size - 1; i++) {
+        const int split = range.from + i;
+        const Range subrange1 { range.from, split };
+        const Range subrange2 { split + 1, range.to };
+        const Matrix& first = matrices[subrange1.from];
+        const Matrix& middle = matrices[subrange1.to];
+        const Matrix& last = matrices[subrange2.to];
+        const int cost = prereqs(subrange1).lowestCost + prereqs(subrange2).lowestCost +
+                (first.p * middle.q * last.q);
+        if (cost < lowestCost) {
+            lowestCost = cost;
+            bestSplit = split;
+        }
+    }
+
+    return { lowestCost, bestSplit };
+
+}
+
+struct ShardResult {
+    int lowestCost;
+    std::size_t numEntries; // including the values fetched from the other shards
+};
+
+// runs each shard in its own process, returning false if any of them failed
+bool runShards(int numShards, int numThreads, const std::string& socketDirectory, ShardResult* results) {
+    const Range fullRange { 0, (int) matrices.size() - 1 };
+    for (int shard = 0; shard < numShards; shard++) {
+        const pid_t pid = fork();
+        if (pid < 0) {
+            return false;
+        }
+        if (pid == 0) {
+            try {
+                ShardedCppMemoType cppMemo(std::piecewise_construct, numThreads, 0, false,
+                                           socketDirectory, numShards, shard, matrices.size() * matrices.size() / 2);
+                cppMemo.tabulateSharded(enumerateRanges<ShardedCppMemoType>, calculate<ShardedCppMemoType>,
+                                        declarePrerequisites<ShardedCppMemoType>, numThreads);
+                results[shard].lowestCost = cppMemo.getShardedValue(fullRange).lowestCost;
+                results[shard].numEntries = cppMemo.getStats().numEntries;
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+                _exit(EXIT_FAILURE);
+            }
+            _exit(EXIT_SUCCESS);
+        }
+    }
+    bool succeeded = true;
+    for (int shard = 0; shard < numShards; shard++) {
+        int status;
+        succeeded = wait(&status) > 0 && WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS && succeeded;
+    }
+    return succeeded;
+}
+
+static const int MATRIX_MIN_DIM = 3;
+static const int MATRIX_MAX_DIM = 10;
+
+int main(int argc, char** argv) {
+
+    if (argc != 4) {
+        std::cerr << "usage: sharded_matrix_chain NUMBER_OF_SHARDS NUMBER_OF_THREADS NUMBER_OF_MATRICES" << std::endl;
+        return -1;
+    }
+
+    const int numShards = std::stoi(argv[1]);
+    const int numThreads = std::stoi(argv[2]);
+    const int numMatrices = std::stoi(argv[3]);
+
+    const bool printAsRow = getenv("CPPMEMO_PRINT_AS_ROW") != nullptr;
+
+    if (numShards < 1 || numMatrices < 1) {
+        std::cerr << "The number of shards and the number of matrices must be positive" << std::endl;
+        return -1;
+    }
+
+    std::minstd_rand randGen;
+    std::uniform_int_distribution<int> randNum(MATRIX_MIN_DIM, MATRIX_MAX_DIM);
+
+    std::vector<int> p(numMatrices + 1);
+    for (std::size_t i = 0; i < (std::size_t) numMatrices + 1; i++) {
+        p[i] = randNum(randGen);
+        if (i > 0) matrices.push_back({ p[i - 1], p[i] });
+    }
+
+    // the results of the shards are written to memory shared with this process
+    void* mapping = mmap(nullptr, numShards * sizeof(ShardResult), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    char socketDirectory[] = "/tmp/cppmemo-shards-XXXXXX";
+    if (mapping == MAP_FAILED || mkdtemp(socketDirectory) == nullptr) {
+        std::cerr << "Cannot set up the shards" << std::endl;
+        return EXIT_FAILURE;
+    }
+    ShardResult* results = static_cast<ShardResult*>(mapping);
+
+    // the shards compute the ranges they own, fetching the others from their owners
+    Timestamp start = now();
+    bool succeeded = runShards(numShards, numThreads, socketDirectory, results);
+    const double shardedTime = elapsedSeconds(start, now());
+    rmdir(socketDirectory);
+
+    // a single process computes all the ranges
+    const Range fullRange { 0, numMatrices - 1 };
+    int lowestCost;
+    std::size_t numEntries;
+    start = now();
+    {
+        CppMemoType cppMemo(numThreads, numMatrices * numMatrices / 2);
+        cppMemo.tabulate(enumerateRanges<CppMemoType>, calculate<CppMemoType>, numThreads);
+        lowestCost = cppMemo.getValue(fullRange).lowestCost;
+        numEntries = cppMemo.getStats().numEntries;
+    }
+    const double singleTime = elapsedSeconds(start, now());
+
+    std::size_t numShardedEntries = 0;
+    for (int shard = 0; shard < numShards; shard++) {
+        succeeded = succeeded && results[shard].lowestCost == lowestCost;
+        numShardedEntries += results[shard].numEntries;
+    }
+
+    munmap(mapping, numShards * sizeof(ShardResult));
+
+    if (!succeeded) {
+        std::cerr << "Wrong results" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (!printAsRow) {
+
+        std::cout << "Cost: " << lowestCost << std::endl;
+        std::cout << "Number of entries, single process: " << numEntries << std::endl;
+        std::cout << "Number of entries, all the shards (including the fetched ones): " << numShardedEntries << std::endl;
+
+        std::cout << std::endl;
+        std::cout << "Elapsed time, single process (sec.): " << singleTime << std::endl;
+        std::cout << "Elapsed time, shards (sec.): " << shardedTime << std::endl;
+
+    } else {
+
+        std::cout << std::left << std::fixed << std::setprecision(3)
+                  << std::setw(20) << numShards
+                  << std::setw(20) << numThreads
+                  << std::setw(20) << numMatrices
+                  << std::setw(20) << singleTime
+                  << std::setw(19) << shardedTime
+                  << std::endl;
+
+    }
+
+    return EXIT_SUCCESS;
+
+}
@@ -0,0 +1,24 @@
+#!/bin/bash
+
+EXECUTABLE=./sharded_matrix_chain
+
+# Feel free to change the three variables below as needed
+NUM_SHARDS_LIST="1 2 4 8"
+NUM_THREADS=1
+NUM_MATRICES_LIST="600 1000"
+
+export CPPMEMO_PRINT_AS_ROW=1
+
+# Print table header
+echo "Shards              Threads             Matrices            Time (single)       Time (sharded)"
+echo "----------------------------------------------------------------------------------------------"
+
+for NUM_MATRICES in $NUM_MATRICES_LIST
+do
+    for NUM_SHARDS in $NUM_SHARDS_LIST
+    do
+        $EXECUTABLE $NUM_SHARDS $NUM_THREADS $NUM_MATRICES
+    done
+done
+
+unset CPPMEMO_PRINT_AS_ROW
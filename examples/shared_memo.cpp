@@ -0,0 +1,173 @@
+#include "cppmemo.hpp"
+#include "common.hpp"
+
+#include <iostream>
+#include <iomanip> // std::setw
+#include <string>
+#include <atomic>
+#include <sys/mman.h> // mmap
+#include <sys/wait.h> // waitpid
+#include <unistd.h> // fork
+
+using namespace cppmemo;
+
+typedef CppMemo<long, long long> CppMemoType;
+typedef SharedStorage<long, long long> SharedStorageType;
+typedef CppMemo<long, long long, std::hash<long>, fcmm::DefaultKeyHash2<long>, std::equal_to<long>, SharedStorageType> SharedCppMemoType;
+
+static const long long MODULUS = 1000000007;
+
+static long maxN; // keys encode (n, k) as n * (maxN + 1) + k
+
+static std::atomic<long> numComputations(0);
+
+long makeKey(long n, long k) {
+    return n * (maxN + 1) + k;
+}
+
+// number of partitions of n into parts not greater than k
+template<typename PrerequisitesProvider>
+long long partitions(long key, PrerequisitesProvider prereqs) {
+    numComputations.fetch_add(1, std::memory_order_relaxed);
+    const long n = key / (maxN + 1);
+    const long k = key % (maxN + 1);
+    if (n == 0) return 1;
+    if (k == 0) return 0;
+    const long long withoutK = prereqs(makeKey(n, k - 1));
+    const long long withK = k <= n ? prereqs(makeKey(n - k, k)) : 0;
+    return (withoutK + withK) % MODULUS;
+}
+
+struct WorkerResult {
+    long long result;
+    long numComputations;
+};
+
+// worker i computes the number of partitions of N - i: the instances of the workers overlap
+long long runWorker(int worker, int numThreads, const std::string& sharedName) {
+    const long n = maxN - worker;
+    if (sharedName.empty()) {
+        CppMemoType cppMemo;
+        return cppMemo.getValue(makeKey(n, n), partitions<CppMemoType::PrerequisitesProvider>, numThreads);
+    } else {
+        SharedCppMemoType cppMemo(std::piecewise_construct, numThreads, 0, false, sharedName);
+        return cppMemo.getValue(makeKey(n, n), partitions<SharedCppMemoType::PrerequisitesProvider>);
+    }
+}
+
+// runs the workers as separate processes, returning false if any of them failed
+bool runWorkers(int numProcesses, int numThreads, const std::string& sharedName, WorkerResult* results) {
+    for (int worker = 0; worker < numProcesses; worker++) {
+        const pid_t pid = fork();
+        if (pid < 0) {
+            return false;
+        }
+        if (pid == 0) {
+            try {
+                results[worker].result = runWorker(worker, numThreads, sharedName);
+                results[worker].numComputations = numComputations.load();
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+                _exit(EXIT_FAILURE);
+            }
+            _exit(EXIT_SUCCESS);
+        }
+    }
+    bool succeeded = true;
+    for (int worker = 0; worker < numProcesses; worker++) {
+        int status;
+        succeeded = wait(&status) > 0 && WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS && succeeded;
+    }
+    return succeeded;
+}
+
+int main(int argc, char** argv) {
+
+    if (argc != 4) {
+        std::cerr << "usage: shared_memo NUMBER_OF_PROCESSES NUMBER_OF_THREADS N" << std::endl;
+        return -1;
+    }
+
+    const int numProcesses = std::stoi(argv[1]);
+    const int numThreads = std::stoi(argv[2]);
+    maxN = std::stol(argv[3]);
+
+    const bool printAsRow = getenv("CPPMEMO_PRINT_AS_ROW") != nullptr;
+
+    if (numProcesses < 1 || numProcesses > maxN) {
+        std::cerr << "The number of processes must be between 1 and N" << std::endl;
+        return -1;
+    }
+
+    // the results of the workers are written to memory shared with this process
+    void* mapping = mmap(nullptr, 2 * numProcesses * sizeof(WorkerResult), PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) {
+        std::cerr << "Cannot map the results" << std::endl;
+        return EXIT_FAILURE;
+    }
+    WorkerResult* privateResults = static_cast<WorkerResult*>(mapping);
+    WorkerResult* sharedResults = privateResults + numProcesses;
+
+    // each worker memoizes the values in its own storage
+    Timestamp start = now();
+    bool succeeded = runWorkers(numProcesses, numThreads, "", privateResults);
+    const double privateTime = elapsedSeconds(start, now());
+
+    // the workers memoize the values in a storage shared by all of them (created here, before they start)
+    const std::string sharedName = "/cppmemo-shared-memo-" + std::to_string(getpid());
+    SharedStorageType::remove(sharedName);
+    std::size_t numSharedEntries;
+    start = now();
+    {
+        SharedStorageType storage(sharedName, (std::size_t) (maxN + 1) * (maxN + 1) / 2);
+        succeeded = runWorkers(numProcesses, numThreads, sharedName, sharedResults) && succeeded;
+        numSharedEntries = storage.getStats().numEntries;
+    }
+    const double sharedTime = elapsedSeconds(start, now());
+    SharedStorageType::remove(sharedName);
+
+    const long long result = privateResults[0].result;
+    long privateComputations = 0;
+    long sharedComputations = 0;
+    for (int worker = 0; worker < numProcesses; worker++) {
+        succeeded = succeeded && sharedResults[worker].result == privateResults[worker].result;
+        privateComputations += privateResults[worker].numComputations;
+        sharedComputations += sharedResults[worker].numComputations;
+    }
+
+    munmap(mapping, 2 * numProcesses * sizeof(WorkerResult));
+
+    if (!succeeded) {
+        std::cerr << "Wrong results" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (!printAsRow) {
+
+        std::cout << "Result of the first worker: " << result << std::endl;
+        std::cout << "Number of shared entries: " << numSharedEntries << std::endl;
+
+        std::cout << std::endl;
+        std::cout << "Computations, private storages: " << privateComputations << std::endl;
+        std::cout << "Computations, shared storage: " << sharedComputations << std::endl;
+        std::cout << "Elapsed time, private storages (sec.): " << privateTime << std::endl;
+        std::cout << "Elapsed time, shared storage (sec.): " << sharedTime << std::endl;
+
+    } else {
+
+        std::cout << std::left << std::fixed << std::setprecision(3)
+                  << std::setw(20) << numProcesses
+                  << std::setw(20) << numThreads
+                  << std::setw(20) << maxN
+                  << std::setw(20) << privateComputations
+                  << std::setw(20) << sharedComputations
+                  << std::setw(20) << privateTime
+                  << std::setw(19) << sharedTime
+                  << std::endl;
+
+    }
+
+    return EXIT_SUCCESS;
+
+}
@@ -0,0 +1,24 @@
+#!/bin/bash
+
+EXECUTABLE=./shared_memo
+
+# Feel free to change the three variables below as needed
+NUM_PROCESSES_LIST="1 2 4 8"
+NUM_THREADS=1
+N_LIST="1500 2000"
+
+export CPPMEMO_PRINT_AS_ROW=1
+
+# Print table header
+echo "Processes           Threads             N                   Comp. (private)     Comp. (shared)      Time (private)      Time (shared)"
+echo "-----------------------------------------------------------------------------------------------------------------------------------------"
+
+for N in $N_LIST
+do
+    for NUM_PROCESSES in $NUM_PROCESSES_LIST
+    do
+        $EXECUTABLE $NUM_PROCESSES $NUM_THREADS $N
+    done
+done
+
+unset CPPMEMO_PRINT_AS_ROW
@@ -0,0 +1,97 @@
+#include "cppmemo.hpp"
+#include "common.hpp"
+
+#include <iostream>
+#include <iomanip> // std::setw
+#include <string>
+#include <cstdio> // std::remove
+
+using namespace cppmemo;
+
+typedef CppMemo<long, long long> CppMemoType;
+
+static const long long MODULUS = 1000000007;
+
+static long maxN; // keys encode (n, k) as n * (maxN + 1) + k
+
+long makeKey(long n, long k) {
+    return n * (maxN + 1) + k;
+}
+
+// number of partitions of n into parts not greater than k
+long long partitions(long key, CppMemoType::PrerequisitesProvider prereqs) {
+    const long n = key / (maxN + 1);
+    const long k = key % (maxN + 1);
+    if (n == 0) return 1;
+    if (k == 0) return 0;
+    const long long withoutK = prereqs(makeKey(n, k - 1));
+    const long long withK = k <= n ? prereqs(makeKey(n - k, k)) : 0;
+    return (withoutK + withK) % MODULUS;
+}
+
+int main(int argc, char** argv) {
+
+    if (argc != 3) {
+        std::cerr << "usage: warm_start N SNAPSHOT_FILE" << std::endl;
+        return -1;
+    }
+
+    maxN = std::stol(argv[1]);
+    const std::string snapshotFilename = argv[2];
+
+    const bool printAsRow = getenv("CPPMEMO_PRINT_AS_ROW") != nullptr;
+
+    // cold start: compute the number of partitions of every n up to N, then save the memoized values
+    long long coldResult = 0;
+    Timestamp start = now();
+    {
+        CppMemoType cppMemo;
+        for (long n = 0; n <= maxN; n++) {
+            coldResult ^= cppMemo.getValue(makeKey(n, n), partitions);
+        }
+        const Timestamp saveStart = now();
+        cppMemo.saveSnapshot(snapshotFilename);
+        start += now() - saveStart;
+    }
+    const double coldTime = elapsedSeconds(start, now());
+
+    // warm start: a fresh memoizer loads the snapshot and answers the same queries without computing anything
+    long long warmResult = 0;
+    start = now();
+    {
+        CppMemoType cppMemo;
+        cppMemo.loadSnapshot(snapshotFilename);
+        for (long n = 0; n <= maxN; n++) {
+            warmResult ^= cppMemo.getValue(makeKey(n, n), partitions);
+        }
+    }
+    const double warmTime = elapsedSeconds(start, now());
+
+    std::remove(snapshotFilename.c_str());
+
+    if (warmResult != coldResult) {
+        std::cerr << "Wrong results" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (!printAsRow) {
+
+        std::cout << "Result: " << coldResult << std::endl;
+
+        std::cout << std::endl;
+        std::cout << "Elapsed time, cold start (sec.): " << coldTime << std::endl;
+        std::cout << "Elapsed time, warm start (sec.): " << warmTime << std::endl;
+
+    } else {
+
+        std::cout << std::left << std::fixed << std::setprecision(3)
+                  << std::setw(20) << maxN
+                  << std::setw(20) << coldTime
+                  << std::setw(19) << warmTime
+                  << std::endl;
+
+    }
+
+    return EXIT_SUCCESS;
+
+}
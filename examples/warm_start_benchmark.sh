@@ -0,0 +1,20 @@
+#!/bin/bash
+
+EXECUTABLE=./warm_start
+
+# Feel free to change the two variables below as needed
+N_LIST="500 1000 2000"
+SNAPSHOT_FILE=/tmp/warm_start.snapshot
+
+export CPPMEMO_PRINT_AS_ROW=1
+
+# Print table header
+echo "N                   Cold start (sec.)   Warm start (sec.)"
+echo "---------------------------------------------------------"
+
+for N in $N_LIST
+do
+    $EXECUTABLE $N $SNAPSHOT_FILE
+done
+
+unset CPPMEMO_PRINT_AS_ROW
@@ -52,6 +52,15 @@
 #define FCMM_NOEXCEPT
 #endif
 
+// Rarely taken paths are kept out of the insertion path, so that the latter can still be inlined
+#if defined(_MSC_VER)
+#define FCMM_NOINLINE __declspec(noinline)
+#elif defined(__GNUC__)
+#define FCMM_NOINLINE __attribute__((noinline))
+#else
+#define FCMM_NOINLINE
+#endif
+
 #include <cstddef>
 #include <cstdint>
 #include <utility>
@@ -64,6 +73,37 @@
 #include <stdexcept>
 #include <atomic>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <new>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+
+// Control bytes are scanned with SSE2 instructions, if available (see Group)
+#if !defined(FCMM_NO_SSE2) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define FCMM_SSE2
+#include <emmintrin.h>
+#endif
+
+// 128-bit products are used for modulo reductions without divisions (see FastModulo), if available
+#if !defined(FCMM_NO_INT128) && defined(__SIZEOF_INT128__)
+#define FCMM_INT128
+#endif
+
+// Submaps are backed by anonymous memory mappings on POSIX systems (see ZeroedMemory), snapshots are mapped
+// into memory rather than read (see Snapshot), torn entry logs are truncated in place (see EntryLog),
+// and maps can be shared by processes (see SharedFcmm)
+#if !defined(FCMM_NO_MMAP) && (defined(__unix__) || defined(__APPLE__))
+#define FCMM_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
 
 namespace fcmm {
 
@@ -80,22 +120,87 @@ const float DEFAULT_MAX_LOAD_FACTOR = 0.75f;
 const std::size_t DEFAULT_MAX_NUM_SUBMAPS = 128;
 
 /**
- * @brief The capacity of a new submap is calculated as the first prime number following the capacity of the
- * last submap multiplied by this constant
+ * @brief The capacity of a new submap is calculated as the capacity of the last submap multiplied by this constant
+ * (then rounded up to a number of groups of buckets allowed by the capacity policy)
  */
 const std::size_t NEW_SUBMAPS_CAPACITY_MULTIPLIER = 8;
 
 /**
- * @brief Minimum capacity of the first submap (it has to be a prime number greater than 2)
+ * @brief The submap following the last one is allocated in advance once the load factor of the last submap reaches
+ * the maximum load factor multiplied by this constant (see Fcmm::preallocateSubmap())
+ */
+const float NEXT_SUBMAP_ALLOCATION_LOAD_RATIO = 0.75f;
+
+/**
+ * @brief Minimum capacity of the first submap
  */
 const std::size_t FIRST_SUBMAP_MIN_CAPACITY = 65537;
 
 /**
  * @brief The capacity of the first submap is calculated as:
- * <code>max(FIRST_SUBMAP_MIN_CAPACITY, nextPrime(<b>FIRST_SUBMAP_CAPACITY_MULTIPLIER</b> * estimatedNumEntries / maxLoadFactor))</code>
+ * <code>max(FIRST_SUBMAP_MIN_CAPACITY, <b>FIRST_SUBMAP_CAPACITY_MULTIPLIER</b> * estimatedNumEntries / maxLoadFactor)</code>
+ * (then rounded up to a number of groups of buckets allowed by the capacity policy)
  */
 const float FIRST_SUBMAP_CAPACITY_MULTIPLIER = 1.03f;
 
+/**
+ * @brief Number of buckets whose control bytes are scanned at once while probing a submap
+ */
+const std::size_t GROUP_SIZE = 16;
+
+/**
+ * @brief Number of keys hashed at once by Fcmm::findMany() and Fcmm::insertMany(), before any of them is probed
+ */
+const std::size_t BATCH_SIZE = 16;
+
+/**
+ * @brief Minimum number of bits per key in the Bloom filter of a frozen submap
+ * (the number of 64-bit words of the filter is rounded up to a power of two)
+ */
+const std::size_t BLOOM_FILTER_BITS_PER_KEY = 16;
+
+/**
+ * @brief Assumed size of a cache line: the atomic variables updated by many threads are kept this far apart
+ */
+const std::size_t CACHE_LINE_SIZE = 64;
+
+/**
+ * @brief Number of stripes of a StripedCounter
+ */
+const std::size_t COUNTER_NUM_STRIPES = 16;
+
+/**
+ * @brief Number of increments accumulated by a stripe of a StripedCounter before they are added to its approximate value
+ */
+const std::size_t COUNTER_BATCH_SIZE = 32;
+
+/**
+ * @brief Size of the explicit huge pages backing the submaps (see HugePages::EXPLICIT)
+ */
+const std::size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+/**
+ * @brief Number of groups of buckets of a frozen submap migrated to the last submap by each insertion
+ * (see Fcmm::helpMigration())
+ */
+const std::size_t MIGRATION_BATCH_NUM_GROUPS = 8;
+
+/**
+ * @brief Values larger than this size (in bytes) are stored out of line by default (see StoreValuesOutOfLine)
+ */
+const std::size_t MAX_INLINE_VALUE_SIZE = 64;
+
+/**
+ * @brief Number of entries of the first chunk of each stripe of an entry arena (see Fcmm::EntryArena):
+ * each further chunk of the stripe is twice as large, up to `ARENA_MAX_CHUNK_SIZE` bytes
+ */
+const std::size_t ARENA_FIRST_CHUNK_NUM_ENTRIES = 16;
+
+/**
+ * @brief Maximum size (in bytes) of a chunk of an entry arena (unless a single entry is larger)
+ */
+const std::size_t ARENA_MAX_CHUNK_SIZE = 1024 * 1024;
+
 /**
  * @brief Returns `true` if `n` is prime, `false` otherwise.
  */
@@ -141,8 +246,341 @@ T nextPrime(T n, typename std::enable_if<std::is_integral<T>::value>::type* = nu
 
 }
 
+/**
+ * @brief Returns the smallest power of two greater than or equal to `n`
+ */
+inline std::size_t nextPowerOfTwo(std::size_t n) {
+    std::size_t powerOfTwo = 1;
+    while (powerOfTwo < n) {
+        powerOfTwo <<= 1;
+    }
+    return powerOfTwo;
+}
+
+/**
+ * @brief Returns the base-2 logarithm of `powerOfTwo` (which must be a power of two)
+ */
+inline unsigned log2OfPowerOfTwo(std::size_t powerOfTwo) {
+    unsigned log2 = 0;
+    while (powerOfTwo > 1) {
+        powerOfTwo >>= 1;
+        log2++;
+    }
+    return log2;
+}
+
+/**
+ * @brief Returns the index of the least significant bit set in `mask` (which must not be zero)
+ */
+inline unsigned countTrailingZeros(std::uint32_t mask) {
+#if defined(__GNUC__)
+    return (unsigned) __builtin_ctz(mask);
+#else
+    unsigned count = 0;
+    while ((mask & 1) == 0) {
+        mask >>= 1;
+        count++;
+    }
+    return count;
+#endif
+}
+
+/**
+ * @brief Hints the processor to fetch the cache line containing `address`
+ */
+inline void prefetch(const void* address) {
+#if defined(__GNUC__)
+    __builtin_prefetch(address);
+#elif defined(FCMM_SSE2)
+    _mm_prefetch((const char*) address, _MM_HINT_T0);
+#else
+    (void) address;
+#endif
+}
+
+/**
+ * @brief Returns the index of the stripe of a StripedCounter (or of an entry arena) used by the calling thread
+ * (threads are assigned the stripes in a round-robin fashion)
+ */
+inline std::size_t getThreadStripeIndex() {
+    static std::atomic<std::size_t> nextStripeIndex(0);
+    static thread_local std::size_t stripeIndex = COUNTER_NUM_STRIPES; // constant initialization: no guard is checked
+    if (stripeIndex == COUNTER_NUM_STRIPES) {
+        stripeIndex = nextStripeIndex.fetch_add(1, std::memory_order_relaxed) % COUNTER_NUM_STRIPES;
+    }
+    return stripeIndex;
+}
+
+/**
+ * @brief The values of the control byte of a bucket of a @link Fcmm @endlink or of a @link SharedFcmm @endlink.
+ *
+ * A bucket can be in one of the following five states:
+ *  - `EMPTY`: it does not contain an entry
+ *  - `BUSY`: an entry is being written on it
+ *  - `COMPUTING`: it contains the key of an entry, whose value is being computed (see Fcmm::insertExclusive());
+ *    the value is not constructed yet
+ *  - valid: it contains an entry, and the control byte holds a 7-bit fragment of the hash of its key
+ *    (see Fcmm::Submap::calculateFragment())
+ *  - `ABANDONED`: the computation of the value failed; the bucket holds the key, but will never contain an entry
+ *
+ * Control bytes are kept apart from the buckets and scanned a group at a time (see Group):
+ * a bucket is only touched if its control byte may correspond to the requested key.
+ * `EMPTY` is zero, so that freshly mapped memory holds empty buckets (see ZeroedMemory).
+ */
+struct Control {
+
+    enum : std::uint8_t { EMPTY = 0x00, BUSY = 0x01, COMPUTING = 0x02, ABANDONED = 0x03 };
+
+    static bool isValid(std::uint8_t control) FCMM_NOEXCEPT {
+        return control >= 0x80;
+    }
+
+};
+
+/**
+ * @brief A snapshot of the control bytes of a group of `GROUP_SIZE` consecutive buckets,
+ * which can be compared against a control byte all at once (using SSE2, if available)
+ */
+class Group {
+
+private:
+
+#ifdef FCMM_SSE2
+    __m128i controls;
+#else
+    std::uint8_t controls[GROUP_SIZE];
+#endif
+
+public:
+
+    explicit Group(const std::atomic<std::uint8_t>* groupControls) FCMM_NOEXCEPT {
+#ifdef FCMM_SSE2
+        // each control byte is loaded atomically, which is all the probing logic relies upon
+        controls = _mm_loadu_si128(reinterpret_cast<const __m128i*>(groupControls));
+#else
+        for (std::size_t i = 0; i < GROUP_SIZE; i++) {
+            controls[i] = groupControls[i].load(std::memory_order_relaxed);
+        }
+#endif
+    }
+
+    /**
+     * @brief Returns a bitmask of the buckets whose control byte is equal to `control`
+     */
+    std::uint32_t match(std::uint8_t control) const FCMM_NOEXCEPT {
+#ifdef FCMM_SSE2
+        return (std::uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(controls, _mm_set1_epi8((char) control)));
+#else
+        std::uint32_t mask = 0;
+        for (std::size_t i = 0; i < GROUP_SIZE; i++) {
+            mask |= (std::uint32_t) (controls[i] == control) << i;
+        }
+        return mask;
+#endif
+    }
+
+    /**
+     * @brief Returns a bitmask of the buckets not containing an entry
+     */
+    std::uint32_t matchInvalid() const FCMM_NOEXCEPT {
+#ifdef FCMM_SSE2
+        return ~(std::uint32_t) _mm_movemask_epi8(controls) & 0xFFFF; // valid control bytes have the most significant bit set
+#else
+        std::uint32_t mask = 0;
+        for (std::size_t i = 0; i < GROUP_SIZE; i++) {
+            mask |= (std::uint32_t) !Control::isValid(controls[i]) << i;
+        }
+        return mask;
+#endif
+    }
+
+};
+
 } // unnamed namespace
 
+/**
+ * @brief A counter incremented by many threads at once. Each thread increments one of its stripes,
+ * which lie on separate cache lines: the exact value is the sum of the stripes. Every `COUNTER_BATCH_SIZE` increments,
+ * a stripe adds them to a shared approximate value, which lags behind the exact value by less than
+ * `COUNTER_NUM_STRIPES * COUNTER_BATCH_SIZE` and is cheap to read.
+ */
+class StripedCounter {
+
+private:
+
+    struct Stripe {
+        std::atomic<std::size_t> value;
+        char padding[CACHE_LINE_SIZE - sizeof(std::atomic<std::size_t>)];
+    };
+
+    char padding[CACHE_LINE_SIZE]; // keeps the approximate value apart from the preceding variables
+    Stripe approximateValue;
+    Stripe stripes[COUNTER_NUM_STRIPES];
+
+public:
+
+    StripedCounter() {
+        approximateValue.value.store(0, std::memory_order_relaxed);
+        for (Stripe& stripe : stripes) {
+            stripe.value.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Increments the counter by 1
+     */
+    void increment() FCMM_NOEXCEPT {
+        const std::size_t stripeValue = stripes[getThreadStripeIndex()].value.fetch_add(1, std::memory_order_relaxed) + 1;
+        if (stripeValue % COUNTER_BATCH_SIZE == 0) {
+            approximateValue.value.fetch_add(COUNTER_BATCH_SIZE, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Returns the approximate value of the counter, which never exceeds the exact one
+     */
+    std::size_t getApproximate() const FCMM_NOEXCEPT {
+        return approximateValue.value.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Returns the exact value of the counter (that is, the sum of its stripes)
+     */
+    std::size_t get() const FCMM_NOEXCEPT {
+        std::size_t value = 0;
+        for (const Stripe& stripe : stripes) {
+            value += stripe.value.load(std::memory_order_relaxed);
+        }
+        return value;
+    }
+
+    StripedCounter(const StripedCounter&) = delete;
+    StripedCounter& operator=(const StripedCounter&) = delete;
+
+};
+
+/**
+ * @brief Huge pages backing the submaps of a @link Fcmm @endlink instance (on POSIX systems)
+ */
+enum class HugePages {
+
+    /**
+     * @brief Regular pages
+     */
+    NONE,
+
+    /**
+     * @brief Transparent huge pages, requested with `madvise(MADV_HUGEPAGE)`
+     */
+    TRANSPARENT,
+
+    /**
+     * @brief Explicit huge pages, reserved by the system administrator (`MAP_HUGETLB`);
+     * regular pages are used if none are available
+     */
+    EXPLICIT
+
+};
+
+/**
+ * @brief A block of zero-filled memory. On POSIX systems it is an anonymous memory mapping, whose pages are only
+ * allocated (and zeroed) by the operating system when first touched: creating a large block (e.g. a submap) does
+ * not stall, since its initialization is spread across its first uses.
+ *
+ * If a spill directory is given, the mapping is backed by an unlinked file created in that directory instead:
+ * its pages are cached in memory by the operating system while they are used, and written to the file
+ * when memory runs short (first the pages marked as cold, see markCold()).
+ */
+class ZeroedMemory {
+
+private:
+
+    void* address;
+    std::size_t size;
+    bool fileBacked;
+
+public:
+
+    ZeroedMemory(std::size_t size, HugePages hugePages, const std::string* spillDirectory = nullptr) :
+            address(nullptr), size(size), fileBacked(false) {
+#ifdef FCMM_MMAP
+        if (spillDirectory != nullptr) {
+            std::string filename = *spillDirectory + "/fcmm-XXXXXX";
+            const int fd = mkstemp(&filename[0]);
+            if (fd == -1) {
+                throw std::runtime_error("Cannot create a spill file in: " + *spillDirectory);
+            }
+            unlink(filename.c_str()); // the space is reclaimed once the mapping is gone
+            if (ftruncate(fd, (off_t) size) == 0) { // the file reads as zeros
+                address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            }
+            close(fd);
+            if (address == nullptr || address == MAP_FAILED) {
+                throw std::runtime_error("Cannot map a spill file in: " + *spillDirectory);
+            }
+            fileBacked = true;
+            return;
+        }
+#ifdef MAP_HUGETLB
+        if (hugePages == HugePages::EXPLICIT) {
+            const std::size_t hugeSize = (size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+            address = mmap(nullptr, hugeSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (address != MAP_FAILED) {
+                this->size = hugeSize;
+                return;
+            }
+        }
+#endif
+        address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (address == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+#ifdef MADV_HUGEPAGE
+        if (hugePages != HugePages::NONE) { // the fallback for explicit huge pages
+            madvise(address, size, MADV_HUGEPAGE);
+        }
+#endif
+#else
+        (void) hugePages;
+        (void) spillDirectory; // spilling requires memory mappings
+        address = std::calloc(size, 1);
+        if (address == nullptr) {
+            throw std::bad_alloc();
+        }
+#endif
+    }
+
+    ~ZeroedMemory() {
+#ifdef FCMM_MMAP
+        munmap(address, size);
+#else
+        std::free(address);
+#endif
+    }
+
+    void* get() const FCMM_NOEXCEPT {
+        return address;
+    }
+
+    /**
+     * @brief Hints the operating system that the memory will hardly be used again: if backed by a spill file,
+     * its pages are the first to be written to the file and evicted when memory runs short
+     * (they are read back on access). Paging them out right away would not help, since dirty file pages
+     * are only written back in the background.
+     */
+    void markCold() const FCMM_NOEXCEPT {
+#if defined(FCMM_MMAP) && defined(MADV_COLD)
+        if (fileBacked) {
+            madvise(address, size, MADV_COLD);
+        }
+#endif
+    }
+
+    ZeroedMemory(const ZeroedMemory&) = delete;
+    ZeroedMemory& operator=(const ZeroedMemory&) = delete;
+
+};
+
 /**
  * @brief This struct holds the statistics about a single submap of a @link Fcmm @endlink instance
  *
@@ -165,6 +603,12 @@ struct SubmapStats {
      */
     float loadFactor;
 
+    /**
+     * @brief Number of searches that skipped the submap because its Bloom filter ruled the key out
+     * (only submaps other than the last one have a Bloom filter)
+     */
+    std::size_t numSkippedProbes;
+
 };
 
 /**
@@ -179,11 +623,29 @@ struct Stats {
      */
     std::size_t numSubmaps;
 
+    /**
+     * @brief Number of submaps whose entries have all been migrated to newer submaps: they are no longer searched
+     * (their memory is retained, since references and iterators to their entries are never invalidated)
+     */
+    std::size_t numRetiredSubmaps;
+
     /**
      * @brief Number of entries in the map
      */
     std::size_t numEntries;
 
+    /**
+     * @brief Number of computations avoided by Fcmm::insertExclusive() because another thread
+     * was already computing the value for the same key
+     */
+    std::size_t numAvoidedComputations;
+
+    /**
+     * @brief Number of submap searches skipped thanks to the Bloom filters of the submaps
+     * (the sum of SubmapStats::numSkippedProbes)
+     */
+    std::size_t numSkippedSubmapProbes;
+
     /**
      * @brief Statistics about each submap of the map
      * @see SubmapStats
@@ -210,1032 +672,4596 @@ public:
 };
 
 /**
- * @brief An almost lock-free concurrent hashmap, providing a limited set of functionalities.
- *
- *  - Only find() and insert() operations are supported: once an entry is inserted into the map, it cannot
- *    be erased nor updated. The filter() method provides a way to get a copy of the map containing only certain entries.
- *  - The map can be iterated over with an InputIterator (see begin() and end()) or a range-based for loop.
- *  - A deep copy of the map can be obtained with clone().
- *  - The presence of duplicate keys into the map is avoided but the total absence is not guaranteed.
- *    This is not an issue as long as it holds that: if (k<sub>1</sub>, v<sub>1</sub>) and (k<sub>2</sub>, v<sub>2</sub>)
- *    are entries and k<sub>1</sub> = k<sub>2</sub>, then v<sub>1</sub> = v<sub>2</sub>.
- *
- * Due to its features, this data structure is fit to be used for memoization in concurrent environments.
+ * @brief If `value` is `true`, @link Fcmm @endlink stores the two hashes of each key in its bucket:
+ * keys are only compared if their first hashes match, and entries are moved between submaps
+ * (see Fcmm::helpMigration()) or maps (see Fcmm::filter()) without hashing their keys again.
  *
- * @tparam  Key         the type of the key in each entry (default-constructible, copy-constructible or
- *                      move-constructible, copy-assignable or move-assignable)
- * @tparam  Value       the type of the value in each entry (default-constructible, copy-constructible or
- *                      move-constructible, copy-assignable or move-assignable)
- * @tparam  KeyHash1    the type of a function object that calculates the hash of the key;
- *                      it should have the same interface as
- *                      <a href="http://en.cppreference.com/w/cpp/utility/hash">`std::hash<T>`</a>
- * @tparam  KeyHash2    the type of another function object that calculates the hash of the key;
- *                      it should be <b>completely independent from `KeyHash1`</b>
- * @tparam  KeyEqual    the type of the function object that checks the equality of the two keys;
- *                      it should have the same interface as
- *                      <a href="http://en.cppreference.com/w/cpp/utility/functional/equal_to">`std::equal_to<T>`</a>
+ * By default, the hashes are stored for the keys that are not trivially copyable (e.g. strings), whose hashing and
+ * comparison are likely to be expensive. The template can be specialized to override the default for a key type.
  */
-template<
-    typename Key,
-    typename Value,
-    typename KeyHash1 = std::hash<Key>,
-    typename KeyHash2 = DefaultKeyHash2<Key>,
-    typename KeyEqual = std::equal_to<Key>
->
-class Fcmm {
-
-    static_assert(std::is_default_constructible<Key>::value, "Key has to be default-constructible");
-    static_assert(std::is_default_constructible<Value>::value, "Value has to be default-constructible");
+template<typename Key>
+struct StoreKeyHashes : std::integral_constant<bool, !std::is_trivially_copyable<Key>::value> {
+};
 
-    static_assert(std::is_copy_constructible<Key>::value || std::is_move_constructible<Key>::value,
-                  "Key has to be copy-constructible or move-constructible, or both");
-    static_assert(std::is_copy_constructible<Value>::value || std::is_move_constructible<Value>::value,
-                  "Value has to be copy-constructible or move-constructible, or both");
+/**
+ * @brief If `value` is `true`, @link Fcmm @endlink stores the entries having this type of value out of line:
+ * each entry is constructed in an arena of the submap where it is inserted, and its bucket only holds the hashes
+ * of the key (see StoreKeyHashes) and a pointer to the entry. Buckets stay small, so that the empty ones waste
+ * little memory and probing touches fewer cache lines; keys are only compared (in the arena) if their first hashes match.
+ *
+ * By default, the values larger than `MAX_INLINE_VALUE_SIZE` bytes are stored out of line.
+ * The template can be specialized to override the default for a value type.
+ */
+template<typename Value>
+struct StoreValuesOutOfLine : std::integral_constant<bool, (sizeof(Value) > MAX_INLINE_VALUE_SIZE)> {
+};
 
-    static_assert(std::is_copy_assignable<Key>::value || std::is_move_assignable<Key>::value,
-                  "Key has to be copy-assignable or move-assignable, or both");
-    static_assert(std::is_copy_assignable<Value>::value || std::is_move_assignable<Value>::value,
-                  "Value has to be copy-assignable or move-assignable, or both");
+/**
+ * @brief Converts objects of type `T` to and from bytes. It is used for the snapshots of a @link Fcmm @endlink
+ * (see Fcmm::saveSnapshot() and Snapshot), for the records of an EntryLog, and for the messages exchanged by
+ * the shards of a CppMemo `ShardedStorage`.
+ *
+ * It is available for trivially copyable types, whose bytes are written as they are, and for strings.
+ * The template can be specialized for other key and value types, providing the same two static member functions.
+ */
+template<typename T, typename Enable = void>
+struct Serializer;
 
-public:
+template<typename T>
+struct Serializer<T, typename std::enable_if<std::is_trivially_copyable<T>::value>::type> {
 
     /**
-     * @brief The type of the key in each entry
+     * @brief Appends the bytes representing `object` to `bytes`
      */
-    typedef Key key_type;
+    static void serialize(const T& object, std::string& bytes) {
+        bytes.append(reinterpret_cast<const char*>(&object), sizeof(T));
+    }
 
     /**
-     * @brief The type of the value in each entry
+     * @brief Returns the object represented by the `size` bytes starting at `bytes` (which may not be aligned)
+     *
+     * @throw std::runtime_error  thrown if the bytes cannot represent an object
      */
-    typedef Value mapped_type;
+    static T deserialize(const char* bytes, std::size_t size) {
+        if (size != sizeof(T)) {
+            throw std::runtime_error("Cannot deserialize: unexpected object size");
+        }
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type object;
+        std::memcpy(&object, bytes, sizeof(T));
+        return *reinterpret_cast<const T*>(&object);
+    }
 
-    /**
-     * @brief An entry of the map
-     */
-    typedef std::pair<Key, Value> Entry;
+};
 
-    // Forward declaration
-    class const_iterator;
+template<typename CharT, typename Traits, typename Allocator>
+struct Serializer<std::basic_string<CharT, Traits, Allocator>, void> {
 
-private:
+    static void serialize(const std::basic_string<CharT, Traits, Allocator>& string, std::string& bytes) {
+        bytes.append(reinterpret_cast<const char*>(string.data()), string.size() * sizeof(CharT));
+    }
+
+    static std::basic_string<CharT, Traits, Allocator> deserialize(const char* bytes, std::size_t size) {
+        if (size % sizeof(CharT) != 0) {
+            throw std::runtime_error("Cannot deserialize: unexpected string size");
+        }
+        std::basic_string<CharT, Traits, Allocator> string(size / sizeof(CharT), CharT());
+        if (size != 0) {
+            std::memcpy(&string[0], bytes, size);
+        }
+        return string;
+    }
+
+};
+
+/**
+ * @brief The header of a snapshot file (see Fcmm::saveSnapshot()).
+ *
+ * The header is followed by an index of `numSlots` slots (see SnapshotSlot), a power of two, and by the records.
+ * Each record holds the sizes of the serialized key and value (two 32-bit integers), followed by their bytes;
+ * records start at offsets multiple of 8. Integers are written in the byte order of the machine:
+ * snapshots are meant to be loaded on the machine that saved them, or on a machine of the same architecture.
+ */
+struct SnapshotHeader {
 
     /**
-     * @brief First function object to calculate the hash code of a key
+     * @brief The characters `FCMMSNAP`
      */
-    KeyHash1 keyHash1;
+    char magic[8];
 
     /**
-     * @brief Second function object to calculate the hash code of a key
+     * @brief The version of the format (1)
      */
-    KeyHash2 keyHash2;
+    std::uint32_t version;
 
     /**
-     * @brief A bucket of the hashmap.
-     *
-     * A bucket can be in one of the following three states:
-     *  - `EMPTY`: it does not contain an entry
-     *  - `BUSY`: an entry is being written on it
-     *  - `VALID`: it contains an entry
+     * @brief The value `0x01020304`, which reads differently on machines with another byte order
      */
-    struct Bucket {
+    std::uint32_t byteOrderMark;
 
-        enum class State { EMPTY, BUSY, VALID };
-
-        std::atomic<State> state;
-        Entry entry;
-
-        Bucket() : state(State::EMPTY) {
-        }
+    /**
+     * @brief Number of entries in the snapshot
+     */
+    std::uint64_t numEntries;
 
-    };
+    /**
+     * @brief Number of slots of the index
+     */
+    std::uint64_t numSlots;
 
     /**
-     * @brief A submap is a collection of buckets
+     * @brief Size of the file, in bytes
      */
-    struct Submap {
+    std::uint64_t fileSize;
 
-        /**
-         * @brief Function object to determine if two keys are equal
-         */
-        KeyEqual keyEqual;
+};
 
-        /**
-         * @brief Buckets vector
-         */
-        std::vector<Bucket> buckets;
+/**
+ * @brief A slot of the index of a snapshot file. Keys are placed by linear probing, starting from a slot
+ * depending on their first hash.
+ */
+struct SnapshotSlot {
 
-        /**
-         * @brief Maximum load factor
-         */
-        float maxLoadFactor;
+    /**
+     * @brief The first hash of the key, compared before the key itself
+     */
+    std::uint64_t hash1;
 
-        /**
-         * @brief Number of valid buckets
-         */
-        std::atomic<std::size_t> numValidBuckets;
+    /**
+     * @brief Offset of the record of the entry in the file (zero if the slot is empty)
+     */
+    std::uint64_t recordOffset;
 
-        /**
-         * @brief Constructor
-         *
-         * @param capacity       the capacity of this submap
-         * @param maxLoadFactor  the maximum load factor of this submap
-         */
-        Submap(std::size_t capacity, float maxLoadFactor) :
-                buckets(capacity),
-                maxLoadFactor(maxLoadFactor),
-                numValidBuckets(0) {
-        }
+};
 
-        /**
-         * @brief Returns the capacity of this submap
-         */
-        std::size_t getCapacity() const FCMM_NOEXCEPT {
-            return buckets.size();
-        }
+namespace {
 
-        /**
-         * @brief Returns a reference to a bucket of this submap
-         *
-         * @param index  the index of the bucket
-         */
-        Bucket& getBucket(std::size_t index) {
-            return buckets[index];
-        }
+/**
+ * @brief Version of the format of the snapshot files
+ */
+const std::uint32_t SNAPSHOT_VERSION = 1;
 
-        /**
-         * @brief Returns a const reference to a bucket of this submap
-         *
-         * @param index  the index of the bucket
-         */
-        const Bucket& getBucket(std::size_t index) const {
-            return buckets[index];
-        }
+/**
+ * @brief Byte order mark of the snapshot files
+ */
+const std::uint32_t SNAPSHOT_BYTE_ORDER_MARK = 0x01020304;
 
-        /**
-         * @brief Returns the number of entries in this submap
-         */
-        std::size_t getNumValidBuckets() const FCMM_NOEXCEPT {
-            return numValidBuckets.load(std::memory_order_relaxed);
-        }
+/**
+ * @brief The index of a snapshot file has at least this many slots per entry (rounded up to a power of two)
+ */
+const std::size_t SNAPSHOT_SLOTS_PER_ENTRY = 2;
 
-        /**
-         * @brief Increments the number of valid buckets by 1
-         */
-        void incrementNumValidBuckets() FCMM_NOEXCEPT {
-            numValidBuckets.fetch_add(1, std::memory_order_relaxed);
-        }
+/**
+ * @brief Returns the slot of the index of a snapshot where the probing for a key starts
+ *
+ * @param hash1     the first hash of the key
+ * @param numSlots  the number of slots of the index (a power of two)
+ */
+inline std::size_t calculateSnapshotStartSlot(std::uint64_t hash1, std::uint64_t numSlots) FCMM_NOEXCEPT {
+    const std::uint64_t mixed = hash1 * 0x9E3779B97F4A7C15ULL;
+    return (std::size_t) ((mixed ^ (mixed >> 32)) & (numSlots - 1));
+}
 
-        /**
-         * @brief Given the second hash of a key, calculates the corresponding
-         * double hashing probe increment
-         */
-        std::size_t calculateProbeIncrement(std::size_t hash2) const FCMM_NOEXCEPT {
-            const std::size_t modulus = getCapacity() - 1;
-            return 1 + hash2 % modulus; // in [1, capacity - 1]
-        }
+/**
+ * @brief Rounds `offset` up to a multiple of 8 (the alignment of the records of a snapshot)
+ */
+inline std::uint64_t alignSnapshotOffset(std::uint64_t offset) FCMM_NOEXCEPT {
+    return (offset + 7) & ~(std::uint64_t) 7;
+}
 
-        /**
-         * @brief Searches for an entry having key equal to `key`
-         *
-         * @param key    the key of the entry to be found
-         * @param hash1  the first hash of the key
-         * @param hash2  the second hash of the key
-         *
-         * @return       a pair consisting of the index of the entry (if found)
-         *               and a `bool` denoting whether the entry was found
-         */
-        std::pair<std::size_t, bool> find(const Key& key, std::size_t hash1, std::size_t hash2) const {
+} // unnamed namespace
 
-            const std::size_t startIndex = hash1 % getCapacity(); // initial position for probing
-            const std::size_t probeIncrement = calculateProbeIncrement(hash2); // double hashing
-            std::size_t index = startIndex; // current position for probing
+namespace {
 
-            do {
+/**
+ * @brief Size (in bytes) of the blocks of records filled by the threads appending to an entry log and handed over
+ * to its writer (see EntryLog): a larger block is only allocated for a record that does not fit
+ */
+const std::size_t LOG_BUFFER_SIZE = 1024 * 1024;
 
-                const Bucket& bucket = getBucket(index); // the current bucket being probed
+/**
+ * @brief Interval (in milliseconds) at which the writer of an entry log also collects the partially filled blocks
+ */
+const std::size_t LOG_FLUSH_INTERVAL_MS = 1000;
 
-                typename Bucket::State bucketState = bucket.state.load(std::memory_order_relaxed);
+/**
+ * @brief Interval (in milliseconds) at which an idle writer of an entry log looks for blocks handed over to it,
+ * in case it missed the notification (the appending threads notify it without taking its lock)
+ */
+const std::size_t LOG_POLL_INTERVAL_MS = 10;
 
-                if (bucketState == Bucket::State::VALID) {
+/**
+ * @brief Number of full blocks waiting for the writer of an entry log beyond which a block handed over counts as
+ * an overflow (see EntryLog::getNumOverflowedBlocks()): the appending threads never wait for the writer,
+ * so the queue grows when the disk is slower than them
+ */
+const std::size_t LOG_MAX_QUEUED_BLOCKS = 64;
 
-                    std::atomic_thread_fence(std::memory_order_acquire); // memory fence
+/**
+ * @brief Returns a new identifier for an entry log, never reused within the process
+ */
+inline std::uint64_t newEntryLogId() {
+    static std::atomic<std::uint64_t> nextId(0);
+    return nextId.fetch_add(1, std::memory_order_relaxed);
+}
 
-                    if (keyEqual(bucket.entry.first, key)) {
-                        // the requested entry was found
-                        return std::make_pair(index, true);
-                    }
+/**
+ * @brief Version of the format of the entry log files
+ */
+const std::uint32_t LOG_VERSION = 1;
 
-                } else if (bucketState == Bucket::State::EMPTY) {
+/**
+ * @brief Size of the header of an entry log file: the characters `FCMMLOG1`, the version and the byte order mark
+ */
+const std::size_t LOG_HEADER_SIZE = 8 + 2 * sizeof(std::uint32_t);
 
-                    // found a non-busy empty bucket: the requested entry is not present
-                    return std::make_pair(0, false);
+/**
+ * @brief Returns the checksum of a block of an entry log: a multiplicative hash of its records, computed 8 bytes
+ * at a time in four independent lanes (any change to a single 8-byte word changes the checksum)
+ */
+inline std::uint64_t calculateLogChecksum(const char* bytes, std::size_t size) FCMM_NOEXCEPT {
+    const std::uint64_t multiplier = 0x9E3779B97F4A7C15ULL;
+    std::uint64_t lanes[4] = { 0xCBF29CE484222325ULL, 0x84222325CBF29CE4ULL, 0x2325CBF29CE48422ULL, 0x9CE484222325CBF2ULL };
+    std::size_t offset = 0;
+    for (; size - offset >= sizeof(lanes); offset += sizeof(lanes)) {
+        std::uint64_t words[4];
+        std::memcpy(words, bytes + offset, sizeof(words));
+        for (std::size_t lane = 0; lane < 4; lane++) {
+            lanes[lane] = (lanes[lane] ^ words[lane]) * multiplier;
+        }
+    }
+    std::uint64_t checksum = lanes[0];
+    for (std::size_t lane = 1; lane < 4; lane++) {
+        checksum = (checksum * multiplier) ^ lanes[lane];
+    }
+    for (; offset < size; offset++) {
+        checksum = (checksum ^ (unsigned char) bytes[offset]) * multiplier;
+    }
+    return checksum;
+}
 
-                }
+} // unnamed namespace
 
-                index = (index + probeIncrement) % getCapacity(); // move to the next bucket
+/**
+ * @brief An append-only log of the entries inserted into one or more @link Fcmm @endlink instances
+ * (see Fcmm::setEntryLog()), replayed on restart to recover them (see replay() and Fcmm::replayEntryLog()).
+ *
+ * Each thread appending to the log converts the entries to bytes (see Serializer) into a block of its own,
+ * registered with the log the first time the thread appends to it, and publishes the size of the block after each
+ * record. Once full, the block is pushed onto a lock-free queue and the thread goes on with a spare block returned by
+ * a background writer thread, which appends the queued blocks to the file with large writes. Every
+ * `LOG_FLUSH_INTERVAL_MS` milliseconds, and on flush(), the writer also writes the records published so far in the
+ * blocks being filled, leaving the blocks to their threads. The appending threads take no lock, and never wait for
+ * the writer: when the disk is slower than them the queue grows, and the blocks queued beyond `LOG_MAX_QUEUED_BLOCKS`
+ * are counted (see getNumOverflowedBlocks()).
+ *
+ * Write failures (e.g. a full disk) are only reported by flush(), which throws, and by failed():
+ * the destructor cannot report them.
+ *
+ * The file starts with a header (the characters `FCMMLOG1`, the version of the format and the byte order mark
+ * `0x01020304`, as two 32-bit integers), followed by blocks: each block holds the size of its records and their
+ * checksum (two 64-bit integers), followed by the records, laid out as in a snapshot (see SnapshotHeader) without
+ * padding; the records of a block being filled may be split across several blocks of the file. A block torn by a crash
+ * fails the checksum: it is discarded, together with the blocks following it, when the file is replayed or opened again.
+ */
+class EntryLog {
 
-            } while (index != startIndex);
+private:
 
-            // scanned the whole submap: the requested entry is not present
-            return std::make_pair(0, false);
+    struct ThreadBuffer;
 
+    /**
+     * @brief A buffer of records, filled by a thread and written by the writer thread: its records are written
+     * while it is being filled (see collectBlocks()), and the rest once it is full
+     */
+    struct Block {
+
+        std::unique_ptr<char[]> records;
+        std::atomic<std::size_t> size; // of the complete records, published by the filling thread
+        std::size_t capacity;
+        std::size_t writtenSize; // only accessed by the writer thread
+        ThreadBuffer* owner; // the buffer the block is returned to once written
+        Block* next; // the next block in the queue of the writer thread
+
+        Block(ThreadBuffer* owner, std::size_t capacity) :
+                records(new char[capacity]),
+                size(0),
+                capacity(capacity),
+                writtenSize(0),
+                owner(owner),
+                next(nullptr) {
         }
 
-        /**
-         * @brief Seeks the first valid bucket starting from `index` (inclusive)
-         *
-         * @param index  the index where the search should start;
-         *               when the function returns, the variable contains the index where the valid bucket
-         *               was found (if any)
-         *
-         * @return       `true` if a valid bucket was found, `false` if the end of the submap
-         *               has been reached without finding a valid bucket
-         */
-        bool seek(std::size_t& index) const {
-
-            while (index < getCapacity()) {
-
-                const Bucket& bucket = getBucket(index); // the current bucket being probed
-
-                if (bucket.state.load(std::memory_order_relaxed) == Bucket::State::VALID) {
-                    std::atomic_thread_fence(std::memory_order_acquire); // memory fence
-                    return true;
-                }
+    };
 
-                index++; // move to the next bucket
+    /**
+     * @brief The blocks of a thread appending to the log
+     */
+    struct ThreadBuffer {
 
-            }
+        std::atomic<Block*> block; // the block being filled (if any)
+        std::atomic<Block*> spare; // a written block returned by the writer thread (if any)
+        std::string bytes; // the key and the value of the entry being appended, if not trivially copyable
+        ThreadBuffer* next; // the buffer registered before this one
+        char padding[CACHE_LINE_SIZE];
 
-            // reached the end of the buckets vector
-            return false;
+        ThreadBuffer() : block(nullptr), spare(nullptr), next(nullptr) {
+        }
 
+        ~ThreadBuffer() {
+            delete block.load(std::memory_order_relaxed);
+            delete spare.load(std::memory_order_relaxed);
         }
 
-        /**
-         * @brief This exception is thrown by insert() if the new entry could not be inserted because the submap is full
-         */
-        struct FullSubmapException {
-        };
+    };
 
-        /**
-         * @brief Inserts a new entry into the submap, if the submap doesn't already contain an entry with the same key.
-         * The key will be moved, if possible.
-         *
-         * The value is calculated as needed by calling the `computeValue` function or functor.
-         *
-         * @param key                    the key of the entry to be inserted
-         * @param hash1                  the first hash of the key
-         * @param hash2                  the second hash of the key
-         * @param computeValue           a function or functor that, given the key, calculates the corresponding value
-         *
-         * @return                       a pair consisting of the index of the entry (either inserted or preventing the insertion)
-         *                               and a `bool` denoting whether the entry was inserted
-         *
-         * @tparam ComputeValueFunction  function or functor implementing `Value operator()(const Key&)`
-         *
-         * @throw FullSubmapException    thrown if the new entry could not be inserted because the submap is full
-         *
-         */
-        template<typename KeyType, typename ComputeValueFunction>
-        std::pair<std::size_t, bool> insert(KeyType&& key, std::size_t hash1, std::size_t hash2, ComputeValueFunction computeValue) {
+    /**
+     * @brief Identifies the log in the thread-local lists of buffers (see getThreadBuffer())
+     */
+    const std::uint64_t id;
 
-            Value value = Value();
-            bool valueComputed = false;
+    /**
+     * @brief The file, only written by the writer thread once the log is constructed
+     */
+    std::ofstream file;
 
-            const std::size_t startIndex = hash1 % getCapacity(); // initial position for probing
-            const std::size_t probeIncrement = calculateProbeIncrement(hash2); // double hashing
-            std::size_t index = startIndex; // current position for probing
+    std::atomic<ThreadBuffer*> threadBuffers; // the last registered buffer, owned by the log
+    std::atomic<Block*> queuedBlocks; // the last queued block, pushed without a lock
+    std::atomic<std::size_t> numQueuedBlocks;
+    std::atomic<std::uint64_t> numOverflowedBlocks;
 
-            do {
+    /**
+     * @brief Written blocks that could not be returned to their buffer, and are still the current block of their buffer:
+     * they are deleted once replaced (only accessed by the writer thread)
+     */
+    std::vector<Block*> retiredBlocks;
 
-                Bucket& bucket = getBucket(index); // the current bucket being probed
+    std::mutex writerMutex;
+    std::condition_variable writerCondition; // notified when a block is queued on an empty queue, flush() is called, or the log is closed
+    std::condition_variable flushedCondition; // notified when a flush is done
+    std::uint64_t numFlushRequests;
+    std::uint64_t numFlushes;
+    bool closing;
+    std::atomic<bool> writeFailed;
 
-                typename Bucket::State bucketState = bucket.state.load(std::memory_order_relaxed);
+    std::thread writer;
 
-                if (bucketState == Bucket::State::EMPTY) {
+    /**
+     * @brief Reads the header of an entry log file, returning `true` if it is valid
+     */
+    static bool readHeader(std::istream& input) {
+        char header[LOG_HEADER_SIZE];
+        if (!input.read(header, sizeof(header))) {
+            return false;
+        }
+        std::uint32_t versionAndByteOrderMark[2];
+        std::memcpy(versionAndByteOrderMark, header + 8, sizeof(versionAndByteOrderMark));
+        return std::memcmp(header, "FCMMLOG1", 8) == 0 && versionAndByteOrderMark[0] == LOG_VERSION &&
+               versionAndByteOrderMark[1] == SNAPSHOT_BYTE_ORDER_MARK;
+    }
 
-                    // since the bucket is (probably) empty, we will try to write the entry on it:
-                    // let's compute the value of the entry (if it hasn't been computed yet)
-                    if (!valueComputed) {
-                        value = computeValue(key);
-                        valueComputed = true;
-                    }
+    /**
+     * @brief Reads the blocks of an entry log file following the header, calling `function(records, size)`
+     * for each of them, until the end of the file or the first torn or corrupted block
+     *
+     * @param input     the file, positioned after the header
+     * @param fileSize  the size of the file
+     *
+     * @return          the size of the valid part of the file
+     */
+    template<typename Function>
+    static std::uint64_t readBlocks(std::istream& input, std::uint64_t fileSize, Function function) {
+        std::uint64_t validSize = LOG_HEADER_SIZE;
+        std::string records;
+        std::uint64_t blockHeader[2]; // size and checksum of the records
+        while (input.read(reinterpret_cast<char*>(blockHeader), sizeof(blockHeader))) {
+            if (blockHeader[0] > fileSize - validSize - sizeof(blockHeader)) {
+                break; // torn block
+            }
+            records.resize((std::size_t) blockHeader[0]);
+            if (!input.read(&records[0], (std::streamsize) records.size()) ||
+                    calculateLogChecksum(records.data(), records.size()) != blockHeader[1]) {
+                break;
+            }
+            function(records.data(), records.size());
+            validSize += sizeof(blockHeader) + records.size();
+        }
+        return validSize;
+    }
 
-                    // try to "lock" the bucket (without spinlocking)
-                    if (bucket.state.compare_exchange_strong(bucketState, Bucket::State::BUSY, std::memory_order_relaxed)) {
+    /**
+     * @brief Cuts an entry log file to its valid part, discarding a torn tail
+     */
+    static void truncateFile(const std::string& filename, std::uint64_t validSize) {
+#ifdef FCMM_MMAP
+        if (truncate(filename.c_str(), (off_t) validSize) != 0) {
+            throw std::runtime_error("Cannot truncate the entry log file: " + filename);
+        }
+#else
+        const std::string temporaryFilename = filename + ".tmp";
+        {
+            std::ifstream input(filename, std::ios::binary);
+            std::ofstream output(temporaryFilename, std::ios::binary | std::ios::trunc);
+            std::vector<char> bytes(LOG_BUFFER_SIZE);
+            for (std::uint64_t remaining = validSize; remaining > 0 && input && output;) {
+                const std::size_t size = (std::size_t) std::min(remaining, (std::uint64_t) bytes.size());
+                input.read(bytes.data(), (std::streamsize) size);
+                output.write(bytes.data(), input.gcount());
+                remaining -= (std::uint64_t) input.gcount();
+            }
+            output.close();
+            if (!input || !output) {
+                std::remove(temporaryFilename.c_str());
+                throw std::runtime_error("Cannot truncate the entry log file: " + filename);
+            }
+        }
+        if (std::remove(filename.c_str()) != 0 || std::rename(temporaryFilename.c_str(), filename.c_str()) != 0) {
+            throw std::runtime_error("Cannot truncate the entry log file: " + filename);
+        }
+#endif
+    }
 
-                        // the bucket is now busy and this thread is the only one that can write on it
+    /**
+     * @brief Returns the buffer of the calling thread, registering it the first time the thread appends to the log
+     */
+    ThreadBuffer& getThreadBuffer() {
+        // the last log appended to by the calling thread, and its buffer (constant initialization: no guard is checked)
+        static thread_local std::uint64_t lastId = UINT64_MAX;
+        static thread_local ThreadBuffer* lastBuffer = nullptr;
+        if (lastId == id) {
+            return *lastBuffer;
+        }
+        // the buffers of the calling thread, by log: a thread seldom appends to more than a few logs,
+        // and the entries of the logs destroyed in the meantime are never matched again
+        static thread_local std::vector<std::pair<std::uint64_t, ThreadBuffer*>> buffers;
+        for (const auto& buffer : buffers) {
+            if (buffer.first == id) {
+                lastId = id;
+                lastBuffer = buffer.second;
+                return *lastBuffer;
+            }
+        }
+        ThreadBuffer* buffer = new ThreadBuffer();
+        buffer->next = threadBuffers.load(std::memory_order_relaxed);
+        while (!threadBuffers.compare_exchange_weak(buffer->next, buffer, std::memory_order_release,
+                                                    std::memory_order_relaxed)) {
+        }
+        buffers.emplace_back(id, buffer);
+        lastId = id;
+        lastBuffer = buffer;
+        return *buffer;
+    }
 
-                        bucket.entry.first = std::move(key);
-                        bucket.entry.second = std::move(value);
-                        bucket.state.store(Bucket::State::VALID, std::memory_order_release); // mark the bucket as valid
-
-                        incrementNumValidBuckets();
-
-                        return std::make_pair(index, true);
-
-                    }
-
-                }
-
-                // The following block cannot be turned into an else-if attatched to the previous if block, since the variable bucketState
-                // may have been updated by compare_exchange_strong.
-                // Moreover, if bucketState is different from VALID, we re-load a fresh value of the state variable and
-                // check if it has become VALID in the meantime. This strategy reduces the presence of duplicates in the map.
-                if (bucketState == Bucket::State::VALID || bucket.state.load(std::memory_order_relaxed) == Bucket::State::VALID) {
-
-                    std::atomic_thread_fence(std::memory_order_acquire); // memory fence
-
-                    if (keyEqual(bucket.entry.first, key)) { // does the key match?
-                        // the key is already present in this submap: insertion failed
-                        return std::make_pair(index, false);
-                    }
-
-                }
-
-                index = (index + probeIncrement) % getCapacity(); // move to the next bucket
-
-            } while (index != startIndex);
-
-            // if the flow arrived here, then the submap is full: throw an exception that will be caught by Fcmm::insert()
-            throw FullSubmapException();
+    /**
+     * @brief Pushes a full block onto the queue of the writer thread, waking it if the queue was empty
+     */
+    void queueBlock(Block* block) {
+        // counted first, so that the writer thread never counts it out before
+        if (numQueuedBlocks.fetch_add(1, std::memory_order_relaxed) >= LOG_MAX_QUEUED_BLOCKS) {
+            numOverflowedBlocks.fetch_add(1, std::memory_order_relaxed);
+        }
+        // once pushed, the block belongs to the writer thread: only the previous head is looked at afterwards
+        Block* previous = queuedBlocks.load(std::memory_order_relaxed);
+        do {
+            block->next = previous;
+        } while (!queuedBlocks.compare_exchange_weak(previous, block, std::memory_order_release,
+                                                     std::memory_order_relaxed));
+        if (previous == nullptr) {
+            writerCondition.notify_one();
+        }
+    }
 
+    /**
+     * @brief Returns the block of the buffer of the calling thread, replacing it first if `size` bytes do not fit
+     */
+    Block& reserveRecord(ThreadBuffer& buffer, std::size_t size) {
+        Block* block = buffer.block.load(std::memory_order_relaxed);
+        if (block != nullptr && block->capacity - block->size.load(std::memory_order_relaxed) >= size) {
+            return *block;
         }
-
-        /**
-         * @brief Returns `true` if the submap is overloaded
-         */
-        bool isOverloaded() const FCMM_NOEXCEPT {
-            return (float) getNumValidBuckets() / getCapacity() >= maxLoadFactor;
+        Block* nextBlock = buffer.spare.exchange(nullptr, std::memory_order_acquire);
+        if (nextBlock == nullptr || nextBlock->capacity < size) {
+            delete nextBlock;
+            nextBlock = new Block(&buffer, std::max(size, LOG_BUFFER_SIZE));
         }
-
-        /**
-         * @brief Returns statistics about this Fcmm::Submap instance.
-         *
-         * @see SubmapStats
-         */
-        SubmapStats getStats() const {
-
-            SubmapStats stats;
-
-            stats.capacity = getCapacity();
-            stats.numValidBuckets = getNumValidBuckets();
-            stats.loadFactor = (float) stats.numValidBuckets / stats.capacity;
-
-            return stats;
-
+        if (block != nullptr) {
+            // queued before being replaced, so that the writer thread finds its records either way (see collectBlocks())
+            queueBlock(block);
         }
-
-    };
+        buffer.block.store(nextBlock, std::memory_order_release);
+        return *nextBlock;
+    }
 
     /**
-     * @brief Maximum load factor
+     * @brief Appends the record of an entry to the block of the buffer of the calling thread
      */
-    float maxLoadFactor;
+    template<typename Key, typename Value>
+    void appendRecord(ThreadBuffer& buffer, const Key& key, const Value& value, std::false_type) {
+        std::string& bytes = buffer.bytes;
+        bytes.clear();
+        Serializer<Key>::serialize(key, bytes);
+        const std::size_t keySize = bytes.size();
+        Serializer<Value>::serialize(value, bytes);
+        const std::size_t valueSize = bytes.size() - keySize;
+        if (keySize > UINT32_MAX || valueSize > UINT32_MAX) {
+            throw std::runtime_error("Cannot log an entry: the entry is too large");
+        }
+        const std::uint32_t sizes[2] = { (std::uint32_t) keySize, (std::uint32_t) valueSize };
+        Block& block = reserveRecord(buffer, sizeof(sizes) + bytes.size());
+        const std::size_t blockSize = block.size.load(std::memory_order_relaxed);
+        char* record = block.records.get() + blockSize;
+        std::memcpy(record, sizes, sizeof(sizes));
+        std::memcpy(record + sizeof(sizes), bytes.data(), bytes.size());
+        block.size.store(blockSize + sizeof(sizes) + bytes.size(), std::memory_order_release);
+    }
 
     /**
-     * @brief Number of submaps in this map
+     * @brief Appends the record of an entry to the block of the buffer of the calling thread, when both the key
+     * and the value are trivially copyable: their bytes are copied right into the block
      */
-    std::atomic<std::size_t> numSubmaps;
+    template<typename Key, typename Value>
+    void appendRecord(ThreadBuffer& buffer, const Key& key, const Value& value, std::true_type) {
+        const std::uint32_t sizes[2] = { (std::uint32_t) sizeof(Key), (std::uint32_t) sizeof(Value) };
+        const std::size_t recordSize = sizeof(sizes) + sizeof(Key) + sizeof(Value);
+        Block& block = reserveRecord(buffer, recordSize);
+        const std::size_t blockSize = block.size.load(std::memory_order_relaxed);
+        char* record = block.records.get() + blockSize;
+        std::memcpy(record, sizes, sizeof(sizes));
+        std::memcpy(record + sizeof(sizes), &key, sizeof(Key));
+        std::memcpy(record + sizeof(sizes) + sizeof(Key), &value, sizeof(Value));
+        block.size.store(blockSize + recordSize, std::memory_order_release);
+    }
 
     /**
-     * @brief Submaps pointers vector
+     * @brief Writes the records of a block not written yet, up to `size` bytes
      */
-    std::vector<std::unique_ptr<Submap> > submaps;
+    void writeRecords(Block& block, std::size_t size) {
+        if (size == block.writtenSize) {
+            return;
+        }
+        const char* records = block.records.get() + block.writtenSize;
+        const std::uint64_t blockHeader[2] = { size - block.writtenSize,
+                                               calculateLogChecksum(records, size - block.writtenSize) };
+        file.write(reinterpret_cast<const char*>(blockHeader), sizeof(blockHeader));
+        file.write(records, (std::streamsize) blockHeader[0]);
+        block.writtenSize = size;
+    }
 
     /**
-     * @brief Number of entries in the map
+     * @brief Writes the records published so far in the blocks being filled, without taking them from their threads.
+     * A block replaced meanwhile was queued first, so it is found by the following writeQueuedBlocks().
      */
-    std::atomic<std::size_t> numEntries;
+    void collectBlocks() {
+        for (ThreadBuffer* buffer = threadBuffers.load(std::memory_order_acquire); buffer != nullptr; buffer = buffer->next) {
+            Block* block = buffer->block.load(std::memory_order_acquire);
+            if (block != nullptr) {
+                writeRecords(*block, block->size.load(std::memory_order_acquire));
+            }
+        }
+    }
 
     /**
-     * @brief Atomic flag used by expand()
+     * @brief Writes the rest of the queued blocks, in the order they were queued, until the queue is empty.
+     * Each written block is returned to its buffer as the spare block, unless the buffer already has one.
      */
-    std::atomic_flag expanding;
+    void writeQueuedBlocks() {
+        while (Block* blocks = queuedBlocks.exchange(nullptr, std::memory_order_acquire)) {
+            // the queue is a stack: reverse it
+            Block* block = nullptr;
+            while (blocks != nullptr) {
+                Block* next = blocks->next;
+                blocks->next = block;
+                block = blocks;
+                blocks = next;
+            }
+            while (block != nullptr) {
+                Block* next = block->next;
+                writeRecords(*block, block->size.load(std::memory_order_relaxed));
+                numQueuedBlocks.fetch_sub(1, std::memory_order_relaxed);
+                block->size.store(0, std::memory_order_relaxed);
+                block->writtenSize = 0;
+                Block* noSpare = nullptr;
+                if (block->capacity != LOG_BUFFER_SIZE ||
+                        !block->owner->spare.compare_exchange_strong(noSpare, block, std::memory_order_release,
+                                                                     std::memory_order_relaxed)) {
+                    retiredBlocks.push_back(block);
+                }
+                block = next;
+            }
+        }
+        // a retired block may still be read by collectBlocks() until its thread replaces it
+        std::size_t numRetiredBlocks = 0;
+        for (Block* block : retiredBlocks) {
+            if (block->owner->block.load(std::memory_order_acquire) == block) {
+                retiredBlocks[numRetiredBlocks++] = block;
+            } else {
+                delete block;
+            }
+        }
+        retiredBlocks.resize(numRetiredBlocks);
+    }
 
     /**
-     * @brief Returns the maximum number of submaps
+     * @brief The body of the writer thread: writes the queued blocks, and collects the partially filled blocks
+     * periodically and when requested by flush(), until the log is closed
      */
-    std::size_t getMaxNumSubmaps() const FCMM_NOEXCEPT {
-        return submaps.size();
+    void writeBlocks() {
+
+        typedef std::chrono::steady_clock Clock;
+        const std::chrono::milliseconds flushInterval(LOG_FLUSH_INTERVAL_MS);
+        const std::chrono::milliseconds pollInterval(LOG_POLL_INTERVAL_MS);
+        Clock::time_point nextCollection = Clock::now() + flushInterval;
+
+        while (1) {
+
+            std::uint64_t flushRequest;
+            bool closed;
+            {
+                std::unique_lock<std::mutex> lock(writerMutex);
+                writerCondition.wait_for(lock, pollInterval, [this]() {
+                    return closing || numFlushRequests != numFlushes ||
+                           queuedBlocks.load(std::memory_order_relaxed) != nullptr;
+                });
+                flushRequest = numFlushRequests;
+                closed = closing;
+            }
+
+            const bool collect = closed || flushRequest != numFlushes || Clock::now() >= nextCollection;
+            if (collect) {
+                collectBlocks();
+                nextCollection = Clock::now() + flushInterval;
+            }
+
+            writeQueuedBlocks();
+            file.flush();
+            if (!file) {
+                writeFailed.store(true, std::memory_order_relaxed);
+            }
+
+            if (collect) {
+                std::lock_guard<std::mutex> lock(writerMutex);
+                numFlushes = flushRequest;
+                flushedCondition.notify_all();
+            }
+
+            if (closed) {
+                return;
+            }
+
+        }
+
     }
 
+public:
+
     /**
-     * @brief Returns a reference to a submap pointer
+     * @brief Constructor: opens an entry log file for appending, creating it if it does not exist,
+     * and starts the writer thread. A torn tail left by a crash is discarded first.
      *
-     * @param index  the index of the submap
+     * @param filename  the name of the file
+     *
+     * @throw std::runtime_error  thrown if the file cannot be written, or is not a valid entry log
      */
-    std::unique_ptr<Submap>& getSubmap(std::size_t index) {
-        return submaps[index];
+    explicit EntryLog(const std::string& filename) :
+            id(newEntryLogId()),
+            threadBuffers(nullptr),
+            queuedBlocks(nullptr),
+            numQueuedBlocks(0),
+            numOverflowedBlocks(0),
+            numFlushRequests(0),
+            numFlushes(0),
+            closing(false),
+            writeFailed(false) {
+
+        std::uint64_t fileSize = 0;
+        std::uint64_t validSize = 0;
+        {
+            std::ifstream input(filename, std::ios::binary | std::ios::ate);
+            if (input && input.tellg() > 0) {
+                fileSize = (std::uint64_t) input.tellg();
+                input.seekg(0);
+                if (!readHeader(input)) {
+                    throw std::runtime_error("Not a valid entry log file: " + filename);
+                }
+                validSize = readBlocks(input, fileSize, [](const char*, std::size_t) {});
+            }
+        }
+        if (validSize < fileSize) {
+            truncateFile(filename, validSize);
+        }
+
+        file.open(filename, std::ios::binary | std::ios::app);
+        if (validSize == 0) {
+            const std::uint32_t versionAndByteOrderMark[2] = { LOG_VERSION, SNAPSHOT_BYTE_ORDER_MARK };
+            file.write("FCMMLOG1", 8);
+            file.write(reinterpret_cast<const char*>(versionAndByteOrderMark), sizeof(versionAndByteOrderMark));
+            file.flush();
+        }
+        if (!file) {
+            throw std::runtime_error("Cannot write the entry log file: " + filename);
+        }
+
+        writer = std::thread(&EntryLog::writeBlocks, this);
+
     }
 
     /**
-     * @brief Returns a const reference to a submap pointer
-     *
-     * @param index  the index of the submap
+     * @brief Destructor: writes the buffered entries and stops the writer thread. A failure to write them is
+     * not reported: call flush() first to be notified of it.
      */
-    const std::unique_ptr<Submap>& getSubmap(std::size_t index) const {
-        return submaps[index];
+    ~EntryLog() {
+        {
+            std::lock_guard<std::mutex> lock(writerMutex);
+            closing = true;
+            writerCondition.notify_one();
+        }
+        writer.join();
+        for (Block* block : retiredBlocks) {
+            delete block;
+        }
+        for (ThreadBuffer* buffer = threadBuffers.load(std::memory_order_acquire); buffer != nullptr;) {
+            ThreadBuffer* next = buffer->next;
+            delete buffer;
+            buffer = next;
+        }
     }
 
     /**
-     * @brief Returns the number of submaps
+     * @brief Appends an entry to the block of the calling thread, handing the block over to the writer thread if full.
+     * It takes no lock and never waits for the writer thread; it may be called by many threads at once.
+     *
+     * @throw std::runtime_error  thrown if the key or the value is larger than 4 GiB once converted to bytes
      */
-    std::size_t getNumSubmaps() const FCMM_NOEXCEPT {
-        return numSubmaps.load(std::memory_order_acquire);
+    template<typename Key, typename Value>
+    void append(const Key& key, const Value& value) {
+        ThreadBuffer& buffer = getThreadBuffer();
+        appendRecord(buffer, key, value,
+                     std::integral_constant<bool, std::is_trivially_copyable<Key>::value &&
+                                                  std::is_trivially_copyable<Value>::value>());
     }
 
     /**
-     * @brief Returns the index of the last submap
+     * @brief Waits until the entries appended so far are written to the file (that is, handed over to the operating system)
+     *
+     * @throw std::runtime_error  thrown if the writer thread failed to write to the file
      */
-    std::size_t getLastSubmapIndex() const FCMM_NOEXCEPT {
-        return getNumSubmaps() - 1;
+    void flush() {
+        std::unique_lock<std::mutex> lock(writerMutex);
+        const std::uint64_t flushRequest = ++numFlushRequests;
+        writerCondition.notify_one();
+        flushedCondition.wait(lock, [this, flushRequest]() { return numFlushes >= flushRequest; });
+        if (writeFailed.load(std::memory_order_relaxed)) {
+            throw std::runtime_error("Cannot write the entry log file");
+        }
     }
 
     /**
-     * @brief Increments the number of submaps by 1
+     * @brief Returns `true` if the writer thread failed to write to the file: the entries appended since the failure
+     * may be lost. Unlike flush(), it neither waits nor throws, so it can be polled during a long computation.
      */
-    void incrementNumSubmaps() FCMM_NOEXCEPT {
-        numSubmaps.fetch_add(1, std::memory_order_release);
+    bool failed() const {
+        return writeFailed.load(std::memory_order_relaxed);
     }
 
     /**
-     * @brief Increments the number of entries by 1
+     * @brief Returns the number of blocks handed over while `LOG_MAX_QUEUED_BLOCKS` blocks were already waiting for
+     * the writer thread: a non-zero value means that the disk cannot keep up with the appending threads,
+     * whose blocks pile up in memory
      */
-    void incrementNumEntries() FCMM_NOEXCEPT {
-        numEntries.fetch_add(1, std::memory_order_relaxed);
+    std::uint64_t getNumOverflowedBlocks() const {
+        return numOverflowedBlocks.load(std::memory_order_relaxed);
     }
 
     /**
-     * @brief Expands the map by adding another submap
+     * @brief Calls `function(key, value)` for each entry of an entry log file, in the order the blocks were written
+     * (e.g. to insert all of them into a map: see Fcmm::replayEntryLog()). The file is read block by block,
+     * with large sequential reads; a torn or corrupted block and the blocks following it are ignored.
+     *
+     * @param filename  the name of the file
+     * @param function  a function or functor implementing `void operator()(Key&& key, Value&& value)`
      *
-     * @return  `true` if the map has been expanded, `false` otherwise
+     * @return          the number of entries replayed (zero if the file does not exist)
+     *
+     * @throw std::runtime_error  thrown if the file is not a valid entry log
      */
-    bool expand() {
+    template<typename Key, typename Value, typename Function>
+    static std::size_t replay(const std::string& filename, Function function) {
 
-        // spinlock on the expanding flag
-        while (expanding.test_and_set(std::memory_order_acquire)) {
-            std::this_thread::yield();
+        std::ifstream input(filename, std::ios::binary | std::ios::ate);
+        if (!input || input.tellg() <= 0) {
+            return 0;
+        }
+        const std::uint64_t fileSize = (std::uint64_t) input.tellg();
+        input.seekg(0);
+        if (!readHeader(input)) {
+            throw std::runtime_error("Not a valid entry log file: " + filename);
         }
 
-        bool result = false;
-
-        const std::size_t numSubmapsSnapshot = getNumSubmaps();
+        std::size_t numEntries = 0;
+        readBlocks(input, fileSize, [&function, &numEntries](const char* records, std::size_t size) {
+            std::size_t offset = 0;
+            while (offset < size) {
+                std::uint32_t sizes[2];
+                if (size - offset < sizeof(sizes)) {
+                    throw std::runtime_error("Corrupted entry log: record out of bounds");
+                }
+                std::memcpy(sizes, records + offset, sizeof(sizes));
+                offset += sizeof(sizes);
+                if (size - offset < (std::uint64_t) sizes[0] + sizes[1]) {
+                    throw std::runtime_error("Corrupted entry log: record out of bounds");
+                }
+                function(Serializer<Key>::deserialize(records + offset, sizes[0]),
+                         Serializer<Value>::deserialize(records + offset + sizes[0], sizes[1]));
+                offset += sizes[0] + sizes[1];
+                numEntries++;
+            }
+        });
 
-        // check if the maximum number of submaps has been reached
-        if (numSubmapsSnapshot == getMaxNumSubmaps()) {
-            throw std::runtime_error("Reached the maximum number of submaps: " + std::to_string(getMaxNumSubmaps()));
-        }
+        return numEntries;
 
-        // get the last submap
-        const std::size_t lastSubmapIndex = numSubmapsSnapshot - 1;
-        const Submap& lastSubmap = *getSubmap(lastSubmapIndex);
+    }
 
-        if (lastSubmap.isOverloaded()) { // re-check if the submap is overloaded
-            // perform expansion
-            const std::size_t newSubmapCapacity = nextPrime(lastSubmap.getCapacity() * NEW_SUBMAPS_CAPACITY_MULTIPLIER);
-            getSubmap(lastSubmapIndex + 1).reset(new Submap(newSubmapCapacity, maxLoadFactor));
-            incrementNumSubmaps();
-            result = true;
-        }
+    EntryLog(const EntryLog&) = delete;
+    EntryLog& operator=(const EntryLog&) = delete;
 
-        // clear the expanding flag
-        expanding.clear(std::memory_order_release);
+};
 
-        return result;
+/**
+ * @brief Calculates `n % divisor` for a fixed divisor (greater than 1) with a multiplication and a shift instead of
+ * a division: the quotient is the high half of the product of `n` by a precomputed reciprocal of the divisor
+ * (see T. Granlund, P. L. Montgomery, "Division by Invariant Integers using Multiplication", 1994).
+ *
+ * If 128-bit products are unavailable, the `%` operator is used.
+ */
+class FastModulo {
 
-    }
+private:
 
-    /**
-     * @brief Searches for an entry having key equal to `key` across all the sumbaps in the range [0, lastSubmapIndex].
-     *
-     * @param key              the key of the entry to be found
-     * @param hash1            the first hash of the key
-     * @param hash2            the second hash of the key
-     * @param lastSubmapIndex  the index of the last submap in which the entry has to be searched for
-     *
-     * @return                 a @link const_iterator @endlink to an entry having key `key`, or a past-the-end
-     *                         const_iterator if no such entry is found
-     */
-    const_iterator findHelper(const Key& key, std::size_t hash1, std::size_t hash2, std::size_t lastSubmapIndex) const {
+    std::size_t divisor;
 
-        for (long submapIndex = lastSubmapIndex; submapIndex >= 0; submapIndex--) { // scan each submap (from the last to the first)
-            const Submap& submap = *getSubmap(submapIndex);
-            const std::pair<std::size_t, bool> findResult = submap.find(key, hash1, hash2);
-            if (findResult.second) { // the entry was found
-                return const_iterator(this, submapIndex, findResult.first);
-            }
-        }
+#ifdef FCMM_INT128
 
-        return end(); // the entry was not found
+    __extension__ typedef unsigned __int128 UInt128;
 
-    }
+    /**
+     * @brief floor(2^(65 + shift) / divisor) + 1 - 2^64, or 0 if the divisor is a power of two
+     */
+    std::uint64_t multiplier;
 
     /**
-     * @brief Inserts a new entry into the map. The key will be moved, if possible.
-     *
-     * The value is calculated as needed by calling the `computeValue` function or functor.
-     *
-     * @param key                    the key of the entry to be inserted
-     * @param hash1                  the first hash of the key
-     * @param hash2                  the second hash of the key
-     * @param computeValue           a function or functor that, given the key, calculates the corresponding value
-     *
-     * @tparam ComputeValueFunction  function or functor implementing `Value operator()(const Key&)`
-     *
-     * @return                       a pair consisting of a @link const_iterator @endlink to the inserted entry (or to the entry
-     *                               that prevented the insertion) and a `bool` denoting whether the insertion took place
+     * @brief floor(log2(divisor)), or log2(divisor) - 1 if the divisor is a power of two
      */
-    template<typename KeyType, typename ComputeValueFunction>
-    std::pair<const_iterator, bool> insertHelper(KeyType&& key, std::size_t hash1, std::size_t hash2, ComputeValueFunction computeValue) {
+    unsigned shift;
 
-        while (1) {
+#endif
 
-            const std::size_t lastSubmapIndex = getLastSubmapIndex();
+public:
 
-            // check if the map (excl. the last submap) already contains a value for the key
-            if (lastSubmapIndex > 0) {
-                const const_iterator findIterator = findHelper(key, hash1, hash2, lastSubmapIndex - 1);
-                if (findIterator != end()) { // the map already contains a value for the key
-                    return std::make_pair(findIterator, false);
-                }
-            }
+    explicit FastModulo(std::size_t divisor) : divisor(divisor) {
+#ifdef FCMM_INT128
+        shift = 0;
+        for (std::uint64_t power = divisor; power > 1; power >>= 1) {
+            shift++;
+        }
+        if ((divisor & (divisor - 1)) == 0) {
+            multiplier = 0; // the quotient is (n / 2) >> (shift - 1)
+            shift--;
+            return;
+        }
+        // 2^(65 + shift) / divisor is in (2^64, 2^65): its top bit is implicit
+        const std::uint64_t reciprocal = (std::uint64_t) (((UInt128) 1 << (64 + shift)) / divisor);
+        const std::uint64_t remainder = (std::uint64_t) (((UInt128) 1 << (64 + shift)) % divisor);
+        multiplier = reciprocal * 2;
+        if (remainder * 2 >= divisor || remainder * 2 < remainder) {
+            multiplier++;
+        }
+        multiplier++;
+#endif
+    }
 
-            Submap& lastSubmap = *getSubmap(lastSubmapIndex);
+    std::size_t operator()(std::size_t n) const FCMM_NOEXCEPT {
+#ifdef FCMM_INT128
+        const std::uint64_t wide = n;
+        const std::uint64_t high = (std::uint64_t) (((UInt128) wide * multiplier) >> 64);
+        const std::uint64_t quotient = (((wide - high) >> 1) + high) >> shift;
+        return (std::size_t) (wide - quotient * divisor);
+#else
+        return n % divisor;
+#endif
+    }
 
-            if (lastSubmap.isOverloaded()) { // check if the submap is overloaded
-                expand(); // expand the map
-                continue; // restart the insertion process
-            }
+};
 
-            try {
-                const std::pair<std::size_t, bool> insertResult =
-                        lastSubmap.insert(std::forward<KeyType>(key), hash1, hash2, computeValue);
-                if (insertResult.second) {
-                    incrementNumEntries();
-                }
-                const const_iterator insertIterator(this, lastSubmapIndex, insertResult.first);
-                return std::make_pair(insertIterator, insertResult.second);
-            } catch (typename Submap::FullSubmapException&) { // the submap is full
-                expand(); // expand the map
-                continue; // restart the insertion process
-            }
+/**
+ * @brief Calculates `n % divisor` for a fixed divisor with the `%` operator
+ *
+ * @see FastModulo
+ */
+class DivisionModulo {
 
-        }
+private:
 
-    }
+    std::size_t divisor;
 
 public:
 
-    /**
-     * @brief Constructor
-     *
-     * @param estimatedNumEntries  an estimate of the number of entries this map will store
-     * @param maxLoadFactor        the maximum load factor of each submap:
-     *                             it should be a floating point number in the open interval (0, 1)
-     * @param maxNumSubmaps        the maximum number of submaps that can be created (at least 1):
-     *                             if this limit is exceeded, a `std::runtime_error` is thrown
-     */
-    Fcmm(std::size_t estimatedNumEntries = 0,
-         float maxLoadFactor = DEFAULT_MAX_LOAD_FACTOR,
-         std::size_t maxNumSubmaps = DEFAULT_MAX_NUM_SUBMAPS) :
-            maxLoadFactor(maxLoadFactor),
-            numSubmaps(1),
-            submaps(maxNumSubmaps),
-            numEntries(0) {
+    explicit DivisionModulo(std::size_t divisor) : divisor(divisor) {
+    }
 
-        // Not using ATOMIC_FLAG_INIT to workaround a Visual Studio bug
-        expanding.clear();
+    std::size_t operator()(std::size_t n) const FCMM_NOEXCEPT {
+        return n % divisor;
+    }
 
-        if (maxLoadFactor <= 0.0f || maxLoadFactor >= 1.0f) {
-            throw std::logic_error("Invalid maximum load factor");
-        }
+};
 
-        if (maxNumSubmaps < 1) {
-            throw std::logic_error("Invalid maximum number of submaps");
-        }
+/**
+ * @brief A capacity policy of @link Fcmm @endlink where the number of groups of buckets of each submap is a prime
+ * number, and the probe sequences are generated by double hashing.
+ *
+ * A capacity policy is constructed once per submap and has to provide the following members:
+ *  - a constructor taking the minimum number of groups of the submap, to be rounded up as needed;
+ *  - `std::size_t getNumGroups() const`;
+ *  - `std::size_t calculateStartGroupIndex(std::size_t hash1) const`;
+ *  - `std::size_t calculateProbeIncrement(std::size_t hash2) const`;
+ *  - `std::size_t calculateNextGroupIndex(std::size_t groupIndex, std::size_t probeIncrement) const`.
+ *
+ * The probe sequence starting from any group has to visit all the groups before returning to the first one.
+ *
+ * @tparam  Modulo  the type of the function object reducing the hashes modulo a fixed divisor
+ *                  (see PrimeCapacityPolicy and FastPrimeCapacityPolicy)
+ *
+ * @see PowerOfTwoCapacityPolicy
+ */
+template<typename Modulo>
+class BasicPrimeCapacityPolicy {
 
-        // calculate the capacity of the first submap
-        const std::size_t firstSubmapCapacity = std::max(
-                    FIRST_SUBMAP_MIN_CAPACITY,
-                    nextPrime((std::size_t) (FIRST_SUBMAP_CAPACITY_MULTIPLIER * estimatedNumEntries / maxLoadFactor)));
+private:
 
-        // create the first submap
-        getSubmap(0).reset(new Submap(firstSubmapCapacity, maxLoadFactor));
+    std::size_t numGroups;
+    Modulo startGroupModulo;
+    Modulo probeIncrementModulo;
+
+public:
 
+    explicit BasicPrimeCapacityPolicy(std::size_t minNumGroups) :
+            numGroups(nextPrime(std::max(minNumGroups, (std::size_t) 3))),
+            startGroupModulo(numGroups),
+            probeIncrementModulo(numGroups - 1) {
     }
 
-    /**
-     * @brief Searches for an entry having key equal to `key`
-     *
-     * @param key  the key of the entry to be found
-     *
-     * @return     an @link const_iterator @endlink to an entry having key `key`, or a past-the-end
-     *             const_iterator if no such entry is found
-     */
-    const_iterator find(const Key& key) const {
-        return findHelper(key, keyHash1(key), keyHash2(key), getLastSubmapIndex());
+    std::size_t getNumGroups() const FCMM_NOEXCEPT {
+        return numGroups;
     }
 
-    /**
-     * @brief Returns a const reference to the value of an entry having key equal to `key`.
-     * If no such entry exists, an exception of type `std::out_of_range` is thrown.
-     *
-     * @param key                the key of the entry to be found
-     * @throw std::out_of_range  thrown if no entry exists having key equal to `key`
-     */
-    const Value& at(const Key& key) const {
-        const const_iterator findIterator = find(key);
-        if (findIterator == end()) {
-            throw std::out_of_range("Entry not found");
-        }
-        return findIterator->second;
+    std::size_t calculateStartGroupIndex(std::size_t hash1) const FCMM_NOEXCEPT {
+        return startGroupModulo(hash1);
     }
 
-    /**
+    std::size_t calculateProbeIncrement(std::size_t hash2) const FCMM_NOEXCEPT {
+        return 1 + probeIncrementModulo(hash2); // in [1, numGroups - 1]: coprime with numGroups
+    }
+
+    std::size_t calculateNextGroupIndex(std::size_t groupIndex, std::size_t probeIncrement) const FCMM_NOEXCEPT {
+        groupIndex += probeIncrement; // both terms are less than numGroups
+        return groupIndex >= numGroups ? groupIndex - numGroups : groupIndex;
+    }
+
+};
+
+/**
+ * @brief The default capacity policy of @link Fcmm @endlink: a prime number of groups of buckets per submap,
+ * with hashes reduced by hardware divisions
+ */
+typedef BasicPrimeCapacityPolicy<DivisionModulo> PrimeCapacityPolicy;
+
+/**
+ * @brief The same probe sequences as PrimeCapacityPolicy, with hashes reduced by precomputed reciprocals
+ * (see FastModulo): it pays off on processors with slow 64-bit divisions, while processors with fast
+ * dividers may execute lookups faster with PrimeCapacityPolicy
+ */
+typedef BasicPrimeCapacityPolicy<FastModulo> FastPrimeCapacityPolicy;
+
+/**
+ * @brief A capacity policy of @link Fcmm @endlink rounding the number of groups of buckets of each submap
+ * up to a power of two: reductions are bit masks, and the probe increments are odd (hence coprime with
+ * the number of groups). The start group is taken from the top bits of a multiplicative hash, so that
+ * hash functions with poor low bits do not cluster.
+ *
+ * Up to twice as much memory may be allocated as with PrimeCapacityPolicy.
+ *
+ * @see PrimeCapacityPolicy
+ */
+class PowerOfTwoCapacityPolicy {
+
+private:
+
+    std::size_t numGroups;
+    std::size_t mask;
+    unsigned shift;
+
+public:
+
+    explicit PowerOfTwoCapacityPolicy(std::size_t minNumGroups) :
+            numGroups(nextPowerOfTwo(std::max(minNumGroups, (std::size_t) 2))),
+            mask(numGroups - 1),
+            shift(sizeof(std::size_t) * 8 - log2OfPowerOfTwo(numGroups)) {
+    }
+
+    std::size_t getNumGroups() const FCMM_NOEXCEPT {
+        return numGroups;
+    }
+
+    std::size_t calculateStartGroupIndex(std::size_t hash1) const FCMM_NOEXCEPT {
+        // the multiplier differs from the one of the control byte fragments (see Fcmm::Submap::calculateFragment()),
+        // which would otherwise be correlated with the start group whenever hash2 is a simple function of hash1
+        return (hash1 * (std::size_t) 0xBF58476D1CE4E5B9ULL) >> shift;
+    }
+
+    std::size_t calculateProbeIncrement(std::size_t hash2) const FCMM_NOEXCEPT {
+        return (hash2 | 1) & mask; // odd
+    }
+
+    std::size_t calculateNextGroupIndex(std::size_t groupIndex, std::size_t probeIncrement) const FCMM_NOEXCEPT {
+        return (groupIndex + probeIncrement) & mask;
+    }
+
+};
+
+/**
+ * @brief An almost lock-free concurrent hashmap, providing a limited set of functionalities.
+ *
+ *  - Only find() and insert() operations are supported: once an entry is inserted into the map, it cannot
+ *    be erased nor updated. The filter() method provides a way to get a copy of the map containing only certain entries.
+ *  - The map can be iterated over with an InputIterator (see begin() and end()) or a range-based for loop.
+ *  - A deep copy of the map can be obtained with clone().
+ *  - The presence of duplicate keys into the map is avoided but the total absence is not guaranteed.
+ *    This is not an issue as long as it holds that: if (k<sub>1</sub>, v<sub>1</sub>) and (k<sub>2</sub>, v<sub>2</sub>)
+ *    are entries and k<sub>1</sub> = k<sub>2</sub>, then v<sub>1</sub> = v<sub>2</sub>.
+ *
+ * Due to its features, this data structure is fit to be used for memoization in concurrent environments.
+ *
+ * @tparam  Key         the type of the key in each entry (copy-constructible or move-constructible)
+ * @tparam  Value       the type of the value in each entry (copy-constructible or move-constructible)
+ * @tparam  KeyHash1    the type of a function object that calculates the hash of the key;
+ *                      it should have the same interface as
+ *                      <a href="http://en.cppreference.com/w/cpp/utility/hash">`std::hash<T>`</a>
+ * @tparam  KeyHash2    the type of another function object that calculates the hash of the key;
+ *                      it should be <b>completely independent from `KeyHash1`</b>
+ * @tparam  KeyEqual    the type of the function object that checks the equality of the two keys;
+ *                      it should have the same interface as
+ *                      <a href="http://en.cppreference.com/w/cpp/utility/functional/equal_to">`std::equal_to<T>`</a>
+ * @tparam  CapacityPolicy  the type determining the capacity of the submaps and the probe sequences
+ *                      (see PrimeCapacityPolicy and PowerOfTwoCapacityPolicy)
+ */
+template<
+    typename Key,
+    typename Value,
+    typename KeyHash1 = std::hash<Key>,
+    typename KeyHash2 = DefaultKeyHash2<Key>,
+    typename KeyEqual = std::equal_to<Key>,
+    typename CapacityPolicy = PrimeCapacityPolicy
+>
+class Fcmm {
+
+    static_assert(std::is_copy_constructible<Key>::value || std::is_move_constructible<Key>::value,
+                  "Key has to be copy-constructible or move-constructible, or both");
+    static_assert(std::is_copy_constructible<Value>::value || std::is_move_constructible<Value>::value,
+                  "Value has to be copy-constructible or move-constructible, or both");
+
+public:
+
+    /**
+     * @brief The type of the key in each entry
+     */
+    typedef Key key_type;
+
+    /**
+     * @brief The type of the value in each entry
+     */
+    typedef Value mapped_type;
+
+    /**
+     * @brief An entry of the map
+     */
+    typedef std::pair<Key, Value> Entry;
+
+    // Forward declaration
+    class const_iterator;
+
+    /**
+     * @brief Where the probing for a key ended in find(const Key&, InsertHint&), so that a later insertion of the key
+     * neither hashes it nor probes the buckets already probed again
+     *
+     * The hint remains usable whatever happens to the map meanwhile: if the map has expanded, the insertion restarts
+     * probing from scratch, though still without hashing the key.
+     */
+    class InsertHint {
+
+        friend class Fcmm;
+
+    private:
+
+        bool hashed; // false if the hint is not the outcome of a search
+        std::size_t hash1;
+        std::size_t hash2;
+        std::size_t submapIndex; // the last submap when the key was searched for
+        std::size_t groupIndex; // the group of that submap where probing can resume
+
+    public:
+
+        /**
+         * @brief Constructs an empty hint, to be filled by find(const Key&, InsertHint&)
+         */
+        InsertHint() : hashed(false), hash1(0), hash2(0), submapIndex(0), groupIndex(0) {
+        }
+
+    };
+
+private:
+
+    /**
+     * @brief First function object to calculate the hash code of a key
+     */
+    KeyHash1 keyHash1;
+
+    /**
+     * @brief Second function object to calculate the hash code of a key
+     */
+    KeyHash2 keyHash2;
+
+    /**
+     * @brief The hashes of the key of a bucket. They are only stored if StoreKeyHashes<Key> holds:
+     * otherwise, they are calculated when needed.
+     */
+    template<bool Stored, typename Dummy = void>
+    struct KeyHashes {
+
+        void storeHashes(std::size_t, std::size_t) FCMM_NOEXCEPT {
+        }
+
+        bool mayHaveHash1(std::size_t) const FCMM_NOEXCEPT {
+            return true;
+        }
+
+        std::size_t getHash1(const Key& key, const KeyHash1& keyHash1) const {
+            return keyHash1(key);
+        }
+
+        std::size_t getHash2(const Key& key, const KeyHash2& keyHash2) const {
+            return keyHash2(key);
+        }
+
+    };
+
+    template<typename Dummy>
+    struct KeyHashes<true, Dummy> {
+
+        std::size_t hash1;
+        std::size_t hash2;
+
+        void storeHashes(std::size_t hash1, std::size_t hash2) FCMM_NOEXCEPT {
+            this->hash1 = hash1;
+            this->hash2 = hash2;
+        }
+
+        bool mayHaveHash1(std::size_t hash1) const FCMM_NOEXCEPT {
+            return this->hash1 == hash1;
+        }
+
+        std::size_t getHash1(const Key&, const KeyHash1&) const FCMM_NOEXCEPT {
+            return hash1;
+        }
+
+        std::size_t getHash2(const Key&, const KeyHash2&) const FCMM_NOEXCEPT {
+            return hash2;
+        }
+
+    };
+
+    /**
+     * @brief Storage for the entries of a submap whose values are stored out of line (see StoreValuesOutOfLine).
+     *
+     * Entries are constructed one after the other in chunks of memory, never moved nor destroyed until the arena is.
+     * The arena is split into stripes (see getThreadStripeIndex()), each with its own chunks and mutex,
+     * so that concurrent insertions hardly ever contend for the same stripe.
+     */
+    class EntryArena {
+
+    private:
+
+        struct Stripe {
+            std::mutex mutex;
+            Entry* next; // where the next entry of the current chunk is constructed
+            Entry* end; // the end of the current chunk
+            std::vector<std::pair<Entry*, std::size_t>> chunks; // first entry and number of entries of each chunk
+            char padding[CACHE_LINE_SIZE]; // keeps the stripes apart
+        };
+
+        Stripe stripes[COUNTER_NUM_STRIPES];
+
+        std::mutex abandonedEntriesMutex;
+        std::vector<const Entry*> abandonedEntries; // whose value has never been constructed (see abandon())
+
+        /**
+         * @brief Allocates a new chunk for a stripe whose current chunk is full
+         */
+        static void allocateChunk(Stripe& stripe) {
+            const std::size_t maxChunkNumEntries = std::max(ARENA_MAX_CHUNK_SIZE / sizeof(Entry), (std::size_t) 1);
+            const std::size_t numEntries = stripe.chunks.empty() ? ARENA_FIRST_CHUNK_NUM_ENTRIES :
+                    std::max(std::min(stripe.chunks.back().second * 2, maxChunkNumEntries), stripe.chunks.back().second);
+            stripe.chunks.reserve(stripe.chunks.size() + 1); // so that the chunk cannot be leaked
+            Entry* chunk = std::allocator<Entry>().allocate(numEntries);
+            stripe.chunks.emplace_back(chunk, numEntries);
+            stripe.next = chunk;
+            stripe.end = chunk + numEntries;
+        }
+
+    public:
+
+        EntryArena() {
+            for (Stripe& stripe : stripes) {
+                stripe.next = nullptr;
+                stripe.end = nullptr;
+            }
+        }
+
+        /**
+         * @brief Destructor: destroys the entries and frees the chunks
+         */
+        ~EntryArena() {
+            std::sort(abandonedEntries.begin(), abandonedEntries.end());
+            for (Stripe& stripe : stripes) {
+                for (const std::pair<Entry*, std::size_t>& chunk : stripe.chunks) {
+                    Entry* const chunkEnd = chunk.first + chunk.second;
+                    Entry* const entriesEnd = chunkEnd == stripe.end ? stripe.next : chunkEnd; // only the last chunk is partial
+                    for (Entry* entry = chunk.first; entry != entriesEnd; entry++) {
+                        if (abandonedEntries.empty() ||
+                                !std::binary_search(abandonedEntries.begin(), abandonedEntries.end(), entry)) {
+                            entry->~Entry();
+                        } else {
+                            entry->first.~Key();
+                        }
+                    }
+                    std::allocator<Entry>().deallocate(chunk.first, chunk.second);
+                }
+            }
+        }
+
+        /**
+         * @brief Constructs a new entry in the arena
+         *
+         * @param args  arguments used to construct the entry
+         *
+         * @return      a pointer to the entry, valid as long as the arena
+         */
+        template<typename... Args>
+        Entry* construct(Args&&... args) {
+            Stripe& stripe = stripes[getThreadStripeIndex()];
+            std::lock_guard<std::mutex> lock(stripe.mutex);
+            if (stripe.next == stripe.end) {
+                allocateChunk(stripe);
+            }
+            Entry* entry = stripe.next;
+            new (entry) Entry(std::forward<Args>(args)...);
+            stripe.next++; // only once constructed: if the constructor throws, the memory is reused by the next entry
+            return entry;
+        }
+
+        /**
+         * @brief Constructs the key of a new entry in the arena, leaving its value uninitialized:
+         * the value must then be constructed in place, or the entry abandoned (see abandon())
+         *
+         * @return      a pointer to the entry, valid as long as the arena
+         */
+        template<typename KeyType>
+        Entry* constructKey(KeyType&& key) {
+            Stripe& stripe = stripes[getThreadStripeIndex()];
+            std::lock_guard<std::mutex> lock(stripe.mutex);
+            if (stripe.next == stripe.end) {
+                allocateChunk(stripe);
+            }
+            Entry* entry = stripe.next;
+            new (&entry->first) Key(std::forward<KeyType>(key));
+            stripe.next++;
+            return entry;
+        }
+
+        /**
+         * @brief Records that the value of an entry constructed by constructKey() will never be constructed,
+         * so that only its key is destroyed along with the arena
+         */
+        void abandon(const Entry* entry) {
+            std::lock_guard<std::mutex> lock(abandonedEntriesMutex);
+            abandonedEntries.push_back(entry);
+        }
+
+        EntryArena(const EntryArena&) = delete;
+        EntryArena& operator=(const EntryArena&) = delete;
+
+    };
+
+    /**
+     * @brief The entry of a bucket. It is constructed in the bucket itself, unless StoreValuesOutOfLine<Value> holds:
+     * in that case, it is constructed in the arena of the submap (see EntryArena), and the bucket points to it.
+     */
+    template<bool OutOfLine, typename Dummy = void>
+    struct EntrySlot {
+
+        /**
+         * @brief Nothing to hold: the entries are constructed in their buckets
+         */
+        struct Arena {
+        };
+
+        Entry entry;
+
+        Entry& getEntry() FCMM_NOEXCEPT {
+            return entry;
+        }
+
+        const Entry& getEntry() const FCMM_NOEXCEPT {
+            return entry;
+        }
+
+        template<typename... Args>
+        void constructEntry(Arena&, Args&&... args) {
+            new (&entry) Entry(std::forward<Args>(args)...);
+        }
+
+        /**
+         * @brief Constructs the key of the entry, leaving its value uninitialized (see Fcmm::insertExclusive())
+         */
+        template<typename KeyType>
+        void constructKey(Arena&, KeyType&& key) {
+            new (&entry.first) Key(std::forward<KeyType>(key));
+        }
+
+        void abandonEntry(Arena&) FCMM_NOEXCEPT {
+            // the key is destroyed by destroyAbandonedEntry()
+        }
+
+        void destroyEntry() {
+            entry.~Entry();
+        }
+
+        /**
+         * @brief Destroys the key of an entry whose value has never been constructed
+         */
+        void destroyAbandonedEntry() {
+            entry.first.~Key();
+        }
+
+    };
+
+    template<typename Dummy>
+    struct EntrySlot<true, Dummy> {
+
+        typedef EntryArena Arena;
+
+        Entry* entry;
+
+        Entry& getEntry() FCMM_NOEXCEPT {
+            return *entry;
+        }
+
+        const Entry& getEntry() const FCMM_NOEXCEPT {
+            return *entry;
+        }
+
+        template<typename... Args>
+        void constructEntry(Arena& arena, Args&&... args) {
+            entry = arena.construct(std::forward<Args>(args)...);
+        }
+
+        template<typename KeyType>
+        void constructKey(Arena& arena, KeyType&& key) {
+            entry = arena.constructKey(std::forward<KeyType>(key));
+        }
+
+        void abandonEntry(Arena& arena) {
+            arena.abandon(entry);
+        }
+
+        /**
+         * @brief Points the bucket to an entry of the arena of another submap (see Submap::linkEntry())
+         */
+        void linkEntry(Entry* entry) FCMM_NOEXCEPT {
+            this->entry = entry;
+        }
+
+        void destroyEntry() FCMM_NOEXCEPT {
+            // the entry is destroyed by the arena
+        }
+
+        void destroyAbandonedEntry() FCMM_NOEXCEPT {
+            // the key is destroyed by the arena
+        }
+
+    };
+
+    /**
+     * @brief A bucket of the hashmap. The state of the bucket is held by its control byte (see Control).
+     * The hashes of the key are written along with the key; they are always stored if the entry is out of line,
+     * so that probing does not touch the arena unless the first hash of the key matches.
+     */
+    struct Bucket : KeyHashes<StoreKeyHashes<Key>::value || StoreValuesOutOfLine<Value>::value>,
+                    EntrySlot<StoreValuesOutOfLine<Value>::value> {
+    };
+
+    /**
+     * @brief Uninitialized storage for a value computed before claiming the bucket it will be moved to:
+     * the value is only constructed if computed, and destroyed along with the storage. The value is only reached
+     * through the pointer set when it is constructed, so that compilers do not see it read uninitialized.
+     */
+    template<bool Trivial = std::is_trivial<Value>::value, typename Dummy = void>
+    class PendingValue {
+
+    private:
+
+        typename std::aligned_storage<sizeof(Value), alignof(Value)>::type storage;
+        Value* value; // nullptr until computed
+
+    public:
+
+        PendingValue() : value(nullptr) {
+        }
+
+        ~PendingValue() {
+            if (value != nullptr) {
+                value->~Value();
+            }
+        }
+
+        bool isComputed() const FCMM_NOEXCEPT {
+            return value != nullptr;
+        }
+
+        template<typename ComputeValueFunction>
+        void compute(ComputeValueFunction& computeValue, const Key& key) {
+            value = new (&storage) Value(computeValue(key));
+        }
+
+        Value& get() FCMM_NOEXCEPT {
+            return *value;
+        }
+
+        PendingValue(const PendingValue&) = delete;
+        PendingValue& operator=(const PendingValue&) = delete;
+
+    };
+
+    /**
+     * @brief Storage for a trivial value computed before claiming a bucket: it is value-initialized upfront,
+     * which costs nothing and lets compilers see that it is never read uninitialized
+     */
+    template<typename Dummy>
+    class PendingValue<true, Dummy> {
+
+    private:
+
+        Value value;
+        bool computed;
+
+    public:
+
+        PendingValue() : value(), computed(false) {
+        }
+
+        bool isComputed() const FCMM_NOEXCEPT {
+            return computed;
+        }
+
+        template<typename ComputeValueFunction>
+        void compute(ComputeValueFunction& computeValue, const Key& key) {
+            new (&value) Value(computeValue(key));
+            computed = true;
+        }
+
+        Value& get() FCMM_NOEXCEPT {
+            return value;
+        }
+
+        PendingValue(const PendingValue&) = delete;
+        PendingValue& operator=(const PendingValue&) = delete;
+
+    };
+
+    /**
+     * @brief A blocked Bloom filter of the keys of a frozen submap: each key sets three bits of a single 64-bit word,
+     * so that adding and testing a key touch one cache line
+     */
+    class BloomFilter {
+
+    private:
+
+        std::size_t wordMask;
+        std::unique_ptr<std::atomic<std::uint64_t>[]> words;
+
+        /**
+         * @brief Mixes the two hashes of a key into the bits to be set in the filter (the word index is in the top half)
+         */
+        static std::uint64_t mix(std::size_t hash1, std::size_t hash2) FCMM_NOEXCEPT {
+            std::uint64_t mixed = ((std::uint64_t) hash1 * 0x9E3779B97F4A7C15ULL) ^ (std::uint64_t) hash2;
+            mixed *= 0xC2B2AE3D27D4EB4FULL;
+            return mixed ^ (mixed >> 29);
+        }
+
+        static std::uint64_t calculateWordBits(std::uint64_t mixed) FCMM_NOEXCEPT {
+            return (std::uint64_t(1) << (mixed & 63)) | (std::uint64_t(1) << ((mixed >> 6) & 63)) |
+                    (std::uint64_t(1) << ((mixed >> 12) & 63));
+        }
+
+    public:
+
+        /**
+         * @brief Constructor
+         *
+         * @param numKeys  the expected number of keys
+         */
+        explicit BloomFilter(std::size_t numKeys) {
+            const std::size_t minNumWords = std::max((std::size_t) 1, (numKeys * BLOOM_FILTER_BITS_PER_KEY + 63) / 64);
+            std::size_t numWords = 1;
+            while (numWords < minNumWords) {
+                numWords *= 2;
+            }
+            wordMask = numWords - 1;
+            words.reset(new std::atomic<std::uint64_t>[numWords]);
+            for (std::size_t i = 0; i < numWords; i++) {
+                words[i].store(0, std::memory_order_relaxed);
+            }
+        }
+
+        /**
+         * @brief Adds a key to the filter, given its hashes
+         */
+        void add(std::size_t hash1, std::size_t hash2) FCMM_NOEXCEPT {
+            const std::uint64_t mixed = mix(hash1, hash2);
+            words[(mixed >> 32) & wordMask].fetch_or(calculateWordBits(mixed), std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Returns `false` if the key, given its hashes, was certainly not added to the filter
+         */
+        bool mayContain(std::size_t hash1, std::size_t hash2) const FCMM_NOEXCEPT {
+            const std::uint64_t mixed = mix(hash1, hash2);
+            const std::uint64_t wordBits = calculateWordBits(mixed);
+            return (words[(mixed >> 32) & wordMask].load(std::memory_order_relaxed) & wordBits) == wordBits;
+        }
+
+    };
+
+    /**
+     * @brief A submap is a collection of buckets, probed a group at a time.
+     *
+     * Both the control bytes and the buckets live in zero-filled memory: a zero control byte denotes an empty bucket,
+     * and the entry of a bucket is constructed when the bucket is claimed.
+     */
+    struct Submap {
+
+        /**
+         * @brief Function object to determine if two keys are equal
+         */
+        KeyEqual keyEqual;
+
+        /**
+         * @brief Number of groups of buckets and probe sequences
+         */
+        CapacityPolicy capacityPolicy;
+
+        /**
+         * @brief Number of buckets
+         */
+        std::size_t capacity;
+
+        /**
+         * @brief Memory holding the control bytes
+         */
+        ZeroedMemory controlsMemory;
+
+        /**
+         * @brief Memory holding the buckets
+         */
+        ZeroedMemory bucketsMemory;
+
+        /**
+         * @brief Control bytes array (see Control)
+         */
+        std::atomic<std::uint8_t>* controls;
+
+        /**
+         * @brief Buckets array (the entries of the buckets whose control byte is `EMPTY` are not constructed)
+         */
+        Bucket* buckets;
+
+        /**
+         * @brief Arena holding the entries, if they are stored out of line (see StoreValuesOutOfLine)
+         */
+        typename Bucket::Arena entryArena;
+
+        /**
+         * @brief Maximum load factor
+         */
+        float maxLoadFactor;
+
+        /**
+         * @brief Number of valid buckets past which the next submap is allocated in advance (see isNextSubmapDue())
+         */
+        std::size_t nextSubmapThreshold;
+
+        /**
+         * @brief Number of valid buckets
+         */
+        StripedCounter numValidBuckets;
+
+        /**
+         * @brief Bloom filter of the keys, created when the submap is frozen (see freeze())
+         */
+        std::unique_ptr<BloomFilter> filter;
+
+        /**
+         * @brief Set when the Bloom filter starts being built: from then on, insertions add their keys to it
+         */
+        std::atomic<bool> freezing;
+
+        /**
+         * @brief Set when the Bloom filter is complete and can be used by searches
+         */
+        std::atomic<bool> frozen;
+
+        /**
+         * @brief Number of searches skipped thanks to the Bloom filter
+         */
+        mutable StripedCounter numSkippedProbes;
+
+        /**
+         * @brief Index of the next group of buckets to be migrated (see Fcmm::helpMigration())
+         */
+        std::atomic<std::size_t> migrationCursor;
+
+        /**
+         * @brief Keeps the migration counters, updated by all the inserting threads, apart from each other
+         */
+        char migrationPadding[CACHE_LINE_SIZE - sizeof(std::atomic<std::size_t>)];
+
+        /**
+         * @brief Number of groups of buckets whose migration is complete
+         */
+        std::atomic<std::size_t> numMigratedGroups;
+
+        /**
+         * @brief Keeps the migration counters apart from the following variables
+         */
+        char migrationEndPadding[CACHE_LINE_SIZE - sizeof(std::atomic<std::size_t>)];
+
+        /**
+         * @brief Indices of the buckets whose value was being computed when they were reached by the migration
+         */
+        std::vector<std::size_t> deferredBuckets;
+
+        /**
+         * @brief Mutex protecting `deferredBuckets`
+         */
+        std::mutex deferredBucketsMutex;
+
+        /**
+         * @brief `true` once a thread has attempted to allocate the next submap in advance (see Fcmm::preallocateSubmap())
+         */
+        std::atomic<bool> nextSubmapRequested;
+
+        /**
+         * @brief Constructor
+         *
+         * @param minCapacity    the minimum capacity of this submap (the number of groups is rounded up by the capacity policy)
+         * @param maxLoadFactor  the maximum load factor of this submap
+         * @param hugePages      the huge pages backing this submap
+         * @param spillDirectory the directory of the files backing the buckets (`nullptr` for anonymous memory):
+         *                       the control bytes always stay in memory
+         */
+        Submap(std::size_t minCapacity, float maxLoadFactor, HugePages hugePages, const std::string* spillDirectory) :
+                capacityPolicy((minCapacity + GROUP_SIZE - 1) / GROUP_SIZE),
+                capacity(capacityPolicy.getNumGroups() * GROUP_SIZE),
+                controlsMemory(capacity * sizeof(std::atomic<std::uint8_t>), hugePages),
+                bucketsMemory(capacity * sizeof(Bucket), hugePages, spillDirectory),
+                controls(static_cast<std::atomic<std::uint8_t>*>(controlsMemory.get())),
+                buckets(static_cast<Bucket*>(bucketsMemory.get())),
+                maxLoadFactor(maxLoadFactor),
+                nextSubmapThreshold((std::size_t) (capacity * maxLoadFactor * NEXT_SUBMAP_ALLOCATION_LOAD_RATIO)),
+                freezing(false),
+                frozen(false),
+                migrationCursor(0),
+                numMigratedGroups(0),
+                nextSubmapRequested(false) {
+        }
+
+        /**
+         * @brief Destructor: destroys the entries that have been constructed in the buckets
+         * (the entries stored out of line are destroyed along with the arena)
+         */
+        ~Submap() {
+            if (!std::is_trivially_destructible<Entry>::value && !StoreValuesOutOfLine<Value>::value) {
+                for (std::size_t index = 0; index < getCapacity(); index++) {
+                    const std::uint8_t bucketControl = controls[index].load(std::memory_order_relaxed);
+                    if (Control::isValid(bucketControl)) {
+                        getBucket(index).destroyEntry();
+                    } else if (bucketControl == Control::ABANDONED) {
+                        getBucket(index).destroyAbandonedEntry();
+                    }
+                }
+            }
+        }
+
+        /**
+         * @brief Returns the capacity of this submap
+         */
+        std::size_t getCapacity() const FCMM_NOEXCEPT {
+            return capacity;
+        }
+
+        /**
+         * @brief Returns the number of groups of buckets of this submap
+         */
+        std::size_t getNumGroups() const FCMM_NOEXCEPT {
+            return capacityPolicy.getNumGroups();
+        }
+
+        /**
+         * @brief Returns a reference to a bucket of this submap
+         *
+         * @param index  the index of the bucket
+         */
+        Bucket& getBucket(std::size_t index) {
+            return buckets[index];
+        }
+
+        /**
+         * @brief Returns a const reference to a bucket of this submap
+         *
+         * @param index  the index of the bucket
+         */
+        const Bucket& getBucket(std::size_t index) const {
+            return buckets[index];
+        }
+
+        /**
+         * @brief Returns the number of entries in this submap
+         */
+        std::size_t getNumValidBuckets() const FCMM_NOEXCEPT {
+            return numValidBuckets.get();
+        }
+
+        /**
+         * @brief Returns the approximate number of entries in this submap (see StripedCounter::getApproximate())
+         */
+        std::size_t getApproximateNumValidBuckets() const FCMM_NOEXCEPT {
+            return numValidBuckets.getApproximate();
+        }
+
+        /**
+         * @brief Increments the number of valid buckets by 1
+         */
+        void incrementNumValidBuckets() FCMM_NOEXCEPT {
+            numValidBuckets.increment();
+        }
+
+        /**
+         * @brief Given the second hash of a key, calculates the control byte of the bucket containing the key:
+         * its most significant bit is set, and the others are a 7-bit fragment of the hash (the top bits of a
+         * multiplicative hash, depending on all the bits of `hash2`)
+         */
+        static std::uint8_t calculateFragment(std::size_t hash2) FCMM_NOEXCEPT {
+            return (std::uint8_t) (0x80 | ((hash2 * (std::size_t) 0x9E3779B97F4A7C15ULL) >> (sizeof(std::size_t) * 8 - 7)));
+        }
+
+        /**
+         * @brief Waits for the computation of the value of a bucket in the `COMPUTING` state to end
+         *
+         * @return  the new control byte of the bucket (either valid or `ABANDONED`)
+         */
+        static std::uint8_t waitForComputation(const std::atomic<std::uint8_t>& control) {
+            std::uint8_t bucketControl;
+            while ((bucketControl = control.load(std::memory_order_acquire)) == Control::COMPUTING) {
+                std::this_thread::yield();
+            }
+            return bucketControl;
+        }
+
+        /**
+         * @brief Searches for an entry having key equal to `key`
+         *
+         * @param key                the key of the entry to be found
+         * @param hash1              the first hash of the key
+         * @param hash2              the second hash of the key
+         * @param waitForComputing   if `true` and the value of the entry is being computed by another thread,
+         *                           wait for the computation to end instead of ignoring the entry
+         * @param waited             set to `true` if the function waited for the computation of the value
+         * @param resumeGroupIndex   if not `nullptr`, set to the group where a later insert() of the key can resume probing:
+         *                           the one where the probing ended, or the first one having buckets whose keys were
+         *                           not published yet (busy or being computed), which may turn out to be the key
+         *
+         * @return                   a pair consisting of the index of the entry (if found)
+         *                           and a `bool` denoting whether the entry was found
+         */
+        std::pair<std::size_t, bool> find(const Key& key, std::size_t hash1, std::size_t hash2,
+                                          bool waitForComputing, bool& waited, std::size_t* resumeGroupIndex = nullptr) const {
+
+            const std::uint8_t fragment = calculateFragment(hash2);
+            const std::size_t startGroupIndex = capacityPolicy.calculateStartGroupIndex(hash1); // initial group for probing
+            const std::size_t probeIncrement = capacityPolicy.calculateProbeIncrement(hash2); // double hashing
+            std::size_t groupIndex = startGroupIndex; // current group for probing
+
+            if (resumeGroupIndex != nullptr) {
+                *resumeGroupIndex = startGroupIndex; // if the whole submap is scanned
+            }
+            bool unpublishedKeysProbed = false;
+
+            do {
+
+                const std::size_t firstIndex = groupIndex * GROUP_SIZE;
+                prefetch(&getBucket(firstIndex)); // the entry, if present, is likely at the beginning of the group
+                const Group group(&controls[firstIndex]);
+
+                if (resumeGroupIndex != nullptr && !unpublishedKeysProbed) {
+                    *resumeGroupIndex = groupIndex;
+                    unpublishedKeysProbed = (group.match(Control::BUSY) | group.match(Control::COMPUTING)) != 0;
+                }
+
+                // only the buckets that may contain the key, or end the probing, are checked (in order)
+                std::uint32_t candidates = group.match(fragment) | group.match(Control::EMPTY);
+                if (waitForComputing) {
+                    candidates |= group.match(Control::COMPUTING);
+                }
+
+                while (candidates != 0) {
+
+                    const std::size_t index = firstIndex + countTrailingZeros(candidates);
+                    candidates &= candidates - 1;
+
+                    std::uint8_t bucketControl = controls[index].load(std::memory_order_relaxed);
+
+                    if (waitForComputing && bucketControl == Control::COMPUTING) {
+
+                        std::atomic_thread_fence(std::memory_order_acquire); // memory fence
+
+                        const Bucket& bucket = getBucket(index);
+                        if (bucket.mayHaveHash1(hash1) && keyEqual(bucket.getEntry().first, key)) {
+                            // the value of the requested entry is being computed by another thread
+                            waited = true;
+                            bucketControl = waitForComputation(controls[index]);
+                        }
+
+                    }
+
+                    if (bucketControl == fragment) {
+
+                        std::atomic_thread_fence(std::memory_order_acquire); // memory fence
+
+                        const Bucket& bucket = getBucket(index);
+                        if (bucket.mayHaveHash1(hash1) && keyEqual(bucket.getEntry().first, key)) {
+                            // the requested entry was found
+                            return std::make_pair(index, true);
+                        }
+
+                    } else if (bucketControl == Control::EMPTY) {
+
+                        // found a non-busy empty bucket: the requested entry is not present
+                        return std::make_pair(0, false);
+
+                    }
+
+                }
+
+                groupIndex = capacityPolicy.calculateNextGroupIndex(groupIndex, probeIncrement); // move to the next group
+
+            } while (groupIndex != startGroupIndex);
+
+            if (resumeGroupIndex != nullptr) {
+                *resumeGroupIndex = startGroupIndex;
+            }
+
+            // scanned the whole submap: the requested entry is not present
+            return std::make_pair(0, false);
+
+        }
+
+        /**
+         * @brief Seeks the first valid bucket starting from `index` (inclusive)
+         *
+         * @param index  the index where the search should start;
+         *               when the function returns, the variable contains the index where the valid bucket
+         *               was found (if any)
+         *
+         * @return       `true` if a valid bucket was found, `false` if the end of the submap
+         *               has been reached without finding a valid bucket
+         */
+        bool seek(std::size_t& index) const {
+
+            while (index < getCapacity()) {
+
+                if (Control::isValid(controls[index].load(std::memory_order_relaxed))) {
+                    std::atomic_thread_fence(std::memory_order_acquire); // memory fence
+                    return true;
+                }
+
+                index++; // move to the next bucket
+
+            }
+
+            // reached the end of the buckets vector
+            return false;
+
+        }
+
+        /**
+         * @brief This exception is thrown by insert() if the new entry could not be inserted because the submap is full
+         */
+        struct FullSubmapException {
+        };
+
+        /**
+         * @brief Inserts a new entry into the submap, if the submap doesn't already contain an entry with the same key.
+         * The key will be moved, if possible.
+         *
+         * The value is calculated as needed by calling the `computeValue` function or functor.
+         *
+         * @param key                    the key of the entry to be inserted
+         * @param hash1                  the first hash of the key
+         * @param hash2                  the second hash of the key
+         * @param computeValue           a function or functor that, given the key, calculates the corresponding value
+         * @param claimBeforeCompute     if `true`, the bucket is claimed (and the key published) before computing the value,
+         *                               so that other threads wait for the value instead of computing it again
+         * @param waited                 set to `true` if the function waited for a value computed by another thread
+         * @param insertedWhileFreezing  set to `true` if the entry was inserted after the submap started being frozen:
+         *                               in that case, the entry may have been missed by the migration (see Fcmm::helpMigration())
+         *
+         * @return                       a pair consisting of the index of the entry (either inserted or preventing the insertion)
+         *                               and a `bool` denoting whether the entry was inserted
+         *
+         * @tparam ComputeValueFunction  function or functor implementing `Value operator()(const Key&)`
+         *
+         * @throw FullSubmapException    thrown if the new entry could not be inserted because the submap is full
+         *
+         */
+        template<typename KeyType, typename ComputeValueFunction>
+        std::pair<std::size_t, bool> insert(KeyType&& key, std::size_t hash1, std::size_t hash2, ComputeValueFunction computeValue,
+                                            bool claimBeforeCompute, bool& waited, bool& insertedWhileFreezing) {
+            return insertFrom(std::forward<KeyType>(key), hash1, hash2, computeValue, claimBeforeCompute, waited,
+                              insertedWhileFreezing, capacityPolicy.calculateStartGroupIndex(hash1));
+        }
+
+        /**
+         * @brief Inserts a new entry into the submap like insert(), with the probing starting (or resuming) from a given group
+         *
+         * @param firstGroupIndex  the group where the probing starts, or resumes as set by find()
+         *                         (the groups probed before it cannot contain the key)
+         *
+         * @see insert()
+         */
+        template<typename KeyType, typename ComputeValueFunction>
+        std::pair<std::size_t, bool> insertFrom(KeyType&& key, std::size_t hash1, std::size_t hash2, ComputeValueFunction computeValue,
+                                                bool claimBeforeCompute, bool& waited, bool& insertedWhileFreezing,
+                                                std::size_t firstGroupIndex) {
+
+            PendingValue<> value; // unless the bucket has to be claimed first, computed before claiming it
+
+            const std::uint8_t fragment = calculateFragment(hash2);
+            const std::size_t startGroupIndex = capacityPolicy.calculateStartGroupIndex(hash1); // initial group for probing
+            const std::size_t probeIncrement = capacityPolicy.calculateProbeIncrement(hash2); // double hashing
+            std::size_t groupIndex = firstGroupIndex; // current group for probing
+
+            do {
+
+                const std::size_t firstIndex = groupIndex * GROUP_SIZE;
+                prefetch(&getBucket(firstIndex)); // the entry, if present, is likely at the beginning of the group
+                const Group group(&controls[firstIndex]);
+
+                // the buckets containing entries with other keys are skipped
+                std::uint32_t candidates = group.match(fragment) | group.matchInvalid();
+
+                while (candidates != 0) {
+
+                    const std::size_t index = firstIndex + countTrailingZeros(candidates);
+                    candidates &= candidates - 1;
+
+                    Bucket& bucket = getBucket(index); // the current bucket being probed
+                    std::atomic<std::uint8_t>& control = controls[index];
+
+                    std::uint8_t bucketControl = control.load(std::memory_order_relaxed);
+
+                    if (bucketControl == Control::EMPTY) {
+
+                        // since the bucket is (probably) empty, we will try to write the entry on it:
+                        // unless the bucket has to be claimed first, let's compute the value of the entry
+                        // (if it hasn't been computed yet)
+                        if (!claimBeforeCompute && !value.isComputed()) {
+                            value.compute(computeValue, key);
+                        }
+
+                        // try to "lock" the bucket (without spinlocking)
+                        if (control.compare_exchange_strong(bucketControl, (std::uint8_t) Control::BUSY, std::memory_order_seq_cst)) {
+
+                            // the bucket is now busy and this thread is the only one that can write on it
+
+                            // if the submap is being frozen, the key has to be added to its Bloom filter (see freeze())
+                            const bool freezingSubmap = freezing.load(std::memory_order_seq_cst);
+                            insertedWhileFreezing = freezingSubmap;
+
+                            bucket.storeHashes(hash1, hash2);
+
+                            if (claimBeforeCompute) {
+                                bucket.constructKey(entryArena, std::move(key));
+                                // publish the key, so that other threads wait for the value instead of computing it
+                                // (the value is not constructed until then: waiting threads do not read it)
+                                control.store(Control::COMPUTING, std::memory_order_release);
+                                if (freezingSubmap) {
+                                    filter->add(hash1, hash2);
+                                }
+                                Entry& entry = bucket.getEntry();
+                                try {
+                                    new (&entry.second) Value(computeValue(entry.first));
+                                } catch (...) {
+                                    bucket.abandonEntry(entryArena);
+                                    control.store(Control::ABANDONED, std::memory_order_release);
+                                    throw;
+                                }
+                            } else {
+                                bucket.constructEntry(entryArena, std::move(key), std::move(value.get()));
+                                if (freezingSubmap) {
+                                    filter->add(hash1, hash2);
+                                }
+                            }
+
+                            control.store(fragment, std::memory_order_release); // mark the bucket as valid
+
+                            incrementNumValidBuckets();
+
+                            return std::make_pair(index, true);
+
+                        }
+
+                    }
+
+                    // The following block cannot be turned into an else-if attatched to the previous if block, since the variable bucketControl
+                    // may have been updated by compare_exchange_strong.
+                    // Moreover, if the bucket is not valid, we re-load a fresh value of the control byte and
+                    // check if it has become valid in the meantime. This strategy reduces the presence of duplicates in the map.
+                    // When claiming before computing, we also wait for busy buckets to publish their keys, since the cost of waiting
+                    // is negligible compared to the cost of a duplicate computation.
+                    if (!Control::isValid(bucketControl)) {
+                        bucketControl = control.load(std::memory_order_relaxed);
+                        while (claimBeforeCompute && bucketControl == Control::BUSY) {
+                            std::this_thread::yield();
+                            bucketControl = control.load(std::memory_order_relaxed);
+                        }
+                    }
+
+                    if (bucketControl == fragment || bucketControl == Control::COMPUTING) {
+
+                        std::atomic_thread_fence(std::memory_order_acquire); // memory fence
+
+                        if (bucket.mayHaveHash1(hash1) && keyEqual(bucket.getEntry().first, key)) { // does the key match?
+
+                            if (bucketControl == Control::COMPUTING) {
+                                // another thread is computing the value: wait for it
+                                waited = true;
+                                bucketControl = waitForComputation(control);
+                            }
+
+                            if (bucketControl == fragment) {
+                                // the key is already present in this submap: insertion failed
+                                return std::make_pair(index, false);
+                            }
+
+                        }
+
+                    }
+
+                }
+
+                groupIndex = capacityPolicy.calculateNextGroupIndex(groupIndex, probeIncrement); // move to the next group
+
+            } while (groupIndex != startGroupIndex);
+
+            // if the flow arrived here, then the submap is full: throw an exception that will be caught by Fcmm::insert()
+            throw FullSubmapException();
+
+        }
+
+        /**
+         * @brief Inserts an entry stored out of line in the arena of an older submap (see StoreValuesOutOfLine) into this
+         * submap without copying it, if the submap doesn't already contain an entry with the same key: the new bucket
+         * points to the same entry, which lives as long as the older submap (submaps are only deleted along with the map).
+         *
+         * @param entry                  the entry to be inserted
+         * @param hash1                  the first hash of the key
+         * @param hash2                  the second hash of the key
+         * @param insertedWhileFreezing  set to `true` if the entry was inserted after the submap started being frozen
+         *                               (see insert())
+         *
+         * @return                       `true` if the entry was inserted, `false` otherwise
+         *
+         * @throw FullSubmapException    thrown if the entry could not be inserted because the submap is full
+         */
+        bool linkEntry(Entry* entry, std::size_t hash1, std::size_t hash2, bool& insertedWhileFreezing) {
+
+            const std::uint8_t fragment = calculateFragment(hash2);
+            const std::size_t startGroupIndex = capacityPolicy.calculateStartGroupIndex(hash1);
+            const std::size_t probeIncrement = capacityPolicy.calculateProbeIncrement(hash2);
+            std::size_t groupIndex = startGroupIndex;
+
+            do {
+
+                const std::size_t firstIndex = groupIndex * GROUP_SIZE;
+                const Group group(&controls[firstIndex]);
+
+                std::uint32_t candidates = group.match(fragment) | group.matchInvalid();
+
+                while (candidates != 0) {
+
+                    const std::size_t index = firstIndex + countTrailingZeros(candidates);
+                    candidates &= candidates - 1;
+
+                    Bucket& bucket = getBucket(index);
+                    std::atomic<std::uint8_t>& control = controls[index];
+
+                    std::uint8_t bucketControl = control.load(std::memory_order_relaxed);
+
+                    if (bucketControl == Control::EMPTY &&
+                            control.compare_exchange_strong(bucketControl, (std::uint8_t) Control::BUSY, std::memory_order_seq_cst)) {
+
+                        const bool freezingSubmap = freezing.load(std::memory_order_seq_cst); // see insertFrom()
+                        insertedWhileFreezing = freezingSubmap;
+
+                        bucket.storeHashes(hash1, hash2);
+                        bucket.linkEntry(entry);
+                        if (freezingSubmap) {
+                            filter->add(hash1, hash2);
+                        }
+
+                        control.store(fragment, std::memory_order_release); // mark the bucket as valid
+
+                        incrementNumValidBuckets();
+
+                        return true;
+
+                    }
+
+                    // as in insertFrom(), a bucket that is not valid may have become valid in the meantime
+                    if (!Control::isValid(bucketControl)) {
+                        bucketControl = control.load(std::memory_order_relaxed);
+                    }
+
+                    if (bucketControl == fragment || bucketControl == Control::COMPUTING) {
+
+                        std::atomic_thread_fence(std::memory_order_acquire); // memory fence
+
+                        if (bucket.mayHaveHash1(hash1) && keyEqual(bucket.getEntry().first, entry->first)) {
+
+                            if (bucketControl == Control::COMPUTING) {
+                                bucketControl = waitForComputation(control);
+                            }
+
+                            if (bucketControl == fragment) {
+                                return false; // the key is already present in this submap
+                            }
+
+                        }
+
+                    }
+
+                }
+
+                groupIndex = capacityPolicy.calculateNextGroupIndex(groupIndex, probeIncrement);
+
+            } while (groupIndex != startGroupIndex);
+
+            throw FullSubmapException();
+
+        }
+
+        /**
+         * @brief Prefetches the control bytes and the first bucket of the group where the probing for a key starts
+         *
+         * @param hash1  the first hash of the key
+         */
+        void prefetchStartGroup(std::size_t hash1) const {
+            const std::size_t firstIndex = capacityPolicy.calculateStartGroupIndex(hash1) * GROUP_SIZE;
+            prefetch(&controls[firstIndex]);
+            prefetch(&getBucket(firstIndex));
+        }
+
+        /**
+         * @brief Returns `false` if the Bloom filter of the submap rules out the key, given its hashes
+         * (`true` if the submap is not frozen yet)
+         */
+        bool mayContain(std::size_t hash1, std::size_t hash2) const {
+            if (frozen.load(std::memory_order_acquire) && !filter->mayContain(hash1, hash2)) {
+                numSkippedProbes.increment();
+                return false;
+            }
+            return true;
+        }
+
+        /**
+         * @brief Builds the Bloom filter of the keys of this submap, once a newer submap has been created.
+         *
+         * Insertions still in progress on this submap may claim buckets concurrently. Claiming a bucket and
+         * setting the `freezing` flag are both followed by a sequentially consistent load (of the flag and of the
+         * bucket control byte respectively): either the insertion sees the flag set and adds its key to the filter by
+         * itself, or this function sees the bucket busy and waits for the key to be written.
+         * The migration of the submap relies on the same handshake (see Fcmm::helpMigration()).
+         *
+         * @param keyHash1  the first hash function
+         * @param keyHash2  the second hash function
+         */
+        void freeze(const KeyHash1& keyHash1, const KeyHash2& keyHash2) {
+
+            filter.reset(new BloomFilter(getNumValidBuckets() + GROUP_SIZE));
+            freezing.store(true, std::memory_order_seq_cst);
+
+            for (std::size_t index = 0; index < getCapacity(); index++) {
+                std::uint8_t bucketControl;
+                while ((bucketControl = controls[index].load(std::memory_order_seq_cst)) == Control::BUSY) {
+                    std::this_thread::yield();
+                }
+                if (Control::isValid(bucketControl) || bucketControl == Control::COMPUTING) {
+                    const Bucket& bucket = getBucket(index);
+                    filter->add(bucket.getHash1(bucket.getEntry().first, keyHash1), bucket.getHash2(bucket.getEntry().first, keyHash2));
+                }
+            }
+
+            frozen.store(true, std::memory_order_release);
+
+        }
+
+        /**
+         * @brief Returns `true` if the submap is overloaded (according to the approximate number of entries:
+         * the maximum load factor may be slightly exceeded)
+         */
+        bool isOverloaded() const FCMM_NOEXCEPT {
+            return (float) getApproximateNumValidBuckets() / getCapacity() >= maxLoadFactor;
+        }
+
+        /**
+         * @brief Returns `true` if the submap is loaded enough for the next submap to be allocated in advance
+         * (an overloaded submap is also due)
+         */
+        bool isNextSubmapDue() const FCMM_NOEXCEPT {
+            return getApproximateNumValidBuckets() >= nextSubmapThreshold;
+        }
+
+        /**
+         * @brief Returns statistics about this Fcmm::Submap instance.
+         *
+         * @see SubmapStats
+         */
+        SubmapStats getStats() const {
+
+            SubmapStats stats;
+
+            stats.capacity = getCapacity();
+            stats.numValidBuckets = getNumValidBuckets();
+            stats.loadFactor = (float) stats.numValidBuckets / stats.capacity;
+            stats.numSkippedProbes = numSkippedProbes.get();
+
+            return stats;
+
+        }
+
+    };
+
+    /**
+     * @brief Maximum load factor
+     */
+    float maxLoadFactor;
+
+    /**
+     * @brief Huge pages backing the submaps
+     */
+    HugePages hugePages;
+
+    /**
+     * @brief Directory of the files backing the buckets of the submaps (`nullptr` if they are not spilled)
+     */
+    std::unique_ptr<const std::string> spillDirectory;
+
+    /**
+     * @brief Number of submaps in this map
+     */
+    std::atomic<std::size_t> numSubmaps;
+
+    /**
+     * @brief Index of the first submap that has not been retired (see helpMigration())
+     */
+    std::atomic<std::size_t> firstLiveSubmapIndex;
+
+    /**
+     * @brief Maximum number of submaps
+     */
+    std::size_t maxNumSubmaps;
+
+    /**
+     * @brief Submaps pointers array, owned by this map: the submap following the last one may have already been
+     * allocated, but it is not published until the number of submaps is incremented (see expand())
+     */
+    std::unique_ptr<std::atomic<Submap*>[]> submaps;
+
+    /**
+     * @brief Number of copies of entries inserted into newer submaps by the migration: the number of entries in the map
+     * is the number of valid buckets of all the submaps minus this number (see getNumEntries())
+     */
+    StripedCounter numMigratedEntries;
+
+    /**
+     * @brief Number of computations avoided by insertExclusive()
+     */
+    StripedCounter numAvoidedComputations;
+
+    /**
+     * @brief The log the inserted entries are appended to, or `nullptr` (see setEntryLog())
+     */
+    EntryLog* entryLog;
+
+    /**
+     * @brief Appends an entry to the log: set by setEntryLog(), so that Serializer is only instantiated
+     * for the maps that are logged (and the logging is kept out of the insertion path)
+     */
+    void (*appendToEntryLogFunction)(EntryLog& log, const Entry& entry);
+
+    static void appendToEntryLog(EntryLog& log, const Entry& entry) {
+        log.append(entry.first, entry.second);
+    }
+
+
+    /**
+     * @brief Returns the maximum number of submaps
+     */
+    std::size_t getMaxNumSubmaps() const FCMM_NOEXCEPT {
+        return maxNumSubmaps;
+    }
+
+    /**
+     * @brief Returns a submap pointer (`nullptr` if the submap has not been allocated yet)
+     *
+     * @param index  the index of the submap
+     */
+    Submap* getSubmap(std::size_t index) {
+        return submaps[index].load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Returns a const submap pointer (`nullptr` if the submap has not been allocated yet)
+     *
+     * @param index  the index of the submap
+     */
+    const Submap* getSubmap(std::size_t index) const {
+        return submaps[index].load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Returns the number of submaps
+     */
+    std::size_t getNumSubmaps() const FCMM_NOEXCEPT {
+        return numSubmaps.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Returns the index of the last submap
+     */
+    std::size_t getLastSubmapIndex() const FCMM_NOEXCEPT {
+        return getNumSubmaps() - 1;
+    }
+
+    /**
+     * @brief Returns the index of the first submap that has not been retired.
+     *
+     * Searches must load it before the index of the last submap: the entries of a submap retired afterwards
+     * have been migrated to a submap that is not newer than the last one.
+     */
+    std::size_t getFirstLiveSubmapIndex() const FCMM_NOEXCEPT {
+        return firstLiveSubmapIndex.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Increments the number of copies inserted by the migration by 1
+     */
+    void incrementNumMigratedEntries() FCMM_NOEXCEPT {
+        numMigratedEntries.increment();
+    }
+
+    /**
+     * @brief Increments the number of avoided computations by 1
+     */
+    void incrementNumAvoidedComputations() FCMM_NOEXCEPT {
+        numAvoidedComputations.increment();
+    }
+
+    /**
+     * @brief Returns the submap following the last one, allocating it if no other thread has done it yet.
+     * Concurrent allocations are resolved with a CAS on the submap pointer: the losers discard their submaps.
+     *
+     * @param submapIndex  the index of the submap (the index of the last submap plus one)
+     */
+    Submap* allocateSubmap(std::size_t submapIndex) {
+
+        Submap* submap = getSubmap(submapIndex);
+
+        if (submap == nullptr) {
+            const std::size_t newSubmapCapacity = getSubmap(submapIndex - 1)->getCapacity() * NEW_SUBMAPS_CAPACITY_MULTIPLIER;
+            std::unique_ptr<Submap> newSubmap(new Submap(newSubmapCapacity, maxLoadFactor, hugePages, spillDirectory.get()));
+            if (submaps[submapIndex].compare_exchange_strong(submap, newSubmap.get(), std::memory_order_acq_rel,
+                                                             std::memory_order_acquire)) {
+                submap = newSubmap.release();
+            }
+        }
+
+        return submap;
+
+    }
+
+    /**
+     * @brief Allocates the submap following the last one in advance (see Submap::isNextSubmapDue()), so that
+     * the expansion of the map only has to publish it. A single thread makes a single attempt, the others do not wait:
+     * an allocation failure (or a failure to create a spill file) is ignored, since the map may never need the submap
+     * (otherwise expand() fails in turn).
+     *
+     * @param lastSubmap   the last submap
+     * @param submapIndex  the index of the submap to be allocated (the index of the last submap plus one)
+     */
+    void preallocateSubmap(Submap& lastSubmap, std::size_t submapIndex) {
+        if (submapIndex < getMaxNumSubmaps() && !lastSubmap.nextSubmapRequested.exchange(true, std::memory_order_relaxed)) {
+            try {
+                allocateSubmap(submapIndex);
+            } catch (std::bad_alloc&) {
+            } catch (std::runtime_error&) {
+            }
+        }
+    }
+
+    /**
+     * @brief Called by insertions once the last submap is due for the allocation of the next one: expands the map
+     * if the last submap is overloaded, otherwise allocates the next submap in advance. Not inlined, to keep
+     * the insertion path short.
+     *
+     * @param lastSubmap       the last submap
+     * @param lastSubmapIndex  the index of the last submap
+     *
+     * @return                 `true` if the last submap is overloaded (the insertion has to be restarted)
+     */
+    FCMM_NOINLINE bool prepareExpansion(Submap& lastSubmap, std::size_t lastSubmapIndex) {
+        if (lastSubmap.isOverloaded()) {
+            expand();
+            return true;
+        }
+        if (!lastSubmap.nextSubmapRequested.load(std::memory_order_relaxed)) {
+            preallocateSubmap(lastSubmap, lastSubmapIndex + 1);
+        }
+        return false;
+    }
+
+    /**
+     * @brief Expands the map by publishing the submap following the last one (allocated in advance, if possible)
+     * with a CAS on the number of submaps. The threads losing the CAS do not wait for the winner to freeze
+     * the old last submap.
+     *
+     * @return  `true` if the map has been expanded by the calling thread, `false` otherwise
+     */
+    bool expand() {
+
+        const std::size_t numSubmapsSnapshot = getNumSubmaps();
+
+        // check if the maximum number of submaps has been reached
+        if (numSubmapsSnapshot == getMaxNumSubmaps()) {
+            throw std::runtime_error("Reached the maximum number of submaps: " + std::to_string(getMaxNumSubmaps()));
+        }
+
+        // get the last submap
+        const std::size_t lastSubmapIndex = numSubmapsSnapshot - 1;
+        Submap& lastSubmap = *getSubmap(lastSubmapIndex);
+
+        if (!lastSubmap.isOverloaded()) { // re-check if the submap is overloaded
+            return false;
+        }
+
+        allocateSubmap(lastSubmapIndex + 1);
+
+        // publish the new submap
+        std::size_t expectedNumSubmaps = numSubmapsSnapshot;
+        if (!numSubmaps.compare_exchange_strong(expectedNumSubmaps, numSubmapsSnapshot + 1, std::memory_order_acq_rel)) {
+            return false; // another thread has expanded the map
+        }
+
+        lastSubmap.freeze(keyHash1, keyHash2); // no more insertions will start on the old submap
+
+        if (!MigrationEnabled::value) {
+            lastSubmap.bucketsMemory.markCold(); // from now on, only searched past its Bloom filter
+        }
+
+        return true;
+
+    }
+
+    /**
+     * @brief Migration requires copying keys and values, unless the entries are stored out of line
+     * (see copyEntry())
+     */
+    typedef std::integral_constant<bool, (std::is_copy_constructible<Key>::value && std::is_copy_constructible<Value>::value) ||
+            StoreValuesOutOfLine<Value>::value> MigrationEnabled;
+
+    /**
+     * @brief Copies the entry of a bucket of a frozen submap to another submap
+     *
+     * @return  `true` if the entry has been copied, `false` if the submap already contains an entry with the same key
+     */
+    static bool copyEntry(Submap& submap, const Bucket& bucket, std::size_t hash1, std::size_t hash2,
+                          bool& insertedWhileFreezing, std::false_type) {
+        const Entry& entry = bucket.getEntry();
+        bool waited = false;
+        return submap.insert(entry.first, hash1, hash2, [&entry](const Key&) -> const Value& { return entry.second; },
+                             false, waited, insertedWhileFreezing).second;
+    }
+
+    /**
+     * @brief Entries stored out of line are not copied: the bucket of the other submap points to the same entry
+     */
+    static bool copyEntry(Submap& submap, const Bucket& bucket, std::size_t hash1, std::size_t hash2,
+                          bool& insertedWhileFreezing, std::true_type) {
+        return submap.linkEntry(bucket.entry, hash1, hash2, insertedWhileFreezing);
+    }
+
+    /**
+     * @brief Copies the entry of a bucket of a frozen submap to the last submap. If the last submap is being frozen in turn,
+     * the copy is migrated again.
+     *
+     * @param bucket  the bucket holding the entry to be copied
+     * @param hash1   the first hash of the key
+     * @param hash2   the second hash of the key
+     */
+    void migrateEntry(const Bucket& bucket, std::size_t hash1, std::size_t hash2, std::true_type) {
+
+        while (1) {
+
+            Submap& lastSubmap = *getSubmap(getLastSubmapIndex());
+
+            if (lastSubmap.isOverloaded()) {
+                expand();
+                continue;
+            }
+
+            try {
+                bool insertedWhileFreezing = false;
+                if (copyEntry(lastSubmap, bucket, hash1, hash2, insertedWhileFreezing,
+                              std::integral_constant<bool, StoreValuesOutOfLine<Value>::value>())) {
+                    incrementNumMigratedEntries();
+                    if (insertedWhileFreezing) {
+                        continue; // the copy may have been missed by the migration of the last submap as well
+                    }
+                }
+                return;
+            } catch (typename Submap::FullSubmapException&) {
+                expand();
+            }
+
+        }
+
+    }
+
+    void migrateEntry(const Bucket&, std::size_t, std::size_t, std::false_type) {
+    }
+
+    /**
+     * @brief Migrates a bucket of a frozen submap: valid entries are copied to the last submap, while the buckets whose
+     * value is being computed are deferred (they cannot be waited for, since the computation may be carried out by the
+     * calling thread itself)
+     *
+     * @return `true` if the bucket has been deferred
+     */
+    bool migrateBucket(Submap& submap, std::size_t index) {
+
+        std::uint8_t bucketControl;
+        while ((bucketControl = submap.controls[index].load(std::memory_order_seq_cst)) == Control::BUSY) {
+            std::this_thread::yield(); // the key is being written
+        }
+
+        if (bucketControl == Control::COMPUTING) {
+            return true;
+        }
+
+        if (Control::isValid(bucketControl)) {
+            const Bucket& bucket = submap.getBucket(index);
+            const Entry& entry = bucket.getEntry();
+            migrateEntry(bucket, bucket.getHash1(entry.first, keyHash1), bucket.getHash2(entry.first, keyHash2), std::true_type());
+        }
+
+        return false;
+
+    }
+
+    /**
+     * @brief Migrates a batch of buckets of the oldest frozen submap that has not been retired to the last submap.
+     * Once all the entries of the submap have been copied, the submap is retired: searches no longer visit it.
+     * Submaps are not deleted, since references and iterators to their entries are never invalidated.
+     *
+     * Insertions claiming a bucket of a submap after it started being frozen copy their entries by themselves,
+     * since the migration may have already visited that bucket (see Submap::freeze()).
+     */
+    void helpMigration(std::true_type) {
+
+        const std::size_t submapIndex = getFirstLiveSubmapIndex();
+        if (submapIndex >= getLastSubmapIndex()) {
+            return; // no frozen submap left
+        }
+
+        Submap& submap = *getSubmap(submapIndex);
+        if (!submap.freezing.load(std::memory_order_seq_cst)) {
+            return; // the handshake with concurrent insertions requires the submap to be (being) frozen
+        }
+
+        const std::size_t firstGroupIndex = submap.migrationCursor.fetch_add(MIGRATION_BATCH_NUM_GROUPS, std::memory_order_relaxed);
+
+        if (firstGroupIndex < submap.getNumGroups()) {
+
+            const std::size_t endGroupIndex = std::min(firstGroupIndex + MIGRATION_BATCH_NUM_GROUPS, submap.getNumGroups());
+
+            std::vector<std::size_t> deferredBuckets;
+            for (std::size_t index = firstGroupIndex * GROUP_SIZE; index < endGroupIndex * GROUP_SIZE; index++) {
+                if (migrateBucket(submap, index)) {
+                    deferredBuckets.push_back(index);
+                }
+            }
+
+            if (!deferredBuckets.empty()) {
+                std::lock_guard<std::mutex> lock(submap.deferredBucketsMutex);
+                submap.deferredBuckets.insert(submap.deferredBuckets.end(), deferredBuckets.begin(), deferredBuckets.end());
+            }
+
+            submap.numMigratedGroups.fetch_add(endGroupIndex - firstGroupIndex, std::memory_order_acq_rel);
+
+        }
+
+        if (submap.numMigratedGroups.load(std::memory_order_acquire) < submap.getNumGroups()) {
+            return; // other threads are still migrating their batches
+        }
+
+        std::unique_lock<std::mutex> lock(submap.deferredBucketsMutex, std::try_to_lock);
+        if (!lock.owns_lock() || getFirstLiveSubmapIndex() != submapIndex) {
+            return; // another thread is finishing the migration, or has finished it
+        }
+
+        std::vector<std::size_t> stillDeferredBuckets;
+        for (std::size_t index : submap.deferredBuckets) {
+            if (migrateBucket(submap, index)) {
+                stillDeferredBuckets.push_back(index);
+            }
+        }
+        submap.deferredBuckets.swap(stillDeferredBuckets);
+
+        if (submap.deferredBuckets.empty()) {
+            firstLiveSubmapIndex.store(submapIndex + 1, std::memory_order_release); // retire the submap
+            submap.bucketsMemory.markCold(); // only reachable through iterators from now on
+        }
+
+    }
+
+    void helpMigration(std::false_type) {
+    }
+
+    /**
+     * @brief Hashes the next batch of keys (at most `BATCH_SIZE`), prefetching the groups where their probing starts
+     * in a submap, so that the cache misses of the batch overlap
+     *
+     * @param firstKey  the first key of the batch
+     * @param lastKey   the end of the range of keys
+     * @param hashes1   filled with the first hashes of the keys
+     * @param hashes2   filled with the second hashes of the keys
+     * @param submap    the submap the keys are going to be probed in
+     *
+     * @return          the number of keys in the batch
+     */
+    template<typename ForwardIterator>
+    std::size_t hashBatch(ForwardIterator firstKey, ForwardIterator lastKey, std::size_t* hashes1, std::size_t* hashes2,
+                          const Submap& submap) const {
+        std::size_t batchSize = 0;
+        for (; firstKey != lastKey && batchSize < BATCH_SIZE; ++firstKey, batchSize++) {
+            hashes1[batchSize] = keyHash1(*firstKey);
+            hashes2[batchSize] = keyHash2(*firstKey);
+            submap.prefetchStartGroup(hashes1[batchSize]);
+        }
+        return batchSize;
+    }
+
+    /**
+     * @brief Searches for an entry having key equal to `key` across all the sumbaps in the range
+     * [firstSubmapIndex, lastSubmapIndex].
+     *
+     * @param key               the key of the entry to be found
+     * @param hash1             the first hash of the key
+     * @param hash2             the second hash of the key
+     * @param firstSubmapIndex  the index of the first submap in which the entry has to be searched for
+     * @param lastSubmapIndex   the index of the last submap in which the entry has to be searched for
+     * @param waitForComputing  if `true`, wait for the values being computed by other threads (see Submap::find())
+     * @param waited            set to `true` if the function waited for the computation of the value
+     *
+     * @return                  a @link const_iterator @endlink to an entry having key `key`, or a past-the-end
+     *                          const_iterator if no such entry is found
+     */
+    const_iterator findHelper(const Key& key, std::size_t hash1, std::size_t hash2, std::size_t firstSubmapIndex,
+                              std::size_t lastSubmapIndex, bool waitForComputing, bool& waited) const {
+
+        const std::pair<std::size_t, bool> findResult =
+                getSubmap(lastSubmapIndex)->find(key, hash1, hash2, waitForComputing, waited);
+        if (findResult.second) { // the entry was found
+            return const_iterator(this, lastSubmapIndex, findResult.first);
+        }
+
+        if (lastSubmapIndex == firstSubmapIndex) {
+            return end(); // the entry was not found
+        }
+
+        return findInOlderSubmaps(key, hash1, hash2, firstSubmapIndex, lastSubmapIndex, waitForComputing, waited);
+
+    }
+
+    /**
+     * @brief Searches for an entry having key equal to `key` across all the sumbaps in the range
+     * [firstSubmapIndex, submapIndex), skipping the submaps whose Bloom filter rules the key out
+     * (older submaps are frozen, see Submap::freeze()).
+     *
+     * @see findHelper()
+     */
+    const_iterator findInOlderSubmaps(const Key& key, std::size_t hash1, std::size_t hash2, std::size_t firstSubmapIndex,
+                                      std::size_t submapIndex, bool waitForComputing, bool& waited) const {
+
+        while (submapIndex-- > firstSubmapIndex) { // scan each submap (from the last to the first)
+            const Submap& submap = *getSubmap(submapIndex);
+            if (!submap.mayContain(hash1, hash2)) {
+                continue;
+            }
+            const std::pair<std::size_t, bool> findResult = submap.find(key, hash1, hash2, waitForComputing, waited);
+            if (findResult.second) { // the entry was found
+                return const_iterator(this, submapIndex, findResult.first);
+            }
+        }
+
+        return end(); // the entry was not found
+
+    }
+
+    /**
+     * @brief Inserts a new entry into the map. The key will be moved, if possible.
+     *
+     * The value is calculated as needed by calling the `computeValue` function or functor.
+     *
+     * @param key                    the key of the entry to be inserted
+     * @param hash1                  the first hash of the key
+     * @param hash2                  the second hash of the key
+     * @param computeValue           a function or functor that, given the key, calculates the corresponding value
+     * @param claimBeforeCompute     if `true`, the bucket is claimed before computing the value (see insertExclusive())
+     *
+     * @tparam ComputeValueFunction  function or functor implementing `Value operator()(const Key&)`
+     *
+     * @return                       a pair consisting of a @link const_iterator @endlink to the inserted entry (or to the entry
+     *                               that prevented the insertion) and a `bool` denoting whether the insertion took place
+     */
+    template<typename KeyType, typename ComputeValueFunction>
+    std::pair<const_iterator, bool> insertHelper(KeyType&& key, std::size_t hash1, std::size_t hash2, ComputeValueFunction computeValue,
+                                                 bool claimBeforeCompute = false) {
+
+        bool waited = false;
+
+        while (1) {
+
+            const std::size_t firstLiveSubmapIndex = getFirstLiveSubmapIndex();
+            const std::size_t lastSubmapIndex = getLastSubmapIndex();
+
+            // check if the map (excl. the last submap) already contains a value for the key
+            if (lastSubmapIndex > firstLiveSubmapIndex) {
+                helpMigration(MigrationEnabled());
+                const const_iterator findIterator = findInOlderSubmaps(key, hash1, hash2, firstLiveSubmapIndex, lastSubmapIndex,
+                                                                       claimBeforeCompute, waited);
+                if (findIterator != end()) { // the map already contains a value for the key
+                    if (waited) {
+                        incrementNumAvoidedComputations();
+                    }
+                    return std::make_pair(findIterator, false);
+                }
+            }
+
+            Submap& lastSubmap = *getSubmap(lastSubmapIndex);
+
+            if (lastSubmap.isNextSubmapDue() && prepareExpansion(lastSubmap, lastSubmapIndex)) { // the submap is overloaded
+                continue; // restart the insertion process
+            }
+
+            try {
+                bool insertedWhileFreezing = false;
+                const std::pair<std::size_t, bool> insertResult =
+                        lastSubmap.insert(std::forward<KeyType>(key), hash1, hash2, computeValue, claimBeforeCompute, waited,
+                                          insertedWhileFreezing);
+                if (insertResult.second) {
+                    if (insertedWhileFreezing) {
+                        // a newer submap has been created meanwhile, and the migration may have missed the entry
+                        migrateEntry(lastSubmap.getBucket(insertResult.first), hash1, hash2, MigrationEnabled());
+                    }
+                    if (entryLog != nullptr) {
+                        appendToEntryLogFunction(*entryLog, lastSubmap.getBucket(insertResult.first).getEntry());
+                    }
+                } else if (waited) {
+                    incrementNumAvoidedComputations();
+                }
+                const const_iterator insertIterator(this, lastSubmapIndex, insertResult.first);
+                return std::make_pair(insertIterator, insertResult.second);
+            } catch (typename Submap::FullSubmapException&) { // the submap is full
+                expand(); // expand the map
+                continue; // restart the insertion process
+            }
+
+        }
+
+    }
+
+    /**
+     * @brief Inserts a new entry into the map, resuming the probing where the search filling `hint` ended
+     * (see find(const Key&, InsertHint&)). The key will be moved, if possible.
+     *
+     * The probing can only resume if the map still consists of the same single live submap, otherwise
+     * the insertion falls back to insertHelper(), with the hashes of the hint.
+     *
+     * @param key                    the key of the entry to be inserted
+     * @param hint                   the outcome of the search for the key
+     * @param computeValue           a function or functor that, given the key, calculates the corresponding value
+     * @param claimBeforeCompute     if `true`, the bucket is claimed before computing the value (see insertExclusive())
+     *
+     * @tparam ComputeValueFunction  function or functor implementing `Value operator()(const Key&)`
+     *
+     * @return                       a pair consisting of a @link const_iterator @endlink to the inserted entry (or to the entry
+     *                               that prevented the insertion) and a `bool` denoting whether the insertion took place
+     */
+    template<typename KeyType, typename ComputeValueFunction>
+    std::pair<const_iterator, bool> insertWithHint(KeyType&& key, const InsertHint& hint, ComputeValueFunction computeValue,
+                                                   bool claimBeforeCompute) {
+
+        if (!hint.hashed) { // the hint is empty
+            const std::size_t hash1 = keyHash1(key);
+            const std::size_t hash2 = keyHash2(key);
+            return insertHelper(std::forward<KeyType>(key), hash1, hash2, computeValue, claimBeforeCompute);
+        }
+
+        const std::size_t lastSubmapIndex = getLastSubmapIndex();
+        Submap& lastSubmap = *getSubmap(lastSubmapIndex);
+
+        if (hint.submapIndex != lastSubmapIndex || getFirstLiveSubmapIndex() != lastSubmapIndex || lastSubmap.isNextSubmapDue()) {
+            return insertHelper(std::forward<KeyType>(key), hint.hash1, hint.hash2, computeValue, claimBeforeCompute);
+        }
+
+        try {
+            bool waited = false;
+            bool insertedWhileFreezing = false;
+            const std::pair<std::size_t, bool> insertResult =
+                    lastSubmap.insertFrom(std::forward<KeyType>(key), hint.hash1, hint.hash2, computeValue, claimBeforeCompute, waited,
+                                          insertedWhileFreezing, hint.groupIndex);
+            if (insertResult.second) {
+                if (insertedWhileFreezing) {
+                    // a newer submap has been created meanwhile, and the migration may have missed the entry
+                    migrateEntry(lastSubmap.getBucket(insertResult.first), hint.hash1, hint.hash2, MigrationEnabled());
+                }
+                if (entryLog != nullptr) {
+                    appendToEntryLogFunction(*entryLog, lastSubmap.getBucket(insertResult.first).getEntry());
+                }
+            } else if (waited) {
+                incrementNumAvoidedComputations();
+            }
+            const const_iterator insertIterator(this, lastSubmapIndex, insertResult.first);
+            return std::make_pair(insertIterator, insertResult.second);
+        } catch (typename Submap::FullSubmapException&) { // the submap is full
+            expand(); // expand the map
+            return insertHelper(std::forward<KeyType>(key), hint.hash1, hint.hash2, computeValue, claimBeforeCompute);
+        }
+
+    }
+
+public:
+
+    /**
+     * @brief Constructor
+     *
+     * @param estimatedNumEntries  an estimate of the number of entries this map will store
+     * @param maxLoadFactor        the maximum load factor of each submap:
+     *                             it should be a floating point number in the open interval (0, 1)
+     * @param maxNumSubmaps        the maximum number of submaps that can be created (at least 1):
+     *                             if this limit is exceeded, a `std::runtime_error` is thrown
+     * @param hugePages            the huge pages backing the submaps (see HugePages)
+     * @param spillDirectory       if not empty, the buckets of the submaps are backed by (unlinked) files created
+     *                             in this directory rather than by anonymous memory: the operating system keeps
+     *                             the recently used pages in memory, and the submaps that are no longer searched
+     *                             (or only searched past their Bloom filters) are the first to be evicted to the files.
+     *                             Only the buckets are spilled: the control bytes, the filters, the values stored
+     *                             out of line and the memory owned by keys and values stay in memory, so spilling
+     *                             pays off for small trivially copyable entries. Ignored without memory mappings
+     */
+    Fcmm(std::size_t estimatedNumEntries = 0,
+         float maxLoadFactor = DEFAULT_MAX_LOAD_FACTOR,
+         std::size_t maxNumSubmaps = DEFAULT_MAX_NUM_SUBMAPS,
+         HugePages hugePages = HugePages::NONE,
+         const std::string& spillDirectory = std::string()) :
+            maxLoadFactor(maxLoadFactor),
+            hugePages(hugePages),
+            spillDirectory(spillDirectory.empty() ? nullptr : new std::string(spillDirectory)),
+            numSubmaps(1),
+            firstLiveSubmapIndex(0),
+            maxNumSubmaps(maxNumSubmaps),
+            submaps(new std::atomic<Submap*>[maxNumSubmaps]),
+            entryLog(nullptr),
+            appendToEntryLogFunction(nullptr) {
+
+        for (std::size_t submapIndex = 0; submapIndex < maxNumSubmaps; submapIndex++) {
+            submaps[submapIndex].store(nullptr, std::memory_order_relaxed);
+        }
+
+        if (maxLoadFactor <= 0.0f || maxLoadFactor >= 1.0f) {
+            throw std::logic_error("Invalid maximum load factor");
+        }
+
+        if (maxNumSubmaps < 1) {
+            throw std::logic_error("Invalid maximum number of submaps");
+        }
+
+        // calculate the capacity of the first submap
+        const std::size_t firstSubmapCapacity = std::max(
+                    FIRST_SUBMAP_MIN_CAPACITY,
+                    (std::size_t) (FIRST_SUBMAP_CAPACITY_MULTIPLIER * estimatedNumEntries / maxLoadFactor));
+
+        // create the first submap
+        submaps[0].store(new Submap(firstSubmapCapacity, maxLoadFactor, hugePages, this->spillDirectory.get()), std::memory_order_release);
+
+    }
+
+    /**
+     * @brief Destructor
+     */
+    ~Fcmm() {
+        for (std::size_t submapIndex = 0; submapIndex < getMaxNumSubmaps(); submapIndex++) {
+            delete getSubmap(submapIndex); // including the submap allocated in advance, if any
+        }
+    }
+
+    /**
+     * @brief Searches for an entry having key equal to `key`
+     *
+     * @param key  the key of the entry to be found
+     *
+     * @return     an @link const_iterator @endlink to an entry having key `key`, or a past-the-end
+     *             const_iterator if no such entry is found
+     */
+    const_iterator find(const Key& key) const {
+        bool waited = false;
+        const std::size_t firstSubmapIndex = getFirstLiveSubmapIndex();
+        return findHelper(key, keyHash1(key), keyHash2(key), firstSubmapIndex, getLastSubmapIndex(), false, waited);
+    }
+
+    /**
+     * @brief Searches for an entry having key equal to `key`, filling a hint for inserting the key if no such entry is found
+     *
+     * The hint lets insert(const Key&, const InsertHint&, ComputeValueFunction) and
+     * insertExclusive(const Key&, const InsertHint&, ComputeValueFunction) skip hashing the key and resume the probing
+     * where the search ended.
+     *
+     * @param key   the key of the entry to be found
+     * @param hint  filled with the hashes of the key and the position where the search ended
+     *
+     * @return      an @link const_iterator @endlink to an entry having key `key`, or a past-the-end
+     *              const_iterator if no such entry is found
+     */
+    const_iterator find(const Key& key, InsertHint& hint) const {
+
+        bool waited = false;
+
+        hint.hashed = true;
+        hint.hash1 = keyHash1(key);
+        hint.hash2 = keyHash2(key);
+
+        const std::size_t firstSubmapIndex = getFirstLiveSubmapIndex();
+        const std::size_t lastSubmapIndex = getLastSubmapIndex();
+        hint.submapIndex = lastSubmapIndex;
+
+        const std::pair<std::size_t, bool> findResult =
+                getSubmap(lastSubmapIndex)->find(key, hint.hash1, hint.hash2, false, waited, &hint.groupIndex);
+        if (findResult.second) { // the entry was found
+            return const_iterator(this, lastSubmapIndex, findResult.first);
+        }
+
+        if (lastSubmapIndex == firstSubmapIndex) {
+            return end(); // the entry was not found
+        }
+
+        return findInOlderSubmaps(key, hint.hash1, hint.hash2, firstSubmapIndex, lastSubmapIndex, false, waited);
+
+    }
+
+    /**
+     * @brief Searches for the entries having keys equal to those in the range [firstKey, lastKey).
+     *
+     * The keys are hashed in batches, and the buckets where their probing starts are prefetched before any of them
+     * is probed: on maps much larger than the cache, this hides most of the memory latency of find().
+     *
+     * @param firstKey  the first key to be searched for
+     * @param lastKey   the end of the range of keys
+     * @param result    the output iterator receiving, for each key in order, a @link const_iterator @endlink to an entry
+     *                  having that key, or a past-the-end const_iterator if no such entry is found
+     *
+     * @return          the output iterator past the last written const_iterator
+     */
+    template<typename ForwardIterator, typename OutputIterator>
+    OutputIterator findMany(ForwardIterator firstKey, ForwardIterator lastKey, OutputIterator result) const {
+        std::size_t hashes1[BATCH_SIZE];
+        std::size_t hashes2[BATCH_SIZE];
+        while (firstKey != lastKey) {
+            const std::size_t firstSubmapIndex = getFirstLiveSubmapIndex();
+            const std::size_t lastSubmapIndex = getLastSubmapIndex();
+            const std::size_t batchSize = hashBatch(firstKey, lastKey, hashes1, hashes2, *getSubmap(lastSubmapIndex));
+            for (std::size_t i = 0; i < batchSize; i++, ++firstKey) {
+                bool waited = false;
+                *result = findHelper(*firstKey, hashes1[i], hashes2[i], firstSubmapIndex, lastSubmapIndex, false, waited);
+                ++result;
+            }
+        }
+        return result;
+    }
+
+    /**
+     * @brief Returns a const reference to the value of an entry having key equal to `key`.
+     * If no such entry exists, an exception of type `std::out_of_range` is thrown.
+     *
+     * @param key                the key of the entry to be found
+     * @throw std::out_of_range  thrown if no entry exists having key equal to `key`
+     */
+    const Value& at(const Key& key) const {
+        const const_iterator findIterator = find(key);
+        if (findIterator == end()) {
+            throw std::out_of_range("Entry not found");
+        }
+        return findIterator->second;
+    }
+
+    /**
      * @brief Returns a const reference to the value of an entry having key equal to `key`.
      * If no such entry exists, an exception of type `std::out_of_range` is thrown.
      *
-     * @param key                the key of the entry to be found
-     * @throw std::out_of_range  thrown if no entry exists having key equal to `key`
+     * @param key                the key of the entry to be found
+     * @throw std::out_of_range  thrown if no entry exists having key equal to `key`
+     */
+    const Value& operator[](const Key& key) const {
+        return at(key);
+    }
+
+    /**
+     * @brief Inserts a new entry into the map.
+     *
+     * The value is calculated as needed by calling the `computeValue` function or functor.
+     *
+     * @param key                    the key of the entry to be inserted
+     * @param computeValue           a function or functor that, given the key, calculates the corresponding value
+     *
+     * @tparam ComputeValueFunction  function or functor implementing `Value operator()(const Key&)`
+     *
+     * @return                       a pair consisting of a @link const_iterator @endlink to the inserted entry (or to the entry
+     *                               that prevented the insertion) and a `bool` denoting whether the insertion took place
+     */
+    template<typename ComputeValueFunction>
+    std::pair<const_iterator, bool> insert(const Key& key, ComputeValueFunction computeValue) {
+        return insertHelper(key, keyHash1(key), keyHash2(key), computeValue);
+    }
+
+    /**
+     * @brief Inserts a new entry into the map. The key will be moved, if possible.
+     *
+     * The value is calculated as needed by calling the `computeValue` function or functor.
+     *
+     * @param key                    the key of the entry to be inserted
+     * @param computeValue           a function or functor that, given the key, calculates the corresponding value
+     *
+     * @tparam ComputeValueFunction  function or functor implementing `Value operator()(const Key&)`
+     *
+     * @return                       a pair consisting of a @link const_iterator @endlink to the inserted entry (or to the entry
+     *                               that prevented the insertion) and a `bool` denoting whether the insertion took place
+     */
+    template<typename ComputeValueFunction>
+    std::pair<const_iterator, bool> insert(Key&& key, ComputeValueFunction computeValue) {
+        return insertHelper(std::move(key), keyHash1(key), keyHash2(key), computeValue);
+    }
+
+    /**
+     * @brief Inserts a new entry into the map, without hashing the key again and resuming the probing
+     * where the search for the key ended (see find(const Key&, InsertHint&)).
+     *
+     * @param key                    the key of the entry to be inserted
+     * @param hint                   a hint filled by find(const Key&, InsertHint&) on this map, for a key equal to `key`
+     * @param computeValue           a function or functor that, given the key, calculates the corresponding value
+     *
+     * @see insert(const Key&, ComputeValueFunction)
+     */
+    template<typename ComputeValueFunction>
+    std::pair<const_iterator, bool> insert(const Key& key, const InsertHint& hint, ComputeValueFunction computeValue) {
+        return insertWithHint(key, hint, computeValue, false);
+    }
+
+    /**
+     * @brief Inserts new entries into the map, with the keys in the range [firstKey, lastKey).
+     *
+     * The keys are hashed in batches, and the buckets where their probing starts are prefetched before any of them
+     * is inserted (see findMany()).
+     *
+     * @param firstKey               the first key of the entries to be inserted
+     * @param lastKey                the end of the range of keys
+     * @param computeValue           a function or functor that, given a key, calculates the corresponding value
+     * @param result                 the output iterator receiving, for each key in order, the pair returned by
+     *                               insert(const Key&, ComputeValueFunction)
+     *
+     * @tparam ComputeValueFunction  function or functor implementing `Value operator()(const Key&)`
+     *
+     * @return                       the output iterator past the last written pair
+     */
+    template<typename ForwardIterator, typename ComputeValueFunction, typename OutputIterator>
+    OutputIterator insertMany(ForwardIterator firstKey, ForwardIterator lastKey, ComputeValueFunction computeValue,
+                              OutputIterator result) {
+        std::size_t hashes1[BATCH_SIZE];
+        std::size_t hashes2[BATCH_SIZE];
+        while (firstKey != lastKey) {
+            const std::size_t batchSize = hashBatch(firstKey, lastKey, hashes1, hashes2, *getSubmap(getLastSubmapIndex()));
+            for (std::size_t i = 0; i < batchSize; i++, ++firstKey) {
+                const Key& key = *firstKey;
+                *result = insertHelper(key, hashes1[i], hashes2[i], computeValue);
+                ++result;
+            }
+        }
+        return result;
+    }
+
+    /**
+     * @brief Inserts a new entry into the map, claiming the bucket before computing the value.
+     *
+     * Unlike insert(const Key&, ComputeValueFunction), the key is published before the `computeValue` function or functor
+     * is called: other threads inserting an entry with the same key wait for the value instead of computing it again.
+     * Waiting is only needed for values that are being computed, therefore `computeValue` should not block.
+     * Duplicate computations remain possible (though rare) when they race with the expansion of the map.
+     *
+     * If `computeValue` throws an exception, the exception is propagated and the entry is not inserted.
+     *
+     * @param key                    the key of the entry to be inserted
+     * @param computeValue           a function or functor that, given the key, calculates the corresponding value
+     *
+     * @tparam ComputeValueFunction  function or functor implementing `Value operator()(const Key&)`
+     *
+     * @return                       a pair consisting of a @link const_iterator @endlink to the inserted entry (or to the entry
+     *                               that prevented the insertion) and a `bool` denoting whether the insertion took place
+     */
+    template<typename ComputeValueFunction>
+    std::pair<const_iterator, bool> insertExclusive(const Key& key, ComputeValueFunction computeValue) {
+        return insertHelper(key, keyHash1(key), keyHash2(key), computeValue, true);
+    }
+
+    /**
+     * @brief Inserts a new entry into the map, claiming the bucket before computing the value.
+     * The key will be moved, if possible.
+     *
+     * @see insertExclusive(const Key&, ComputeValueFunction)
+     */
+    template<typename ComputeValueFunction>
+    std::pair<const_iterator, bool> insertExclusive(Key&& key, ComputeValueFunction computeValue) {
+        return insertHelper(std::move(key), keyHash1(key), keyHash2(key), computeValue, true);
+    }
+
+    /**
+     * @brief Inserts a new entry into the map, claiming the bucket before computing the value,
+     * without hashing the key again and resuming the probing where the search for the key ended.
+     *
+     * @see insertExclusive(const Key&, ComputeValueFunction) and insert(const Key&, const InsertHint&, ComputeValueFunction)
+     */
+    template<typename ComputeValueFunction>
+    std::pair<const_iterator, bool> insertExclusive(const Key& key, const InsertHint& hint, ComputeValueFunction computeValue) {
+        return insertWithHint(key, hint, computeValue, true);
+    }
+
+    /**
+     * @brief Inserts a new entry into the map.
+     *
+     * @param entry  the entry to be inserted
+     *
+     * @return       a pair consisting of a @link const_iterator @endlink to the inserted entry (or to the entry
+     *               that prevented the insertion) and a `bool` denoting whether the insertion took place
+     *
+     * @see insert(const Key&, ComputeValueFunction)
+     */
+    std::pair<const_iterator, bool> insert(const Entry& entry) {
+        return insert(entry.first, [&entry](const Key&) -> const Value& { return entry.second; });
+    }
+
+    /**
+     * @brief Inserts a new entry into the map. The members of the entry will be moved, if possible.
+     *
+     * @param entry  the entry to be inserted
+     *
+     * @return       a pair consisting of a @link const_iterator @endlink to the inserted entry (or to the entry
+     *               that prevented the insertion) and a `bool` denoting whether the insertion took place
+     *
+     * @see insert(const Key&, ComputeValueFunction)
+     */
+    std::pair<const_iterator, bool> insert(Entry&& entry) {
+        return insert(std::move(entry.first), [&entry](const Key&) -> Value&& { return std::move(entry.second); });
+    }
+
+    /**
+     * @brief Inserts a new entry into the map. The new entry is constructed using `args` as the arguments
+     * for the entry's constructor.
+     *
+     * @param args  arguments used to construct a new entry (key, value)
+     *
+     * @return      a pair consisting of a @link const_iterator @endlink to the inserted entry (or to the entry
+     *              that prevented the insertion) and a `bool` denoting whether the insertion took place
+     *
+     * @see insert(const Key&, ComputeValueFunction)
+     */
+    template<typename... Args>
+    std::pair<const_iterator, bool> emplace(Args&&... args) {
+        return insert(Entry(std::forward<Args>(args)...));
+    }
+
+    /**
+     * @brief Returns the number of entries in the map (insertions do not update a shared counter: the number is
+     * calculated from the counters of the submaps, so avoid calling this function in hot paths)
+     */
+    std::size_t getNumEntries() const FCMM_NOEXCEPT {
+        const std::size_t numMigratedEntriesSnapshot = numMigratedEntries.get(); // read first, to avoid underestimating
+        std::size_t numValidBuckets = 0;
+        const std::size_t lastSubmapIndex = getLastSubmapIndex();
+        for (std::size_t submapIndex = 0; submapIndex <= lastSubmapIndex; submapIndex++) {
+            numValidBuckets += getSubmap(submapIndex)->getNumValidBuckets();
+        }
+        return numValidBuckets > numMigratedEntriesSnapshot ? numValidBuckets - numMigratedEntriesSnapshot : 0;
+    }
+
+    /**
+     * @brief Alias for getNumEntries()
+     */
+    std::size_t size() const FCMM_NOEXCEPT {
+        return getNumEntries();
+    }
+
+    /**
+     * @brief Returns `true` if the map has no elements, `false` otherwise
+     */
+    bool empty() const FCMM_NOEXCEPT {
+        return getNumEntries() == 0;
+    }
+
+    /**
+     * @brief Returns a @link const_iterator @endlink pointing to the first entry
+     */
+    const_iterator begin() const FCMM_NOEXCEPT {
+        return const_iterator(this);
+    }
+
+    /**
+     * @brief Returns a @link const_iterator @endlink pointing to the first entry
+     */
+    const_iterator cbegin() const FCMM_NOEXCEPT {
+        return begin();
+    }
+
+    /**
+     * @brief Returns a @link const_iterator @endlink pointing to the past-the-end entry
+     */
+    const_iterator end() const FCMM_NOEXCEPT {
+        return const_iterator(this, true);
+    }
+
+    /**
+     * @brief Returns a @link const_iterator @endlink pointing to the past-the-end entry
+     */
+    const_iterator cend() const FCMM_NOEXCEPT {
+        return end();
+    }
+
+    /**
+     * @brief Returns a pointer to a new map containing all the entries currently present in this map for
+     * which `filterFunction(entry)` returns `true`.
+     *
+     * The new map is created via `new`, with the same settings as this map, and it is responsibility of the caller
+     * to `delete` it.
+     *
+     * @param filterFunction   a function or functor that, given an entry, returns `true` if
+     *                         it should be kept, `false` if it should be filtered out
+     *
+     * @tparam FilterFunction  function or functor implementing `bool operator()(const Entry&)`
+     *
+     * @return                 the filtered map
+     */
+    template<typename FilterFunction>
+    Fcmm* filter(FilterFunction filterFunction) const {
+
+        Fcmm* map = new Fcmm(getNumEntries(), maxLoadFactor, getMaxNumSubmaps(), hugePages,
+                             spillDirectory ? *spillDirectory : std::string());
+
+        for (const_iterator it = begin(); it != end(); ++it) {
+            const Entry& entry = *it;
+            if (filterFunction(entry)) {
+                const Bucket& bucket = it.getBucket();
+                map->insertHelper(entry.first, bucket.getHash1(entry.first, keyHash1), bucket.getHash2(entry.first, keyHash2),
+                                  [&entry](const Key&) -> const Value& { return entry.second; });
+            }
+        }
+
+        return map;
+
+    }
+
+    /**
+     * @brief Returns a pointer to a new map containing all the entries currently present in this map.
+     *
+     * Actually, the number of entries in the cloned map can be lower than the number of entries in this map,
+     * since duplicate entries (i.e. entries having the same key) are stripped out by the clone operation.
+     *
+     * The new map is created via `new` and it is responsibility of the caller to `delete` it.
+     */
+
+    Fcmm* clone() const {
+        return filter([](const Entry&) { return true; });
+    }
+
+    /**
+     * @brief Saves the entries of the map to a snapshot file, which can be mapped into memory and searched
+     * without being parsed (see Snapshot). Keys and values are converted to bytes by Serializer<Key> and Serializer<Value>.
+     *
+     * The file is written under a temporary name, then renamed: an existing snapshot with the same name is
+     * replaced only once the new one is complete. Entries inserted concurrently may or may not be saved.
+     * Duplicate entries (see the description of this class) are saved once.
+     *
+     * The index of the snapshot is built with `KeyHash1`, which must therefore yield the same hashes
+     * in the process loading the snapshot.
+     *
+     * @param filename  the name of the file
+     *
+     * @throw std::runtime_error  thrown if the file cannot be written
+     */
+    void saveSnapshot(const std::string& filename) const {
+
+        std::vector<const Entry*> entries;
+        entries.reserve(size());
+        for (const Entry& entry : *this) {
+            entries.push_back(&entry);
+        }
+
+        // build the index, skipping duplicate keys
+        std::uint64_t numSlots = 1;
+        while (numSlots < std::max((std::size_t) 1, entries.size() * SNAPSHOT_SLOTS_PER_ENTRY)) {
+            numSlots *= 2;
+        }
+        std::vector<SnapshotSlot> slots(numSlots, SnapshotSlot());
+        std::vector<const Entry*> slotEntries(numSlots, nullptr);
+        KeyEqual keyEqual;
+        std::uint64_t numEntries = 0;
+        for (const Entry* entry : entries) {
+            const std::uint64_t hash1 = keyHash1(entry->first);
+            std::size_t slot = calculateSnapshotStartSlot(hash1, numSlots);
+            while (slotEntries[slot] != nullptr &&
+                    !(slots[slot].hash1 == hash1 && keyEqual(slotEntries[slot]->first, entry->first))) {
+                slot = (slot + 1) & (numSlots - 1);
+            }
+            if (slotEntries[slot] == nullptr) {
+                slots[slot].hash1 = hash1;
+                slotEntries[slot] = entry;
+                numEntries++;
+            }
+        }
+
+        const std::string temporaryFilename = filename + ".tmp";
+        std::ofstream file(temporaryFilename, std::ios::binary | std::ios::trunc);
+
+        // the header and the index are written last, once the offsets of the records are known
+        const std::uint64_t indexOffset = alignSnapshotOffset(sizeof(SnapshotHeader));
+        std::uint64_t offset = indexOffset + numSlots * sizeof(SnapshotSlot);
+        file.seekp((std::streamoff) offset);
+
+        std::string bytes;
+        for (std::size_t slot = 0; slot < numSlots && file; slot++) {
+            const Entry* entry = slotEntries[slot];
+            if (entry == nullptr) {
+                continue;
+            }
+            bytes.assign(2 * sizeof(std::uint32_t), '\0');
+            Serializer<Key>::serialize(entry->first, bytes);
+            const std::size_t keySize = bytes.size() - 2 * sizeof(std::uint32_t);
+            Serializer<Value>::serialize(entry->second, bytes);
+            const std::size_t valueSize = bytes.size() - 2 * sizeof(std::uint32_t) - keySize;
+            if (keySize > UINT32_MAX || valueSize > UINT32_MAX) {
+                file.close();
+                std::remove(temporaryFilename.c_str());
+                throw std::runtime_error("Cannot save a snapshot: an entry is too large");
+            }
+            const std::uint32_t sizes[2] = { (std::uint32_t) keySize, (std::uint32_t) valueSize };
+            std::memcpy(&bytes[0], sizes, sizeof(sizes));
+            bytes.resize(alignSnapshotOffset(bytes.size()), '\0');
+            file.write(bytes.data(), (std::streamsize) bytes.size());
+            slots[slot].recordOffset = offset;
+            offset += bytes.size();
+        }
+
+        SnapshotHeader header;
+        std::memcpy(header.magic, "FCMMSNAP", sizeof(header.magic));
+        header.version = SNAPSHOT_VERSION;
+        header.byteOrderMark = SNAPSHOT_BYTE_ORDER_MARK;
+        header.numEntries = numEntries;
+        header.numSlots = numSlots;
+        header.fileSize = offset;
+
+        file.seekp(0);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.seekp((std::streamoff) indexOffset);
+        file.write(reinterpret_cast<const char*>(slots.data()), (std::streamsize) (numSlots * sizeof(SnapshotSlot)));
+        file.close();
+
+        if (!file || std::rename(temporaryFilename.c_str(), filename.c_str()) != 0) {
+            std::remove(temporaryFilename.c_str());
+            throw std::runtime_error("Cannot write the snapshot file: " + filename);
+        }
+
+    }
+
+    /**
+     * @brief Makes the entries inserted into the map from now on be appended to `log` (see EntryLog), or stops
+     * logging if `log` is `nullptr`. Keys and values are converted to bytes by Serializer<Key> and Serializer<Value>.
+     *
+     * The entry is appended by the inserting thread, once inserted; the copies made by the expansion of the map
+     * are not logged. It must not be called concurrently with insertions, and the log must outlive the map
+     * (or be detached first).
+     */
+    void setEntryLog(EntryLog* log) {
+        entryLog = log;
+        appendToEntryLogFunction = &appendToEntryLog;
+    }
+
+    /**
+     * @brief Inserts the entries of an entry log file into the map (see EntryLog::replay()).
+     * It should be called before attaching a log (see setEntryLog()), otherwise the entries are logged again.
+     *
+     * @param filename  the name of the file
+     *
+     * @return          the number of entries read from the log (zero if the file does not exist)
+     *
+     * @throw std::runtime_error  thrown if the file is not a valid entry log
+     */
+    std::size_t replayEntryLog(const std::string& filename) {
+        return EntryLog::replay<Key, Value>(filename, [this](Key&& key, Value&& value) {
+            insert(std::move(key), [&value](const Key&) -> Value&& { return std::move(value); });
+        });
+    }
+
+    /**
+     * @brief Returns statistics about this @link Fcmm @endlink instance.
+     *
+     * The information returned by this method is useful for debugging and benchmarking.
+     *
+     * @see Stats
+     */
+    Stats getStats() const {
+
+        Stats stats;
+
+        stats.numEntries = getNumEntries();
+        stats.numSubmaps = getNumSubmaps();
+        stats.numRetiredSubmaps = getFirstLiveSubmapIndex();
+        stats.numAvoidedComputations = numAvoidedComputations.get();
+        stats.numSkippedSubmapProbes = 0;
+        for (std::size_t submapIndex = 0; submapIndex < stats.numSubmaps; submapIndex++) {
+            const Submap& submap = *getSubmap(submapIndex);
+            stats.submapsStats.push_back(submap.getStats());
+            stats.numSkippedSubmapProbes += stats.submapsStats.back().numSkippedProbes;
+        }
+
+        return stats;
+
+    }
+
+    /**
+     * @brief A const <a href="http://en.cppreference.com/w/cpp/concept/InputIterator">input iterator</a>
+     * for iterating over the map. Iterators are never invalidated.
+     */
+    class const_iterator : public std::iterator<std::input_iterator_tag, const Entry> {
+
+        friend class Fcmm;
+
+    private:
+
+        /**
+         * @brief The @link Fcmm @endlink instance this iterator is iterating over
+         */
+        const Fcmm* map;
+
+        /**
+         * @brief The index of the submap containing the bucket currently pointed by this iterator
+         */
+        std::size_t submapIndex;
+
+        /**
+         * @brief The index of the bucket currently pointed by this iterator
+         */
+        std::size_t bucketIndex;
+
+        /**
+         * @brief This boolean is `true` if the iterator is pointing to the past-the-end entry of the map,
+         * `false` otherwise
+         */
+        bool end;
+
+        /**
+         * @brief Returns the submap containing the bucket currently pointed by this iterator
+         */
+        const Submap& getSubmap() const {
+            return *map->getSubmap(submapIndex);
+        }
+
+        /**
+         * @brief Returns the bucket currently pointed by this iterator
+         */
+        const Bucket& getBucket() const {
+            return getSubmap().getBucket(bucketIndex);
+        }
+
+        /**
+         * @brief Returns the entry currently pointed by this iterator
+         */
+        const Entry& getEntry() const {
+            return getBucket().getEntry();
+        }
+
+        /**
+         * @brief Returns `true` if the entry currently pointed by this iterator has been migrated to a newer submap
+         * (the copy will be visited instead)
+         */
+        bool isMigrated() const {
+            const std::size_t lastSubmapIndex = map->getLastSubmapIndex();
+            if (submapIndex == lastSubmapIndex) {
+                return false;
+            }
+            const Bucket& bucket = getBucket();
+            const Key& key = bucket.getEntry().first;
+            bool waited = false;
+            return map->findInOlderSubmaps(key, bucket.getHash1(key, map->keyHash1), bucket.getHash2(key, map->keyHash2),
+                                           submapIndex + 1, lastSubmapIndex + 1, false, waited) != map->end();
+        }
+
+        /**
+         * @brief Seeks the next valid bucket starting from `bucketIndex` (inclusive)
+         */
+        void seek() {
+
+            while (!end) {
+
+                if (getSubmap().seek(bucketIndex)) { // side-effect on bucketIndex
+                    if (!isMigrated()) {
+                        return;
+                    }
+                    bucketIndex++;
+                } else {
+                    submapIndex++;
+                    bucketIndex = 0;
+                    if (submapIndex > map->getLastSubmapIndex()) {
+                        end = true;
+                        submapIndex = 0;
+                    }
+                }
+
+            }
+
+        }
+
+        /**
+         * @brief Increments `bucketIndex` and seeks the next valid bucket starting
+         * from `bucketIndex` (inclusive)
+         */
+        void next() {
+            bucketIndex++;
+            seek();
+        }
+
+        /**
+         * @brief Constructs a const iterator for a @link Fcmm @endlink instance
+         *
+         * @param map  the @link Fcmm @endlink instance the iterator shall iterate over
+         * @param end  `true` if the iterator shall point to the past-the-end entry, `false` otherwise
+         */
+        const_iterator(const Fcmm* map, bool end = false) :
+                map(map),
+                submapIndex(end ? 0 : map->getFirstLiveSubmapIndex()),
+                bucketIndex(0),
+                end(end) {
+            if (!end) {
+                seek();
+            }
+        }
+
+        /**
+         * @brief Constructs a const iterator for a @link Fcmm @endlink instance
+         *
+         * @param map          the @link Fcmm @endlink instance the iterator shall iterate over
+         * @param submapIndex  the index of the submap containing the bucket the iterator shall point to
+         * @param bucketIndex  the index of the bucket the iterator shall point to
+         */
+        const_iterator(const Fcmm* map, std::size_t submapIndex, std::size_t bucketIndex) :
+                map(map),
+                submapIndex(submapIndex),
+                bucketIndex(bucketIndex),
+                end(false) {
+        }
+
+    public:
+
+        /**
+         * @brief Default constructor. The resulting iterator is invalid and should not be used.
+         */
+        const_iterator() : map(NULL), submapIndex(0), bucketIndex(0), end(true) {
+        }
+
+        /**
+         * @brief Equality operator
+         */
+        bool operator==(const const_iterator& other) const {
+            return map == other.map &&
+                    ((end && other.end) || (!end && !other.end && submapIndex == other.submapIndex && bucketIndex == other.bucketIndex));
+        }
+
+        /**
+         * @brief Inequality operator
+         */
+        bool operator!=(const const_iterator& other) const {
+            return !(*this == other);
+        }
+
+        /**
+         * @brief Pre-increment operator
+         */
+        const_iterator& operator++(void) {
+            next();
+            return *this;
+        }
+
+        /**
+         * @brief Post-increment operator
+         */
+        const_iterator operator++(/* dummy */ int) {
+            const_iterator old(*this);
+            ++(*this);
+            return old;
+        }
+
+        /**
+         * @brief Dereference operator
+         */
+        const Entry& operator*() const {
+            return getEntry();
+        }
+
+        /**
+         * @brief Arrow operator
+         */
+        const Entry* operator->() const {
+            return &getEntry();
+        }
+
+    };
+
+    /**
+     * @brief The object is not copy-constructible: use clone() instead
+     */
+    Fcmm(const Fcmm&) = delete;
+
+    /**
+     * @brief The object cannot be moved
+     */
+    Fcmm(Fcmm&&) = delete;
+
+};
+
+/**
+ * @brief A read-only view of a snapshot file saved by Fcmm::saveSnapshot().
+ *
+ * The file is mapped into memory (on POSIX systems; elsewhere, it is read): a search probes the index of the snapshot
+ * and converts the bytes of the value found back into a value (see Serializer), without loading the rest of the file.
+ * Searches may be carried out by many threads at once.
+ *
+ * @tparam  Key       the type of the key in each entry
+ * @tparam  Value     the type of the value in each entry
+ * @tparam  KeyHash1  the type of the function object that calculates the first hash of the key:
+ *                    it must be the `KeyHash1` of the map that saved the snapshot
+ * @tparam  KeyEqual  the type of the function object that checks the equality of the two keys
+ */
+template<
+    typename Key,
+    typename Value,
+    typename KeyHash1 = std::hash<Key>,
+    typename KeyEqual = std::equal_to<Key>
+>
+class Snapshot {
+
+private:
+
+    KeyHash1 keyHash1;
+    KeyEqual keyEqual;
+
+    /**
+     * @brief The contents of the file
+     */
+    const char* contents;
+    std::size_t contentsSize;
+
+#ifdef FCMM_MMAP
+    void* mapping;
+#else
+    std::unique_ptr<char[]> buffer;
+#endif
+
+    SnapshotHeader header;
+    std::size_t indexOffset;
+
+    SnapshotSlot getSlot(std::size_t slot) const FCMM_NOEXCEPT {
+        SnapshotSlot result;
+        std::memcpy(&result, contents + indexOffset + slot * sizeof(SnapshotSlot), sizeof(SnapshotSlot));
+        return result;
+    }
+
+    /**
+     * @brief Reads the sizes of the key and of the value of a record, checking that the record lies within the file
+     *
+     * @return a pointer to the bytes of the key, followed by the bytes of the value
+     */
+    const char* readRecord(std::uint64_t recordOffset, std::uint32_t& keySize, std::uint32_t& valueSize) const {
+        std::uint32_t sizes[2];
+        if (recordOffset > contentsSize || contentsSize - recordOffset < sizeof(sizes)) {
+            throw std::runtime_error("Corrupted snapshot: record out of bounds");
+        }
+        std::memcpy(sizes, contents + recordOffset, sizeof(sizes));
+        keySize = sizes[0];
+        valueSize = sizes[1];
+        if (contentsSize - recordOffset - sizeof(sizes) < (std::uint64_t) keySize + valueSize) {
+            throw std::runtime_error("Corrupted snapshot: record out of bounds");
+        }
+        return contents + recordOffset + sizeof(sizes);
+    }
+
+    /**
+     * @brief Searches for the record of the entry having key equal to `key`
+     *
+     * @param valueSize  set to the size of the value, if found
+     *
+     * @return           a pointer to the bytes of the value, or `nullptr` if no such entry exists
+     */
+    const char* findValueBytes(const Key& key, std::uint32_t& valueSize) const {
+
+        const std::uint64_t hash1 = keyHash1(key);
+        std::size_t slot = calculateSnapshotStartSlot(hash1, header.numSlots);
+
+        for (std::uint64_t numProbedSlots = 0; numProbedSlots < header.numSlots; numProbedSlots++) {
+
+            const SnapshotSlot snapshotSlot = getSlot(slot);
+            if (snapshotSlot.recordOffset == 0) {
+                return nullptr; // empty slot
+            }
+
+            if (snapshotSlot.hash1 == hash1) {
+                std::uint32_t keySize;
+                const char* keyBytes = readRecord(snapshotSlot.recordOffset, keySize, valueSize);
+                if (keyEqual(Serializer<Key>::deserialize(keyBytes, keySize), key)) {
+                    return keyBytes + keySize;
+                }
+            }
+
+            slot = (slot + 1) & (header.numSlots - 1);
+
+        }
+
+        return nullptr;
+
+    }
+
+public:
+
+    /**
+     * @brief Constructor: maps the snapshot file into memory
+     *
+     * @param filename  the name of the file
+     *
+     * @throw std::runtime_error  thrown if the file cannot be read, or is not a valid snapshot
+     */
+    explicit Snapshot(const std::string& filename) : contents(nullptr), contentsSize(0) {
+
+#ifdef FCMM_MMAP
+        mapping = nullptr;
+        const int fd = open(filename.c_str(), O_RDONLY);
+        struct stat fileStat;
+        if (fd < 0 || fstat(fd, &fileStat) != 0) {
+            if (fd >= 0) {
+                close(fd);
+            }
+            throw std::runtime_error("Cannot open the snapshot file: " + filename);
+        }
+        contentsSize = (std::size_t) fileStat.st_size;
+        if (contentsSize != 0) {
+            mapping = mmap(nullptr, contentsSize, PROT_READ, MAP_SHARED, fd, 0);
+        }
+        close(fd);
+        if (mapping == MAP_FAILED) {
+            mapping = nullptr;
+            throw std::runtime_error("Cannot map the snapshot file: " + filename);
+        }
+        contents = static_cast<const char*>(mapping);
+#else
+        std::ifstream file(filename, std::ios::binary | std::ios::ate);
+        if (!file) {
+            throw std::runtime_error("Cannot open the snapshot file: " + filename);
+        }
+        contentsSize = (std::size_t) file.tellg();
+        buffer.reset(new char[contentsSize]);
+        file.seekg(0);
+        if (!file.read(buffer.get(), (std::streamsize) contentsSize)) {
+            throw std::runtime_error("Cannot read the snapshot file: " + filename);
+        }
+        contents = buffer.get();
+#endif
+
+        indexOffset = (std::size_t) alignSnapshotOffset(sizeof(SnapshotHeader));
+        bool valid = contentsSize >= sizeof(SnapshotHeader);
+        if (valid) {
+            std::memcpy(&header, contents, sizeof(SnapshotHeader));
+            valid = std::memcmp(header.magic, "FCMMSNAP", sizeof(header.magic)) == 0 && header.version == SNAPSHOT_VERSION &&
+                    header.byteOrderMark == SNAPSHOT_BYTE_ORDER_MARK && header.fileSize == contentsSize &&
+                    header.numSlots != 0 && (header.numSlots & (header.numSlots - 1)) == 0 &&
+                    header.numSlots <= (contentsSize - indexOffset) / sizeof(SnapshotSlot);
+        }
+        if (!valid) {
+#ifdef FCMM_MMAP
+            if (mapping != nullptr) {
+                munmap(mapping, contentsSize);
+            }
+#endif
+            throw std::runtime_error("Not a valid snapshot file: " + filename);
+        }
+
+    }
+
+    /**
+     * @brief Destructor: unmaps the snapshot file
      */
-    const Value& operator[](const Key& key) const {
-        return at(key);
+    ~Snapshot() {
+#ifdef FCMM_MMAP
+        if (mapping != nullptr) {
+            munmap(mapping, contentsSize);
+        }
+#endif
     }
 
     /**
-     * @brief Inserts a new entry into the map.
-     *
-     * The value is calculated as needed by calling the `computeValue` function or functor.
-     *
-     * @param key                    the key of the entry to be inserted
-     * @param computeValue           a function or functor that, given the key, calculates the corresponding value
-     *
-     * @tparam ComputeValueFunction  function or functor implementing `Value operator()(const Key&)`
-     *
-     * @return                       a pair consisting of a @link const_iterator @endlink to the inserted entry (or to the entry
-     *                               that prevented the insertion) and a `bool` denoting whether the insertion took place
+     * @brief Returns the number of entries in the snapshot
      */
-    template<typename ComputeValueFunction>
-    std::pair<const_iterator, bool> insert(const Key& key, ComputeValueFunction computeValue) {
-        return insertHelper(key, keyHash1(key), keyHash2(key), computeValue);
+    std::size_t size() const FCMM_NOEXCEPT {
+        return (std::size_t) header.numEntries;
     }
 
     /**
-     * @brief Inserts a new entry into the map. The key will be moved, if possible.
-     *
-     * The value is calculated as needed by calling the `computeValue` function or functor.
-     *
-     * @param key                    the key of the entry to be inserted
-     * @param computeValue           a function or functor that, given the key, calculates the corresponding value
-     *
-     * @tparam ComputeValueFunction  function or functor implementing `Value operator()(const Key&)`
-     *
-     * @return                       a pair consisting of a @link const_iterator @endlink to the inserted entry (or to the entry
-     *                               that prevented the insertion) and a `bool` denoting whether the insertion took place
+     * @brief Returns `true` if the snapshot contains an entry having key equal to `key`
      */
-    template<typename ComputeValueFunction>
-    std::pair<const_iterator, bool> insert(Key&& key, ComputeValueFunction computeValue) {
-        return insertHelper(std::move(key), keyHash1(key), keyHash2(key), computeValue);
+    bool contains(const Key& key) const {
+        std::uint32_t valueSize;
+        return findValueBytes(key, valueSize) != nullptr;
     }
 
     /**
-     * @brief Inserts a new entry into the map.
-     *
-     * @param entry  the entry to be inserted
+     * @brief Searches for an entry having key equal to `key`, assigning its value to `value` if found
      *
-     * @return       a pair consisting of a @link const_iterator @endlink to the inserted entry (or to the entry
-     *               that prevented the insertion) and a `bool` denoting whether the insertion took place
-     *
-     * @see insert(const Key&, ComputeValueFunction)
+     * @return  `true` if the entry was found, `false` otherwise
      */
-    std::pair<const_iterator, bool> insert(const Entry& entry) {
-        return insert(entry.first, [&entry](const Key&) -> const Value& { return entry.second; });
+    bool find(const Key& key, Value& value) const {
+        std::uint32_t valueSize;
+        const char* valueBytes = findValueBytes(key, valueSize);
+        if (valueBytes == nullptr) {
+            return false;
+        }
+        value = Serializer<Value>::deserialize(valueBytes, valueSize);
+        return true;
     }
 
     /**
-     * @brief Inserts a new entry into the map. The members of the entry will be moved, if possible.
-     *
-     * @param entry  the entry to be inserted
-     *
-     * @return       a pair consisting of a @link const_iterator @endlink to the inserted entry (or to the entry
-     *               that prevented the insertion) and a `bool` denoting whether the insertion took place
-     *
-     * @see insert(const Key&, ComputeValueFunction)
+     * @brief Returns the value of an entry having key equal to `key`.
+     * If no such entry exists, an exception of type `std::out_of_range` is thrown.
      */
-    std::pair<const_iterator, bool> insert(Entry&& entry) {
-        return insert(std::move(entry.first), [&entry](const Key&) -> Value&& { return std::move(entry.second); });
+    Value at(const Key& key) const {
+        std::uint32_t valueSize;
+        const char* valueBytes = findValueBytes(key, valueSize);
+        if (valueBytes == nullptr) {
+            throw std::out_of_range("Entry not found");
+        }
+        return Serializer<Value>::deserialize(valueBytes, valueSize);
     }
 
     /**
-     * @brief Inserts a new entry into the map. The new entry is constructed using `args` as the arguments
-     * for the entry's constructor.
-     *
-     * @param args  arguments used to construct a new entry (key, value)
-     *
-     * @return      a pair consisting of a @link const_iterator @endlink to the inserted entry (or to the entry
-     *              that prevented the insertion) and a `bool` denoting whether the insertion took place
-     *
-     * @see insert(const Key&, ComputeValueFunction)
+     * @brief Calls `function(key, value)` for each entry of the snapshot (e.g. to insert all of them into a map)
      */
-    template<typename... Args>
-    std::pair<const_iterator, bool> emplace(Args&&... args) {
-        return insert(Entry(std::forward<Args>(args)...));
+    template<typename Function>
+    void forEach(Function function) const {
+        for (std::size_t slot = 0; slot < header.numSlots; slot++) {
+            const SnapshotSlot snapshotSlot = getSlot(slot);
+            if (snapshotSlot.recordOffset != 0) {
+                std::uint32_t keySize;
+                std::uint32_t valueSize;
+                const char* keyBytes = readRecord(snapshotSlot.recordOffset, keySize, valueSize);
+                function(Serializer<Key>::deserialize(keyBytes, keySize), Serializer<Value>::deserialize(keyBytes + keySize, valueSize));
+            }
+        }
     }
 
+    Snapshot(const Snapshot&) = delete;
+    Snapshot& operator=(const Snapshot&) = delete;
+
+};
+
+#ifdef FCMM_MMAP
+
+namespace {
+
+/**
+ * @brief Version of the layout of the shared-memory regions of SharedFcmm
+ */
+const std::uint32_t SHARED_MAP_VERSION = 1;
+
+/**
+ * @brief Maximum number of submaps of a SharedFcmm
+ */
+const std::size_t SHARED_MAP_MAX_NUM_SUBMAPS = 16;
+
+/**
+ * @brief Default size (in bytes) of the shared-memory region of a SharedFcmm: only the submaps in use are backed by memory
+ */
+const std::size_t DEFAULT_SHARED_REGION_SIZE = (std::size_t) 1 << 30;
+
+/**
+ * @brief Time (in seconds) a SharedFcmm waits for another process to finish initializing a region
+ */
+const int SHARED_MAP_OPEN_TIMEOUT = 10;
+
+/**
+ * @brief Rounds `offset` up to a multiple of `CACHE_LINE_SIZE` (the alignment of the parts of a shared-memory region)
+ */
+inline std::uint64_t alignSharedOffset(std::uint64_t offset) FCMM_NOEXCEPT {
+    return (offset + CACHE_LINE_SIZE - 1) & ~(std::uint64_t) (CACHE_LINE_SIZE - 1);
+}
+
+} // unnamed namespace
+
+/**
+ * @brief A variant of @link Fcmm @endlink living in a named POSIX shared-memory region, so that separate processes
+ * can find and insert entries in the same map: an entry inserted by a process is found by all the others, without
+ * copying it or exchanging messages. Many threads of each process may access the map at once.
+ *
+ * The region starts with a header describing the map, followed by the submaps. Each process maps the region
+ * at a different address, so the header locates the submaps by their offsets from the beginning of the region.
+ * The submaps are planned when the region is created (each one `NEW_SUBMAPS_CAPACITY_MULTIPLIER` times as large as
+ * the previous one, as long as it fits into the region), and each one is allocated once the previous one reaches
+ * the maximum load factor. Entries are not migrated: insertions go into the last submap, and searches probe the
+ * submaps from the last one to the first one. The buckets share the control byte protocol of Fcmm (see Control).
+ *
+ * Keys and values are stored in the region as they are: they must be trivially copyable, must not point outside
+ * of the region, and all the processes must use the same types and hash functions (the sizes of keys and values
+ * are checked when the region is opened). A process that dies while writing an entry leaves its bucket busy,
+ * which only wastes the bucket. The region outlives the processes until it is removed (see remove()).
+ *
+ * @tparam  Key       the type of the key in each entry (trivially copyable)
+ * @tparam  Value     the type of the value in each entry (trivially copyable)
+ * @tparam  KeyHash1  the type of a function object that calculates the hash of the key
+ * @tparam  KeyHash2  the type of another function object that calculates the hash of the key
+ * @tparam  KeyEqual  the type of the function object that checks the equality of the two keys
+ */
+template<
+    typename Key,
+    typename Value,
+    typename KeyHash1 = std::hash<Key>,
+    typename KeyHash2 = DefaultKeyHash2<Key>,
+    typename KeyEqual = std::equal_to<Key>
+>
+class SharedFcmm {
+
+    static_assert(std::is_trivially_copyable<Key>::value && std::is_trivially_copyable<Value>::value,
+                  "The keys and the values of a SharedFcmm must be trivially copyable");
+
+    static_assert(ATOMIC_CHAR_LOCK_FREE == 2 && ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_POINTER_LOCK_FREE == 2,
+                  "A SharedFcmm requires lock-free atomic variables, which are shared by the processes");
+
+private:
+
+    struct Bucket {
+        Key key;
+        Value value;
+    };
+
+    static_assert(alignof(Bucket) <= CACHE_LINE_SIZE, "The buckets of a SharedFcmm must fit the alignment of the region");
+
     /**
-     * @brief Returns the number of entries in the map
+     * @brief Where a submap lies in the region (offsets from the beginning of the region), and how full it is
      */
-    std::size_t getNumEntries() const FCMM_NOEXCEPT {
-        return numEntries.load(std::memory_order_relaxed);
+    struct SubmapDescriptor {
+        std::uint64_t controlsOffset;
+        std::uint64_t bucketsOffset;
+        std::uint64_t endOffset;
+        std::uint64_t numGroups;
+        StripedCounter numValidBuckets;
+    };
+
+    /**
+     * @brief The header at the beginning of the region
+     */
+    struct Header {
+        char magic[8]; // the characters FCMMSHRD
+        std::uint32_t version;
+        std::uint32_t numPlannedSubmaps;
+        std::uint64_t regionSize;
+        std::uint64_t keySize;
+        std::uint64_t valueSize;
+        std::uint64_t bucketSize;
+        float maxLoadFactor;
+        std::atomic<std::uint32_t> initialized; // set once the creator of the region has written the header
+        std::atomic<std::uint64_t> numSubmaps; // the submaps allocated so far
+        SubmapDescriptor submaps[SHARED_MAP_MAX_NUM_SUBMAPS];
+    };
+
+    KeyHash1 keyHash1;
+    KeyHash2 keyHash2;
+    KeyEqual keyEqual;
+
+    std::string name;
+    int fd;
+    std::size_t regionSize;
+    char* region;
+    Header* header;
+
+    /**
+     * @brief The probe sequences of the planned submaps (constructed by each process from the header)
+     */
+    std::vector<PowerOfTwoCapacityPolicy> capacityPolicies;
+
+    /**
+     * @brief The number of valid buckets of each planned submap beyond which the next submap is allocated
+     */
+    std::vector<std::size_t> nextSubmapThresholds;
+
+    /**
+     * @brief The same control byte as Fcmm::Submap::calculateFragment()
+     */
+    static std::uint8_t calculateFragment(std::size_t hash2) FCMM_NOEXCEPT {
+        return (std::uint8_t) (0x80 | ((hash2 * (std::size_t) 0x9E3779B97F4A7C15ULL) >> (sizeof(std::size_t) * 8 - 7)));
+    }
+
+    std::atomic<std::uint8_t>* getControls(std::size_t submapIndex) const FCMM_NOEXCEPT {
+        return reinterpret_cast<std::atomic<std::uint8_t>*>(region + header->submaps[submapIndex].controlsOffset);
+    }
+
+    Bucket* getBuckets(std::size_t submapIndex) const FCMM_NOEXCEPT {
+        return reinterpret_cast<Bucket*>(region + header->submaps[submapIndex].bucketsOffset);
+    }
+
+    std::size_t getNumSubmaps() const FCMM_NOEXCEPT {
+        return (std::size_t) header->numSubmaps.load(std::memory_order_acquire);
     }
 
     /**
-     * @brief Alias for getNumEntries()
+     * @brief Searches a submap for an entry having key equal to `key`
+     *
+     * @return  a pointer to the bucket of the entry, or `nullptr` if no such entry exists in the submap
      */
-    std::size_t size() const FCMM_NOEXCEPT {
-        return getNumEntries();
+    const Bucket* findInSubmap(std::size_t submapIndex, const Key& key, std::size_t hash1, std::size_t hash2) const {
+
+        const PowerOfTwoCapacityPolicy& capacityPolicy = capacityPolicies[submapIndex];
+        const std::atomic<std::uint8_t>* controls = getControls(submapIndex);
+        const Bucket* buckets = getBuckets(submapIndex);
+
+        const std::uint8_t fragment = calculateFragment(hash2);
+        const std::size_t startGroupIndex = capacityPolicy.calculateStartGroupIndex(hash1); // initial group for probing
+        const std::size_t probeIncrement = capacityPolicy.calculateProbeIncrement(hash2); // double hashing
+        std::size_t groupIndex = startGroupIndex; // current group for probing
+
+        do {
+
+            const std::size_t firstIndex = groupIndex * GROUP_SIZE;
+            prefetch(&buckets[firstIndex]); // the entry, if present, is likely at the beginning of the group
+            const Group group(&controls[firstIndex]);
+
+            // only the buckets that may contain the key, or end the probing, are checked (in order)
+            std::uint32_t candidates = group.match(fragment) | group.match(Control::EMPTY);
+
+            while (candidates != 0) {
+
+                const std::size_t index = firstIndex + countTrailingZeros(candidates);
+                candidates &= candidates - 1;
+
+                const std::uint8_t bucketControl = controls[index].load(std::memory_order_relaxed);
+
+                if (bucketControl == fragment) {
+
+                    std::atomic_thread_fence(std::memory_order_acquire); // memory fence
+
+                    if (keyEqual(buckets[index].key, key)) {
+                        return &buckets[index]; // the requested entry was found
+                    }
+
+                } else if (bucketControl == Control::EMPTY) {
+
+                    // found a non-busy empty bucket: the requested entry is not present
+                    return nullptr;
+
+                }
+
+            }
+
+            groupIndex = capacityPolicy.calculateNextGroupIndex(groupIndex, probeIncrement); // move to the next group
+
+        } while (groupIndex != startGroupIndex);
+
+        // scanned the whole submap: the requested entry is not present
+        return nullptr;
+
     }
 
     /**
-     * @brief Returns `true` if the map has no elements, `false` otherwise
+     * @brief Searches all the submaps, from the last one to the first one, for an entry having key equal to `key`
      */
-    bool empty() const FCMM_NOEXCEPT {
-        return getNumEntries() == 0;
+    const Bucket* findHelper(const Key& key, std::size_t hash1, std::size_t hash2) const {
+        for (std::size_t submapIndex = getNumSubmaps(); submapIndex-- > 0;) {
+            const Bucket* bucket = findInSubmap(submapIndex, key, hash1, hash2);
+            if (bucket != nullptr) {
+                return bucket;
+            }
+        }
+        return nullptr;
     }
 
     /**
-     * @brief Returns a @link const_iterator @endlink pointing to the first entry
+     * @brief Inserts an entry into a submap, unless the submap already contains an entry having key equal to `key`
+     *
+     * @return  a pair consisting of a pointer to the bucket of the inserted entry (or of the entry that prevented
+     *          the insertion) and a `bool` denoting whether the insertion took place; the pointer is `nullptr`
+     *          if the submap is full
      */
-    const_iterator begin() const FCMM_NOEXCEPT {
-        return const_iterator(this);
+    std::pair<const Bucket*, bool> insertIntoSubmap(std::size_t submapIndex, const Key& key, std::size_t hash1, std::size_t hash2,
+                                                    const Value& value) {
+
+        const PowerOfTwoCapacityPolicy& capacityPolicy = capacityPolicies[submapIndex];
+        std::atomic<std::uint8_t>* controls = getControls(submapIndex);
+        Bucket* buckets = getBuckets(submapIndex);
+
+        const std::uint8_t fragment = calculateFragment(hash2);
+        const std::size_t startGroupIndex = capacityPolicy.calculateStartGroupIndex(hash1); // initial group for probing
+        const std::size_t probeIncrement = capacityPolicy.calculateProbeIncrement(hash2); // double hashing
+        std::size_t groupIndex = startGroupIndex; // current group for probing
+
+        do {
+
+            const std::size_t firstIndex = groupIndex * GROUP_SIZE;
+            const Group group(&controls[firstIndex]);
+
+            // the buckets containing entries with other keys are skipped
+            std::uint32_t candidates = group.match(fragment) | group.matchInvalid();
+
+            while (candidates != 0) {
+
+                const std::size_t index = firstIndex + countTrailingZeros(candidates);
+                candidates &= candidates - 1;
+
+                Bucket& bucket = buckets[index]; // the current bucket being probed
+                std::atomic<std::uint8_t>& control = controls[index];
+
+                std::uint8_t bucketControl = control.load(std::memory_order_relaxed);
+
+                // try to "lock" the bucket (without spinlocking): then this thread is the only one that can write on it
+                if (bucketControl == Control::EMPTY &&
+                        control.compare_exchange_strong(bucketControl, (std::uint8_t) Control::BUSY, std::memory_order_seq_cst)) {
+                    bucket.key = key;
+                    bucket.value = value;
+                    control.store(fragment, std::memory_order_release); // mark the bucket as valid
+                    header->submaps[submapIndex].numValidBuckets.increment();
+                    return std::make_pair(&bucket, true);
+                }
+
+                // as in Fcmm, a fresh value of an invalid control byte is checked, to reduce the presence of duplicates
+                if (!Control::isValid(bucketControl)) {
+                    bucketControl = control.load(std::memory_order_relaxed);
+                }
+
+                if (bucketControl == fragment) {
+                    std::atomic_thread_fence(std::memory_order_acquire); // memory fence
+                    if (keyEqual(bucket.key, key)) {
+                        // the key is already present in this submap: insertion failed
+                        return std::make_pair(&bucket, false);
+                    }
+                }
+
+            }
+
+            groupIndex = capacityPolicy.calculateNextGroupIndex(groupIndex, probeIncrement); // move to the next group
+
+        } while (groupIndex != startGroupIndex);
+
+        // scanned the whole submap: no bucket is available
+        return std::make_pair(nullptr, false);
+
     }
 
     /**
-     * @brief Returns a @link const_iterator @endlink pointing to the first entry
+     * @brief Allocates the planned submap following the last one, unless another process or thread already did
+     *
+     * @return                    `false` if all the planned submaps have already been allocated
+     * @throw std::runtime_error  thrown if the memory of the submap cannot be allocated
      */
-    const_iterator cbegin() const FCMM_NOEXCEPT {
-        return begin();
+    bool allocateSubmap(std::size_t lastSubmapIndex) {
+        const std::size_t submapIndex = lastSubmapIndex + 1;
+        if (submapIndex >= header->numPlannedSubmaps) {
+            return false;
+        }
+        if (getNumSubmaps() <= lastSubmapIndex + 1) {
+            // the memory is reserved before the submap is published, so that running out of it is an error
+            // rather than a signal when a bucket is touched
+            const SubmapDescriptor& descriptor = header->submaps[submapIndex];
+            if (posix_fallocate(fd, (off_t) descriptor.controlsOffset, (off_t) (descriptor.endOffset - descriptor.controlsOffset)) != 0) {
+                throw std::runtime_error("Cannot allocate a submap of the shared map: " + name);
+            }
+            std::uint64_t expectedNumSubmaps = submapIndex;
+            header->numSubmaps.compare_exchange_strong(expectedNumSubmaps, submapIndex + 1, std::memory_order_acq_rel);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Initializes a region just created: plans the submaps, allocates the first one, and writes the header
+     */
+    void createRegion(std::size_t estimatedNumEntries, std::size_t requestedRegionSize, float maxLoadFactor) {
+
+        Header plan;
+        plan.numPlannedSubmaps = 0;
+
+        // calculate the capacity of the first submap, as Fcmm does
+        const std::size_t firstSubmapCapacity = std::max(
+                    FIRST_SUBMAP_MIN_CAPACITY,
+                    (std::size_t) (FIRST_SUBMAP_CAPACITY_MULTIPLIER * estimatedNumEntries / maxLoadFactor));
+
+        std::uint64_t offset = alignSharedOffset(sizeof(Header));
+        std::uint64_t numGroups = PowerOfTwoCapacityPolicy((firstSubmapCapacity + GROUP_SIZE - 1) / GROUP_SIZE).getNumGroups();
+
+        while (plan.numPlannedSubmaps < SHARED_MAP_MAX_NUM_SUBMAPS) {
+            SubmapDescriptor& descriptor = plan.submaps[plan.numPlannedSubmaps];
+            descriptor.controlsOffset = offset;
+            descriptor.bucketsOffset = alignSharedOffset(offset + numGroups * GROUP_SIZE);
+            descriptor.endOffset = alignSharedOffset(descriptor.bucketsOffset + numGroups * GROUP_SIZE * sizeof(Bucket));
+            descriptor.numGroups = numGroups;
+            if (descriptor.endOffset > requestedRegionSize) {
+                break;
+            }
+            plan.numPlannedSubmaps++;
+            offset = descriptor.endOffset;
+            numGroups *= NEW_SUBMAPS_CAPACITY_MULTIPLIER;
+        }
+
+        if (plan.numPlannedSubmaps == 0) {
+            throw std::logic_error("The shared region is too small for the first submap");
+        }
+
+        regionSize = requestedRegionSize;
+        if (ftruncate(fd, (off_t) regionSize) != 0) {
+            throw std::runtime_error("Cannot resize the shared map: " + name);
+        }
+        void* mapping = mmap(nullptr, regionSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mapping == MAP_FAILED) {
+            throw std::runtime_error("Cannot map the shared map: " + name);
+        }
+        region = static_cast<char*>(mapping);
+        if (posix_fallocate(fd, 0, (off_t) plan.submaps[0].endOffset) != 0) {
+            throw std::runtime_error("Cannot allocate the first submap of the shared map: " + name);
+        }
+
+        header = new (region) Header(); // the memory of the region is zeroed: so are the counters and the buckets
+        std::memcpy(header->magic, "FCMMSHRD", sizeof(header->magic));
+        header->version = SHARED_MAP_VERSION;
+        header->numPlannedSubmaps = plan.numPlannedSubmaps;
+        header->regionSize = regionSize;
+        header->keySize = sizeof(Key);
+        header->valueSize = sizeof(Value);
+        header->bucketSize = sizeof(Bucket);
+        header->maxLoadFactor = maxLoadFactor;
+        for (std::size_t submapIndex = 0; submapIndex < plan.numPlannedSubmaps; submapIndex++) {
+            SubmapDescriptor& descriptor = header->submaps[submapIndex];
+            descriptor.controlsOffset = plan.submaps[submapIndex].controlsOffset;
+            descriptor.bucketsOffset = plan.submaps[submapIndex].bucketsOffset;
+            descriptor.endOffset = plan.submaps[submapIndex].endOffset;
+            descriptor.numGroups = plan.submaps[submapIndex].numGroups;
+        }
+        header->numSubmaps.store(1, std::memory_order_relaxed);
+        header->initialized.store(1, std::memory_order_release);
+
     }
 
-    /**
-     * @brief Returns a @link const_iterator @endlink pointing to the past-the-end entry
-     */
-    const_iterator end() const FCMM_NOEXCEPT {
-        return const_iterator(this, true);
+    /**
+     * @brief Maps a region created by another process, waiting for the header to be written
+     */
+    void openRegion() {
+
+        const std::chrono::steady_clock::time_point deadline =
+                std::chrono::steady_clock::now() + std::chrono::seconds(SHARED_MAP_OPEN_TIMEOUT);
+        const auto waitUntilDeadline = [&]() {
+            if (std::chrono::steady_clock::now() > deadline) {
+                throw std::runtime_error("Timed out waiting for the shared map to be initialized: " + name);
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        };
+
+        struct stat regionStat;
+        while (true) {
+            if (fstat(fd, &regionStat) != 0) {
+                throw std::runtime_error("Cannot open the shared map: " + name);
+            }
+            if ((std::size_t) regionStat.st_size >= sizeof(Header)) {
+                break;
+            }
+            waitUntilDeadline(); // the creator has not resized the region yet
+        }
+
+        regionSize = (std::size_t) regionStat.st_size;
+        void* mapping = mmap(nullptr, regionSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mapping == MAP_FAILED) {
+            throw std::runtime_error("Cannot map the shared map: " + name);
+        }
+        region = static_cast<char*>(mapping);
+        header = reinterpret_cast<Header*>(region);
+
+        while (header->initialized.load(std::memory_order_acquire) == 0) {
+            waitUntilDeadline();
+        }
+
+        const bool valid = std::memcmp(header->magic, "FCMMSHRD", sizeof(header->magic)) == 0 &&
+                header->version == SHARED_MAP_VERSION && header->regionSize == regionSize &&
+                header->keySize == sizeof(Key) && header->valueSize == sizeof(Value) && header->bucketSize == sizeof(Bucket) &&
+                header->numPlannedSubmaps >= 1 && header->numPlannedSubmaps <= SHARED_MAP_MAX_NUM_SUBMAPS &&
+                header->submaps[header->numPlannedSubmaps - 1].endOffset <= regionSize;
+        if (!valid) {
+            throw std::runtime_error("Not a compatible shared map: " + name);
+        }
+
     }
 
-    /**
-     * @brief Returns a @link const_iterator @endlink pointing to the past-the-end entry
-     */
-    const_iterator cend() const FCMM_NOEXCEPT {
-        return end();
-    }
+public:
 
     /**
-     * @brief Returns a pointer to a new map containing all the entries currently present in this map for
-     * which `filterFunction(entry)` returns `true`.
-     *
-     * The new map is created via `new` and it is responsibility of the caller to `delete` it.
+     * @brief Constructor: opens the shared map having the given name, creating it if it does not exist.
      *
-     * @param filterFunction   a function or functor that, given an entry, returns `true` if
-     *                         it should be kept, `false` if it should be filtered out
+     * The other arguments are only used to create the map: a map created by another process keeps its own settings.
      *
-     * @tparam FilterFunction  function or functor implementing `bool operator()(const Entry&)`
+     * @param name                 the name of the shared-memory region (see
+     *                             <a href="https://man7.org/linux/man-pages/man3/shm_open.3.html">`shm_open()`</a>),
+     *                             e.g. `/my-map`
+     * @param estimatedNumEntries  an estimate for the number of entries that will be inserted
+     * @param regionSize           the size of the region (in bytes): it bounds the size of the map,
+     *                             but only the submaps in use are backed by memory
+     * @param maxLoadFactor        the maximum load factor of each submap
      *
-     * @return                 the filtered map
+     * @throw std::logic_error     thrown if the maximum load factor is invalid, or the region is too small
+     * @throw std::runtime_error   thrown if the region cannot be created or mapped, or was created for other
+     *                             types of keys and values
      */
-    template<typename FilterFunction>
-    Fcmm* filter(FilterFunction filterFunction) const {
+    explicit SharedFcmm(const std::string& name, std::size_t estimatedNumEntries = 0,
+                        std::size_t regionSize = DEFAULT_SHARED_REGION_SIZE, float maxLoadFactor = DEFAULT_MAX_LOAD_FACTOR) :
+            name(name), fd(-1), regionSize(0), region(nullptr), header(nullptr) {
 
-        Fcmm* map = new Fcmm(getNumEntries());
+        if (maxLoadFactor <= 0.0f || maxLoadFactor >= 1.0f) {
+            throw std::logic_error("Invalid maximum load factor");
+        }
 
-        for (const Entry& entry : *this) {
-            if (filterFunction(entry)) {
-                map->insert(entry);
+        bool created = false;
+        while (fd < 0) {
+            fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+            if (fd >= 0) {
+                created = true;
+            } else if (errno == EEXIST) {
+                fd = shm_open(name.c_str(), O_RDWR, 0);
+                if (fd < 0 && errno != ENOENT) { // if removed in the meantime, try to create it again
+                    throw std::runtime_error("Cannot open the shared map: " + name);
+                }
+            } else {
+                throw std::runtime_error("Cannot create the shared map: " + name);
             }
         }
 
-        return map;
+        try {
+            if (created) {
+                createRegion(estimatedNumEntries, regionSize, maxLoadFactor);
+            } else {
+                openRegion();
+            }
+        } catch (...) {
+            if (region != nullptr) {
+                munmap(region, this->regionSize);
+            }
+            close(fd);
+            if (created) {
+                shm_unlink(name.c_str()); // the other processes would wait for the header in vain
+            }
+            throw;
+        }
+
+        for (std::size_t submapIndex = 0; submapIndex < header->numPlannedSubmaps; submapIndex++) {
+            capacityPolicies.push_back(PowerOfTwoCapacityPolicy((std::size_t) header->submaps[submapIndex].numGroups));
+            nextSubmapThresholds.push_back((std::size_t) (header->submaps[submapIndex].numGroups * GROUP_SIZE * header->maxLoadFactor));
+        }
 
     }
 
     /**
-     * @brief Returns a pointer to a new map containing all the entries currently present in this map.
-     *
-     * Actually, the number of entries in the cloned map can be lower than the number of entries in this map,
-     * since duplicate entries (i.e. entries having the same key) are stripped out by the clone operation.
-     *
-     * The new map is created via `new` and it is responsibility of the caller to `delete` it.
+     * @brief Destructor: unmaps the region, which persists until removed (see remove())
      */
-
-    Fcmm* clone() const {
-        return filter([](const Entry&) { return true; });
+    ~SharedFcmm() {
+        munmap(region, regionSize);
+        close(fd);
     }
 
     /**
-     * @brief Returns statistics about this @link Fcmm @endlink instance.
+     * @brief Removes the shared map having the given name: the processes that opened it can keep using it,
+     * while the processes opening a map with that name from now on create a new one
      *
-     * The information returned by this method is useful for debugging and benchmarking.
+     * @return  `true` if the map existed
+     */
+    static bool remove(const std::string& name) {
+        return shm_unlink(name.c_str()) == 0;
+    }
+
+    /**
+     * @brief Searches for an entry having key equal to `key`
      *
-     * @see Stats
+     * @return  a pointer to the value of the entry (valid until the map is destructed),
+     *          or `nullptr` if no such entry exists
      */
-    Stats getStats() const {
+    const Value* find(const Key& key) const {
+        const Bucket* bucket = findHelper(key, keyHash1(key), keyHash2(key));
+        return bucket != nullptr ? &bucket->value : nullptr;
+    }
 
-        Stats stats;
+    /**
+     * @brief Returns `true` if the map contains an entry having key equal to `key`
+     */
+    bool contains(const Key& key) const {
+        return find(key) != nullptr;
+    }
 
-        stats.numEntries = getNumEntries();
-        stats.numSubmaps = getNumSubmaps();
-        for (std::size_t submapIndex = 0; submapIndex < stats.numSubmaps; submapIndex++) {
-            const Submap& submap = *getSubmap(submapIndex);
-            stats.submapsStats.push_back(submap.getStats());
+    /**
+     * @brief Returns a const reference to the value of an entry having key equal to `key`.
+     * If no such entry exists, an exception of type `std::out_of_range` is thrown.
+     */
+    const Value& at(const Key& key) const {
+        const Value* value = find(key);
+        if (value == nullptr) {
+            throw std::out_of_range("Entry not found");
         }
-
-        return stats;
-
+        return *value;
     }
 
     /**
-     * @brief A const <a href="http://en.cppreference.com/w/cpp/concept/InputIterator">input iterator</a>
-     * for iterating over the map. Iterators are never invalidated.
+     * @brief Inserts a new entry into the map, unless an entry having key equal to `key` is found.
+     *
+     * @param key                    the key of the entry to be inserted
+     * @param computeValue           a function or functor that, given the key, calculates the corresponding value
+     *                               (called only if the key is not found)
+     *
+     * @tparam ComputeValueFunction  function or functor implementing `Value operator()(const Key&)`
+     *
+     * @return                       a pair consisting of a pointer to the value of the inserted entry (or of the entry
+     *                               that prevented the insertion) and a `bool` denoting whether the insertion took place
+     *
+     * @throw std::runtime_error     thrown if the map is full, or the memory of a new submap cannot be allocated
      */
-    class const_iterator : public std::iterator<std::input_iterator_tag, const Entry> {
-
-        friend class Fcmm;
-
-    private:
-
-        /**
-         * @brief The @link Fcmm @endlink instance this iterator is iterating over
-         */
-        const Fcmm* map;
-
-        /**
-         * @brief The index of the submap containing the bucket currently pointed by this iterator
-         */
-        std::size_t submapIndex;
-
-        /**
-         * @brief The index of the bucket currently pointed by this iterator
-         */
-        std::size_t bucketIndex;
-
-        /**
-         * @brief This boolean is `true` if the iterator is pointing to the past-the-end entry of the map,
-         * `false` otherwise
-         */
-        bool end;
+    template<typename ComputeValueFunction>
+    std::pair<const Value*, bool> insert(const Key& key, ComputeValueFunction computeValue) {
 
-        /**
-         * @brief Returns the submap containing the bucket currently pointed by this iterator
-         */
-        const Submap& getSubmap() const {
-            return *map->getSubmap(submapIndex);
-        }
+        const std::size_t hash1 = keyHash1(key);
+        const std::size_t hash2 = keyHash2(key);
 
-        /**
-         * @brief Returns the bucket currently pointed by this iterator
-         */
-        const Bucket& getBucket() const {
-            return getSubmap().getBucket(bucketIndex);
+        const Bucket* foundBucket = findHelper(key, hash1, hash2);
+        if (foundBucket != nullptr) {
+            return std::make_pair(&foundBucket->value, false);
         }
 
-        /**
-         * @brief Returns the entry currently pointed by this iterator
-         */
-        const Entry& getEntry() const {
-            return getBucket().entry;
-        }
+        const Value value = computeValue(key);
 
-        /**
-         * @brief Seeks the next valid bucket starting from `bucketIndex` (inclusive)
-         */
-        void seek() {
+        while (true) {
 
-            while (!end) {
+            const std::size_t lastSubmapIndex = getNumSubmaps() - 1;
+            const std::pair<const Bucket*, bool> result = insertIntoSubmap(lastSubmapIndex, key, hash1, hash2, value);
 
-                if (getSubmap().seek(bucketIndex)) { // side-effect on bucketIndex
-                    return;
-                } else {
-                    submapIndex++;
-                    bucketIndex = 0;
-                    if (submapIndex > map->getLastSubmapIndex()) {
-                        end = true;
-                        submapIndex = 0;
-                    }
+            if (result.first != nullptr) {
+                if (result.second && header->submaps[lastSubmapIndex].numValidBuckets.getApproximate() >
+                        nextSubmapThresholds[lastSubmapIndex]) {
+                    allocateSubmap(lastSubmapIndex);
                 }
-
+                return std::make_pair(&result.first->value, result.second);
             }
 
-        }
-
-        /**
-         * @brief Increments `bucketIndex` and seeks the next valid bucket starting
-         * from `bucketIndex` (inclusive)
-         */
-        void next() {
-            bucketIndex++;
-            seek();
-        }
-
-        /**
-         * @brief Constructs a const iterator for a @link Fcmm @endlink instance
-         *
-         * @param map  the @link Fcmm @endlink instance the iterator shall iterate over
-         * @param end  `true` if the iterator shall point to the past-the-end entry, `false` otherwise
-         */
-        const_iterator(const Fcmm* map, bool end = false) :
-                map(map),
-                submapIndex(0),
-                bucketIndex(0),
-                end(end) {
-            seek();
-        }
+            if (!allocateSubmap(lastSubmapIndex)) {
+                throw std::runtime_error("The shared map is full: " + name);
+            }
 
-        /**
-         * @brief Constructs a const iterator for a @link Fcmm @endlink instance
-         *
-         * @param map          the @link Fcmm @endlink instance the iterator shall iterate over
-         * @param submapIndex  the index of the submap containing the bucket the iterator shall point to
-         * @param bucketIndex  the index of the bucket the iterator shall point to
-         */
-        const_iterator(const Fcmm* map, std::size_t submapIndex, std::size_t bucketIndex) :
-                map(map),
-                submapIndex(submapIndex),
-                bucketIndex(bucketIndex),
-                end(false) {
         }
 
-    public:
+    }
 
-        /**
-         * @brief Default constructor. The resulting iterator is invalid and should not be used.
-         */
-        const_iterator() : map(NULL), submapIndex(0), bucketIndex(0), end(true) {
-        }
+    /**
+     * @brief Inserts a new entry into the map, unless an entry having key equal to `key` is found.
+     *
+     * @see insert(const Key&, ComputeValueFunction)
+     */
+    std::pair<const Value*, bool> emplace(const Key& key, const Value& value) {
+        return insert(key, [&value](const Key&) -> const Value& { return value; });
+    }
 
-        /**
-         * @brief Equality operator
-         */
-        bool operator==(const const_iterator& other) const {
-            return map == other.map &&
-                    ((end && other.end) || (!end && !other.end && submapIndex == other.submapIndex && bucketIndex == other.bucketIndex));
+    /**
+     * @brief Returns the number of entries in the map, calculated from the counters of the submaps
+     * (avoid calling this function in hot paths)
+     */
+    std::size_t getNumEntries() const FCMM_NOEXCEPT {
+        std::size_t numEntries = 0;
+        for (std::size_t submapIndex = 0; submapIndex < getNumSubmaps(); submapIndex++) {
+            numEntries += header->submaps[submapIndex].numValidBuckets.get();
         }
+        return numEntries;
+    }
 
-        /**
-         * @brief Inequality operator
-         */
-        bool operator!=(const const_iterator& other) const {
-            return !(*this == other);
-        }
+    /**
+     * @brief Alias for getNumEntries()
+     */
+    std::size_t size() const FCMM_NOEXCEPT {
+        return getNumEntries();
+    }
 
-        /**
-         * @brief Pre-increment operator
-         */
-        const_iterator& operator++(void) {
-            next();
-            return *this;
-        }
+    /**
+     * @brief Returns the name of the shared-memory region
+     */
+    const std::string& getName() const FCMM_NOEXCEPT {
+        return name;
+    }
 
-        /**
-         * @brief Post-increment operator
-         */
-        const_iterator operator++(/* dummy */ int) {
-            const_iterator old(*this);
-            ++(*this);
-            return old;
-        }
+    /**
+     * @brief Returns the statistics about the map (see Stats): submaps are never retired nor skipped,
+     * and computations are never avoided
+     */
+    Stats getStats() const {
 
-        /**
-         * @brief Dereference operator
-         */
-        const Entry& operator*() const {
-            return getEntry();
-        }
+        Stats stats = Stats();
 
-        /**
-         * @brief Arrow operator
-         */
-        const Entry* operator->() const {
-            return &getEntry();
+        stats.numSubmaps = getNumSubmaps();
+        for (std::size_t submapIndex = 0; submapIndex < stats.numSubmaps; submapIndex++) {
+            SubmapStats submapStats = SubmapStats();
+            submapStats.capacity = (std::size_t) header->submaps[submapIndex].numGroups * GROUP_SIZE;
+            submapStats.numValidBuckets = header->submaps[submapIndex].numValidBuckets.get();
+            submapStats.loadFactor = (float) submapStats.numValidBuckets / submapStats.capacity;
+            stats.submapsStats.push_back(submapStats);
+            stats.numEntries += submapStats.numValidBuckets;
         }
 
-    };
+        return stats;
 
-    /**
-     * @brief The object is not copy-constructible: use clone() instead
-     */
-    Fcmm(const Fcmm&) = delete;
+    }
 
-    /**
-     * @brief The object cannot be moved
-     */
-    Fcmm(Fcmm&&) = delete;
+    SharedFcmm(const SharedFcmm&) = delete;
+    SharedFcmm& operator=(const SharedFcmm&) = delete;
 
 };
 
+#endif // FCMM_MMAP
+
 } // namespace fcmm
 
 #undef FCMM_NOEXCEPT
+#undef FCMM_NOINLINE
+#undef FCMM_SSE2
+#undef FCMM_INT128
+#undef FCMM_MMAP
 
 #endif // FCMM_H_